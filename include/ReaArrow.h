@@ -0,0 +1,727 @@
+#pragma once
+
+#include "ReaJson.h"
+
+#include <initializer_list>
+
+// Arrow export: lays projects out as column tables of their projects, tracks, items and FX,
+// and writes tables as Arrow IPC files that dataframe tools read without converting. The
+// flatbuffer metadata is written by hand, so no Arrow library is needed. Buffers are
+// uncompressed and 64 byte aligned, so a reader mapping the file uses them in place.
+
+namespace ReaParser {
+
+	enum class ReaColumnType {
+		Bool, Int32, Int64, Float32, Float64, String
+	};
+
+	// A column of values of one type. Fixed width values are packed one after another in Data,
+	// a byte per bool. Strings are stored back to back, row i in Data from Offsets[i] to Offsets[i + 1].
+	struct ReaColumn {
+		std::string Name;
+		ReaColumnType Type = ReaColumnType::Int32;
+		std::vector<char> Data;
+		std::vector<uint64_t> Offsets;
+
+		// Bytes per value, 0 for strings
+		size_t Width() const;
+
+		size_t Rows() const { return Type == ReaColumnType::String ? Offsets.size() - 1 : Data.size() / Width(); }
+
+		// Value in row, T being the column's type
+		template <class T>
+		T Value(size_t row) const {
+			T value;
+			memcpy(&value, &Data[row * sizeof(T)], sizeof(T));
+			return value;
+		}
+
+		std::string String(size_t row) const {
+			return std::string(Data.data() + Offsets[row], static_cast<size_t>(Offsets[row + 1] - Offsets[row]));
+		}
+	};
+
+	// Columns of equal length, filled a row at a time with a value for each column in turn
+	class ReaTable {
+	public:
+		explicit ReaTable(const std::string& name = std::string()) : m_name(name) {}
+
+		const std::string& Name() const { return m_name; }
+		size_t Rows() const { return m_rows; }
+		const std::vector<ReaColumn>& Columns() const { return m_columns; }
+
+		// Column called name, nullptr if there isn't one
+		const ReaColumn* Column(const std::string& name) const;
+
+		// Only before the first row
+		void AddColumn(const std::string& name, ReaColumnType type);
+
+		// Makes room for rows more rows of fixed width values
+		void Reserve(size_t rows);
+
+		// The next column's value in the row being filled, throws Exception if the column is of another type
+		void Bool(bool value);
+		void Int32(int32_t value);
+		void Int64(int64_t value);
+		void Float32(float value);
+		void Float64(double value);
+		void String(const char* value, size_t size);
+		void String(const std::string& value) { String(value.data(), value.size()); }
+
+		// Throws Exception if the row is missing values
+		void EndRow();
+
+	private:
+		std::string m_name;
+		std::vector<ReaColumn> m_columns;
+		size_t m_rows = 0, m_next = 0;
+
+		ReaColumn& Next(ReaColumnType type);
+	};
+
+	struct ReaArrowOptions {
+		// Files are written to Directory as <Prefix>-projects.arrow, -tracks, -items and -fx
+		std::string Directory = ".";
+		std::string Prefix = "reaparser";
+
+		// As in ReaJsonOptions
+		bool FXData = true;
+
+		// Rows per record batch. Batches are also cut short to keep each column's strings under 2 GB.
+		size_t BatchRows = 1 << 20;
+
+		// As in ReaJsonOptions
+		size_t BufferSize = 1 << 20;
+	};
+
+	// A project's table rows, joined by "project", its index in the projects passed, and by "track"
+	struct ReaArrowTables {
+		ReaTable Projects, Tracks, Items, FX;
+	};
+
+	REAPARSER_API ReaArrowTables ProjectTables(const ReaProject& project, const ReaArrowOptions& options = ReaArrowOptions());
+	REAPARSER_API ReaArrowTables ProjectTables(const std::vector<ReaProject>& projects,
+		const ReaArrowOptions& options = ReaArrowOptions());
+
+	// Writes table as an Arrow IPC file starting where fd is, or to a file. Throws Exception
+	// if it can't be written.
+	REAPARSER_API void WriteArrowFile(const ReaTable& table, int fd, const ReaArrowOptions& options = ReaArrowOptions());
+	REAPARSER_API void WriteArrowFile(const ReaTable& table, const std::string& filepath,
+		const ReaArrowOptions& options = ReaArrowOptions());
+
+	// Writes the tables of projects to options.Directory, returns the files written
+	REAPARSER_API std::vector<std::string> ExportArrow(const std::vector<ReaProject>& projects,
+		const ReaArrowOptions& options = ReaArrowOptions());
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	namespace Arrow {
+		// Lays a flatbuffer out front to back. A table is written whole with its offsets left
+		// empty, then what they refer to after it, and each offset linked once its target is written.
+		class FlatBuilder {
+		public:
+			std::vector<uint8_t> Data = std::vector<uint8_t>(4); // Offset to the root table
+
+			void StartTable() { m_fields.clear(); }
+
+			template <class T>
+			void Add(uint16_t id, T value) {
+				Field field = { id, sizeof(T), 0, {} };
+				memcpy(field.Value, &value, sizeof(T));
+				m_fields.push_back(field);
+			}
+
+			// An offset to a table, vector or string, pointed at it by Link
+			void AddOffset(uint16_t id) { Add<uint32_t>(id, 0); }
+
+			// Writes the table, returns its position
+			size_t EndTable() {
+				std::stable_sort(m_fields.begin(), m_fields.end(), [](const Field& a, const Field& b) { return a.Size > b.Size; });
+				uint16_t count = 0, size = 4;
+				for (auto& field : m_fields) {
+					count = std::max<uint16_t>(count, field.Id + 1);
+					field.Position = size;
+					size += field.Size;
+				}
+
+				// The vtable goes first, then the table, which starts 4 bytes before an 8 byte boundary
+				// so its largest fields come aligned
+				Align(2);
+				size_t vtable = Data.size();
+				Data.resize(vtable + 4 + 2 * count);
+				Put<uint16_t>(vtable, 4 + 2 * count);
+				Put<uint16_t>(vtable + 2, size);
+				Data.resize((Data.size() + 3) / 8 * 8 + 4);
+				size_t table = Data.size();
+				Data.resize(table + size);
+				Put<int32_t>(table, static_cast<int32_t>(table - vtable));
+				for (auto& field : m_fields) {
+					Put<uint16_t>(vtable + 4 + 2 * field.Id, field.Position);
+					memcpy(&Data[table + field.Position], field.Value, field.Size);
+				}
+				m_table = table;
+				return table;
+			}
+
+			// Position of field id in the table last ended
+			size_t FieldPosition(uint16_t id) const {
+				for (auto& field : m_fields) {
+					if (field.Id == id)
+						return m_table + field.Position;
+				}
+				return 0;
+			}
+
+			// Points the offset at position to target
+			void Link(size_t position, size_t target) { Put<uint32_t>(position, static_cast<uint32_t>(target - position)); }
+
+			size_t String(const std::string& value) {
+				Align(4);
+				size_t position = Data.size();
+				Data.resize(position + 4);
+				Put<uint32_t>(position, static_cast<uint32_t>(value.size()));
+				Data.insert(Data.end(), value.begin(), value.end());
+				Data.push_back(0);
+				return position;
+			}
+
+			// Writes a vector of count elements of size bytes, zeroed, returns its position.
+			// Its elements start 4 bytes after it, aligned to alignment.
+			size_t Vector(size_t count, size_t size, size_t alignment) {
+				Data.resize((Data.size() + 4 + alignment - 1) / alignment * alignment - 4);
+				size_t position = Data.size();
+				Data.resize(position + 4 + count * size);
+				Put<uint32_t>(position, static_cast<uint32_t>(count));
+				return position;
+			}
+
+			template <class T>
+			void Put(size_t position, T value) { memcpy(&Data[position], &value, sizeof(T)); }
+
+		private:
+			struct Field {
+				uint16_t Id, Size, Position;
+				uint8_t Value[8];
+			};
+			std::vector<Field> m_fields;
+			size_t m_table = 0;
+
+			void Align(size_t alignment) { Data.resize((Data.size() + alignment - 1) / alignment * alignment); }
+		};
+
+		// Type ids of the Arrow flatbuffer schema
+		enum : uint8_t { IntType = 2, FloatingPointType = 3, Utf8Type = 5, BoolType = 6 };
+		enum : uint8_t { SchemaHeader = 1, RecordBatchHeader = 3 };
+		static constexpr int16_t MetadataV5 = 4;
+		static constexpr size_t Alignment = 64;
+
+		// Writes a Schema table of table's columns, returns its position
+		inline size_t WriteSchema(FlatBuilder& builder, const ReaTable& table) {
+			const std::vector<ReaColumn>& columns = table.Columns();
+			builder.StartTable();
+			builder.Add<int16_t>(0, 0); // Little endian
+			builder.AddOffset(1);        // Fields
+			size_t schema = builder.EndTable();
+
+			size_t fieldsOffset = builder.FieldPosition(1);
+			size_t fields = builder.Vector(columns.size(), 4, 4);
+			builder.Link(fieldsOffset, fields);
+
+			for (size_t i = 0; i < columns.size(); i++) {
+				const ReaColumn& column = columns[i];
+				uint8_t type = column.Type == ReaColumnType::Bool ? BoolType : column.Type == ReaColumnType::String ? Utf8Type :
+					column.Type == ReaColumnType::Float32 || column.Type == ReaColumnType::Float64 ? FloatingPointType : IntType;
+
+				builder.StartTable();
+				builder.AddOffset(0);        // Name
+				builder.Add<uint8_t>(1, 0);  // Not nullable
+				builder.Add<uint8_t>(2, type);
+				builder.AddOffset(3);        // Type
+				builder.AddOffset(5);        // Children
+				size_t field = builder.EndTable();
+				size_t name = builder.FieldPosition(0), typeOffset = builder.FieldPosition(3), children = builder.FieldPosition(5);
+				builder.Link(fields + 4 + 4 * i, field);
+
+				builder.Link(name, builder.String(column.Name));
+				builder.StartTable();
+				if (type == IntType) {
+					builder.Add<int32_t>(0, column.Type == ReaColumnType::Int64 ? 64 : 32);
+					builder.Add<uint8_t>(1, 1); // Signed
+				}
+				else if (type == FloatingPointType)
+					builder.Add<int16_t>(0, column.Type == ReaColumnType::Float64 ? 2 : 1);
+				builder.Link(typeOffset, builder.EndTable());
+				builder.Link(children, builder.Vector(0, 4, 4));
+			}
+			return schema;
+		}
+
+		inline uint64_t Aligned(uint64_t size) { return (size + Alignment - 1) / Alignment * Alignment; }
+
+		// Writes buffered, counting the position in the file
+		class Output {
+		public:
+			Output(int fd, size_t bufferSize) : m_fd(fd), m_buffer(std::max<size_t>(bufferSize, 4096)) {}
+
+			uint64_t Position() const { return m_position; }
+
+			void Write(const void* data, size_t size) {
+				if (size == 0)
+					return;
+				m_position += size;
+				if (m_used + size > m_buffer.size()) {
+					Flush();
+
+					// Larger than the buffer, so straight out
+					if (size >= m_buffer.size()) {
+						if (!Json::WriteAll(m_fd, static_cast<const char*>(data), size))
+							throw Exception("Unable to write Arrow file: " + std::string(strerror(errno)));
+						return;
+					}
+				}
+				memcpy(&m_buffer[m_used], data, size);
+				m_used += size;
+			}
+
+			template <class T>
+			void Put(T value) { Write(&value, sizeof(T)); }
+
+			// Zeros up to the next multiple of Alignment
+			void Pad() {
+				static const char zeros[Alignment] = {};
+				Write(zeros, static_cast<size_t>(Aligned(m_position) - m_position));
+			}
+
+			void Flush() {
+				if (m_used > 0 && !Json::WriteAll(m_fd, m_buffer.data(), m_used))
+					throw Exception("Unable to write Arrow file: " + std::string(strerror(errno)));
+				m_used = 0;
+			}
+
+			// Writes a message's prefix and metadata, padded for its body to start aligned.
+			// Returns the bytes written.
+			int32_t Message(const FlatBuilder& metadata) {
+				uint64_t start = m_position;
+				uint64_t end = Aligned(start + 8 + metadata.Data.size());
+				Put<uint32_t>(0xffffffffu);
+				Put<int32_t>(static_cast<int32_t>(end - start - 8));
+				Write(metadata.Data.data(), metadata.Data.size());
+				Pad();
+				return static_cast<int32_t>(end - start);
+			}
+
+		private:
+			int m_fd;
+			std::vector<char> m_buffer;
+			size_t m_used = 0;
+			uint64_t m_position = 0;
+		};
+
+		inline FlatBuilder SchemaMessage(const ReaTable& table) {
+			FlatBuilder builder;
+			builder.StartTable();
+			builder.Add<int16_t>(0, MetadataV5);
+			builder.Add<uint8_t>(1, SchemaHeader);
+			builder.AddOffset(2);
+			builder.Add<int64_t>(3, 0);
+			builder.Link(0, builder.EndTable());
+			size_t header = builder.FieldPosition(2);
+			builder.Link(header, WriteSchema(builder, table));
+			return builder;
+		}
+
+		// Sizes of the buffers of rows begin to end, for each column its validity bitmap, left
+		// empty as nothing is null, then its values or its offsets and characters
+		inline std::vector<uint64_t> BufferSizes(const ReaTable& table, size_t begin, size_t end) {
+			std::vector<uint64_t> sizes;
+			for (auto& column : table.Columns()) {
+				sizes.push_back(0);
+				if (column.Type == ReaColumnType::String) {
+					sizes.push_back((end - begin + 1) * 4);
+					sizes.push_back(column.Offsets[end] - column.Offsets[begin]);
+				}
+				else if (column.Type == ReaColumnType::Bool)
+					sizes.push_back((end - begin + 7) / 8);
+				else
+					sizes.push_back((end - begin) * column.Width());
+			}
+			return sizes;
+		}
+
+		inline FlatBuilder RecordBatchMessage(const ReaTable& table, size_t rows, const std::vector<uint64_t>& buffers,
+			int64_t& bodyLength) {
+			bodyLength = 0;
+			for (uint64_t size : buffers)
+				bodyLength += Aligned(size);
+
+			FlatBuilder builder;
+			builder.StartTable();
+			builder.Add<int16_t>(0, MetadataV5);
+			builder.Add<uint8_t>(1, RecordBatchHeader);
+			builder.AddOffset(2);
+			builder.Add<int64_t>(3, bodyLength);
+			builder.Link(0, builder.EndTable());
+			size_t header = builder.FieldPosition(2);
+
+			builder.StartTable();
+			builder.Add<int64_t>(0, static_cast<int64_t>(rows));
+			builder.AddOffset(1); // Nodes
+			builder.AddOffset(2); // Buffers
+			builder.Link(header, builder.EndTable());
+			size_t nodesField = builder.FieldPosition(1), buffersField = builder.FieldPosition(2);
+
+			// A length and null count for each column
+			size_t nodes = builder.Vector(table.Columns().size(), 16, 8);
+			builder.Link(nodesField, nodes);
+			for (size_t i = 0; i < table.Columns().size(); i++)
+				builder.Put<int64_t>(nodes + 4 + 16 * i, static_cast<int64_t>(rows));
+
+			// An offset in the body and a length for each buffer
+			size_t vector = builder.Vector(buffers.size(), 16, 8);
+			builder.Link(buffersField, vector);
+			uint64_t offset = 0;
+			for (size_t i = 0; i < buffers.size(); i++) {
+				builder.Put<int64_t>(vector + 4 + 16 * i, static_cast<int64_t>(offset));
+				builder.Put<int64_t>(vector + 12 + 16 * i, static_cast<int64_t>(buffers[i]));
+				offset += Aligned(buffers[i]);
+			}
+			return builder;
+		}
+
+		// Writes the buffers BufferSizes gives for rows begin to end of column
+		inline void WriteColumn(Output& output, const ReaColumn& column, size_t begin, size_t end) {
+			if (column.Type == ReaColumnType::String) {
+				// Offsets from the batch's first string
+				int32_t offsets[1024];
+				uint64_t base = column.Offsets[begin];
+				for (size_t row = begin; row <= end;) {
+					size_t count = std::min<size_t>(1024, end + 1 - row);
+					for (size_t i = 0; i < count; i++)
+						offsets[i] = static_cast<int32_t>(column.Offsets[row + i] - base);
+					output.Write(offsets, count * sizeof(int32_t));
+					row += count;
+				}
+				output.Pad();
+				output.Write(column.Data.data() + base, static_cast<size_t>(column.Offsets[end] - base));
+			}
+			else if (column.Type == ReaColumnType::Bool) {
+				// A bit per value, the first row in the lowest bit
+				const char* values = column.Data.data() + begin;
+				uint8_t bits[1024];
+				for (size_t row = 0; row < end - begin;) {
+					size_t count = std::min<size_t>(sizeof(bits) * 8, end - begin - row), i = 0;
+#ifdef REAPARSER_SSE2
+					for (; i + 16 <= count; i += 16) {
+						__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + row + i));
+						int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())) ^ 0xffff;
+						bits[i / 8] = static_cast<uint8_t>(mask);
+						bits[i / 8 + 1] = static_cast<uint8_t>(mask >> 8);
+					}
+#endif
+					memset(bits + i / 8, 0, (count - i + 7) / 8);
+					for (; i < count; i++) {
+						if (values[row + i])
+							bits[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+					}
+					output.Write(bits, (count + 7) / 8);
+					row += count;
+				}
+			}
+			else
+				output.Write(column.Data.data() + begin * column.Width(), (end - begin) * column.Width());
+			output.Pad();
+		}
+
+		inline ReaTable MakeTable(const char* name, std::initializer_list<std::pair<const char*, ReaColumnType>> columns,
+			size_t rows) {
+			ReaTable table(name);
+			for (auto& column : columns)
+				table.AddColumn(column.first, column.second);
+			table.Reserve(rows);
+			return table;
+		}
+
+		inline ReaArrowTables Tables(const ReaProject* const* projects, size_t count, const ReaArrowOptions& options) {
+			typedef ReaColumnType T;
+			size_t tracks = 0, items = 0, fx = 0;
+			for (size_t p = 0; p < count; p++) {
+				tracks += projects[p]->Tracks.size();
+				for (auto& track : projects[p]->Tracks) {
+					items += track.MediaItems.size();
+					fx += track.FXChain.size();
+				}
+			}
+
+			ReaArrowTables tables;
+			tables.Projects = MakeTable("projects", { { "project", T::Int32 }, { "name", T::String }, { "filepath", T::String },
+				{ "versionMajor", T::Int32 }, { "versionMinor", T::Int32 }, { "platform", T::String }, { "sampleRate", T::Int32 },
+				{ "bpm", T::Float32 }, { "beats", T::Int32 }, { "bars", T::Int32 }, { "recordPath", T::String },
+				{ "secondaryRecordPath", T::String }, { "tracks", T::Int32 } }, count);
+			tables.Tracks = MakeTable("tracks", { { "project", T::Int32 }, { "track", T::Int32 }, { "name", T::String },
+				{ "guid", T::String }, { "id", T::Int64 }, { "channels", T::Int32 }, { "volume", T::Float32 }, { "pan", T::Float32 },
+				{ "muted", T::Bool }, { "phaseInverted", T::Bool }, { "folderDepth", T::Int32 }, { "items", T::Int32 },
+				{ "fxCount", T::Int32 } }, tracks);
+			tables.Items = MakeTable("items", { { "project", T::Int32 }, { "track", T::Int32 }, { "index", T::Int32 },
+				{ "name", T::String }, { "type", T::String }, { "filepath", T::String }, { "start", T::Float32 }, { "end", T::Float32 },
+				{ "length", T::Float32 }, { "startOffset", T::Float32 }, { "volume", T::Float32 }, { "pan", T::Float32 },
+				{ "muted", T::Bool } }, items);
+			tables.FX = MakeTable("fx", { { "project", T::Int32 }, { "track", T::Int32 }, { "index", T::Int32 }, { "name", T::String },
+				{ "type", T::String }, { "filepath", T::String } }, fx);
+			if (options.FXData)
+				tables.FX.AddColumn("data", T::String);
+
+			for (size_t p = 0; p < count; p++) {
+				const ReaProject& project = *projects[p];
+				ReaVersion version = project.Version;
+				int32_t index = static_cast<int32_t>(p);
+
+				ReaTable& row = tables.Projects;
+				row.Int32(index);
+				row.String(project.Name);
+				row.String(project.Filepath);
+				row.Int32(static_cast<int32_t>(version.Major));
+				row.Int32(static_cast<int32_t>(version.Minor));
+				row.String(version.PlatformString());
+				row.Int32(static_cast<int32_t>(project.SampleRate));
+				row.Float32(project.Tempo.BPM);
+				row.Int32(static_cast<int32_t>(project.Tempo.Beats));
+				row.Int32(static_cast<int32_t>(project.Tempo.Bars));
+				row.String(project.RecordPath);
+				row.String(project.SecondaryRecordPath);
+				row.Int32(static_cast<int32_t>(project.Tracks.size()));
+				row.EndRow();
+
+				for (size_t t = 0; t < project.Tracks.size(); t++) {
+					const ReaTrack& track = project.Tracks[t];
+					ReaTable& trackRow = tables.Tracks;
+					trackRow.Int32(index);
+					trackRow.Int32(static_cast<int32_t>(t));
+					trackRow.String(track.Name);
+					trackRow.String(track.GUID);
+					trackRow.Int64(track.NumericID);
+					trackRow.Int32(static_cast<int32_t>(track.Channels));
+					trackRow.Float32(track.RawVolume);
+					trackRow.Float32(track.RawPan);
+					trackRow.Bool(track.Muted);
+					trackRow.Bool(track.PhaseInverted);
+					trackRow.Int32(track.FolderDepth);
+					trackRow.Int32(static_cast<int32_t>(track.MediaItems.size()));
+					trackRow.Int32(static_cast<int32_t>(track.FXChain.size()));
+					trackRow.EndRow();
+
+					for (size_t i = 0; i < track.MediaItems.size(); i++) {
+						const ReaMediaItem& item = track.MediaItems[i];
+						const char* type = Json::MediaType(item.Type);
+						ReaTable& itemRow = tables.Items;
+						itemRow.Int32(index);
+						itemRow.Int32(static_cast<int32_t>(t));
+						itemRow.Int32(static_cast<int32_t>(i));
+						itemRow.String(item.Name);
+						itemRow.String(type, strlen(type));
+						itemRow.String(item.Filepath);
+						itemRow.Float32(item.Start);
+						itemRow.Float32(item.End);
+						itemRow.Float32(item.Length);
+						itemRow.Float32(item.StartOffset);
+						itemRow.Float32(item.RawVolume);
+						itemRow.Float32(item.RawPan);
+						itemRow.Bool(item.Muted);
+						itemRow.EndRow();
+					}
+
+					for (size_t i = 0; i < track.FXChain.size(); i++) {
+						const ReaFX& effect = track.FXChain[i];
+						const char* type = Json::FXType(effect.Type);
+						ReaTable& fxRow = tables.FX;
+						fxRow.Int32(index);
+						fxRow.Int32(static_cast<int32_t>(t));
+						fxRow.Int32(static_cast<int32_t>(i));
+						fxRow.String(effect.Name);
+						fxRow.String(type, strlen(type));
+						fxRow.String(effect.Filepath);
+						if (options.FXData)
+							fxRow.String(effect.Data);
+						fxRow.EndRow();
+					}
+				}
+			}
+			return tables;
+		}
+	}
+
+	REAPARSER_API size_t ReaColumn::Width() const {
+		switch (Type) {
+		case ReaColumnType::Bool: return 1;
+		case ReaColumnType::Int32: case ReaColumnType::Float32: return 4;
+		case ReaColumnType::Int64: case ReaColumnType::Float64: return 8;
+		default: return 0;
+		}
+	}
+
+	REAPARSER_API const ReaColumn* ReaTable::Column(const std::string& name) const {
+		for (auto& column : m_columns) {
+			if (column.Name == name)
+				return &column;
+		}
+		return nullptr;
+	}
+
+	REAPARSER_API void ReaTable::AddColumn(const std::string& name, ReaColumnType type) {
+		if (m_rows || m_next)
+			throw Exception("Unable to add column " + name + " to table " + m_name + " with rows");
+		ReaColumn column;
+		column.Name = name;
+		column.Type = type;
+		if (type == ReaColumnType::String)
+			column.Offsets.push_back(0);
+		m_columns.push_back(std::move(column));
+	}
+
+	REAPARSER_API void ReaTable::Reserve(size_t rows) {
+		for (auto& column : m_columns) {
+			if (column.Type == ReaColumnType::String)
+				column.Offsets.reserve(column.Offsets.size() + rows);
+			else
+				column.Data.reserve(column.Data.size() + rows * column.Width());
+		}
+	}
+
+	REAPARSER_API ReaColumn& ReaTable::Next(ReaColumnType type) {
+		if (m_next == m_columns.size())
+			throw Exception("Row " + std::to_string(m_rows) + " of table " + m_name + " has too many values");
+		if (m_columns[m_next].Type != type)
+			throw Exception("Value of the wrong type for column " + m_columns[m_next].Name + " of table " + m_name);
+		return m_columns[m_next++];
+	}
+
+	REAPARSER_API void ReaTable::Bool(bool value) {
+		Next(ReaColumnType::Bool).Data.push_back(value ? 1 : 0);
+	}
+
+	REAPARSER_API void ReaTable::Int32(int32_t value) {
+		std::vector<char>& data = Next(ReaColumnType::Int32).Data;
+		data.insert(data.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value + 1));
+	}
+
+	REAPARSER_API void ReaTable::Int64(int64_t value) {
+		std::vector<char>& data = Next(ReaColumnType::Int64).Data;
+		data.insert(data.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value + 1));
+	}
+
+	REAPARSER_API void ReaTable::Float32(float value) {
+		std::vector<char>& data = Next(ReaColumnType::Float32).Data;
+		data.insert(data.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value + 1));
+	}
+
+	REAPARSER_API void ReaTable::Float64(double value) {
+		std::vector<char>& data = Next(ReaColumnType::Float64).Data;
+		data.insert(data.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value + 1));
+	}
+
+	REAPARSER_API void ReaTable::String(const char* value, size_t size) {
+		ReaColumn& column = Next(ReaColumnType::String);
+		column.Data.insert(column.Data.end(), value, value + size);
+		column.Offsets.push_back(column.Data.size());
+	}
+
+	REAPARSER_API void ReaTable::EndRow() {
+		if (m_next != m_columns.size())
+			throw Exception("Row " + std::to_string(m_rows) + " of table " + m_name + " is missing values");
+		m_next = 0;
+		m_rows++;
+	}
+
+	REAPARSER_API ReaArrowTables ProjectTables(const ReaProject& project, const ReaArrowOptions& options) {
+		const ReaProject* projects[] = { &project };
+		return Arrow::Tables(projects, 1, options);
+	}
+
+	REAPARSER_API ReaArrowTables ProjectTables(const std::vector<ReaProject>& projects, const ReaArrowOptions& options) {
+		std::vector<const ReaProject*> pointers;
+		for (auto& project : projects)
+			pointers.push_back(&project);
+		return Arrow::Tables(pointers.data(), pointers.size(), options);
+	}
+
+	REAPARSER_API void WriteArrowFile(const ReaTable& table, int fd, const ReaArrowOptions& options) {
+		Arrow::Output output(fd, options.BufferSize);
+		output.Write("ARROW1\0\0", 8);
+		output.Message(Arrow::SchemaMessage(table));
+
+		struct Block {
+			int64_t Offset, BodyLength;
+			int32_t MetadataLength;
+		};
+		std::vector<Block> blocks;
+
+		size_t batchRows = std::max<size_t>(options.BatchRows, 1);
+		for (size_t begin = 0; begin < table.Rows();) {
+			size_t end = std::min(table.Rows(), begin + batchRows);
+
+			// String offsets are 32 bit, so a batch's strings have to fit in 2 GB
+			for (auto& column : table.Columns()) {
+				if (column.Type != ReaColumnType::String)
+					continue;
+				uint64_t limit = column.Offsets[begin] + INT32_MAX;
+				auto fits = std::upper_bound(column.Offsets.begin() + begin, column.Offsets.begin() + end + 1, limit);
+				end = std::min(end, static_cast<size_t>(fits - column.Offsets.begin()) - 1);
+				if (end == begin)
+					throw Exception("Unable to write Arrow file: a string over 2 GB in column " + column.Name);
+			}
+
+			std::vector<uint64_t> buffers = Arrow::BufferSizes(table, begin, end);
+			Block block;
+			block.Offset = static_cast<int64_t>(output.Position());
+			block.MetadataLength = output.Message(Arrow::RecordBatchMessage(table, end - begin, buffers, block.BodyLength));
+			for (auto& column : table.Columns())
+				Arrow::WriteColumn(output, column, begin, end);
+			blocks.push_back(block);
+			begin = end;
+		}
+
+		// End of the stream, then a footer with the schema again and where each batch starts
+		output.Put<uint32_t>(0xffffffffu);
+		output.Put<int32_t>(0);
+
+		Arrow::FlatBuilder footer;
+		footer.StartTable();
+		footer.Add<int16_t>(0, Arrow::MetadataV5);
+		footer.AddOffset(1); // Schema
+		footer.AddOffset(2); // Dictionaries
+		footer.AddOffset(3); // Record batches
+		footer.Link(0, footer.EndTable());
+		size_t schema = footer.FieldPosition(1), dictionaries = footer.FieldPosition(2), batches = footer.FieldPosition(3);
+		footer.Link(schema, Arrow::WriteSchema(footer, table));
+		footer.Link(dictionaries, footer.Vector(0, 24, 8));
+		size_t vector = footer.Vector(blocks.size(), 24, 8);
+		footer.Link(batches, vector);
+		for (size_t i = 0; i < blocks.size(); i++) {
+			footer.Put<int64_t>(vector + 4 + 24 * i, blocks[i].Offset);
+			footer.Put<int32_t>(vector + 12 + 24 * i, blocks[i].MetadataLength);
+			footer.Put<int64_t>(vector + 20 + 24 * i, blocks[i].BodyLength);
+		}
+
+		output.Write(footer.Data.data(), footer.Data.size());
+		output.Put<int32_t>(static_cast<int32_t>(footer.Data.size()));
+		output.Write("ARROW1", 6);
+		output.Flush();
+	}
+
+	REAPARSER_API void WriteArrowFile(const ReaTable& table, const std::string& filepath, const ReaArrowOptions& options) {
+		Json::WriteOutput(filepath, "Unable to write Arrow file: ", [&](int fd) { WriteArrowFile(table, fd, options); });
+	}
+
+	REAPARSER_API std::vector<std::string> ExportArrow(const std::vector<ReaProject>& projects, const ReaArrowOptions& options) {
+		ReaArrowTables tables = ProjectTables(projects, options);
+		std::vector<std::string> filepaths;
+		for (const ReaTable* table : { &tables.Projects, &tables.Tracks, &tables.Items, &tables.FX }) {
+			filepaths.push_back(options.Directory + "/" + options.Prefix + "-" + table->Name() + ".arrow");
+			WriteArrowFile(*table, filepaths.back(), options);
+		}
+		return filepaths;
+	}
+#endif
+}
@@ -0,0 +1,506 @@
+#pragma once
+
+#include "ReaParser.h"
+
+#include <unordered_map>
+
+// Corpus statistics: counters, histograms and quantile sketches summarizing many projects.
+// Each summary merges with another of its kind, so workers summarize their share of the
+// projects on their own and the results are combined after, or across separate runs.
+
+namespace ReaParser {
+
+	// Occurrences of each key, such as plugin names
+	class ReaCounter {
+	public:
+		void Add(const std::string& key, uint64_t count = 1);
+		void Merge(const ReaCounter& other);
+
+		uint64_t Count(const std::string& key) const;
+		uint64_t Total() const { return m_total; }
+		size_t Size() const { return m_counts.size(); }
+		const std::unordered_map<std::string, uint64_t>& Counts() const { return m_counts; }
+
+		// The n most frequent keys, most frequent first, ties by key
+		std::vector<std::pair<std::string, uint64_t>> Top(size_t n) const;
+
+	private:
+		std::unordered_map<std::string, uint64_t> m_counts;
+		uint64_t m_total = 0;
+	};
+
+	// Values counted in fixed buckets. Counts()[0] is below the first edge, Counts()[i] in
+	// [Edges()[i - 1], Edges()[i]) and the last at or above the last edge. Only histograms
+	// with the same edges merge.
+	class ReaHistogram {
+	public:
+		ReaHistogram() : ReaHistogram(std::vector<double>()) {}
+		explicit ReaHistogram(std::vector<double> edges);
+
+		// buckets equal buckets between min and max, or growing by the same ratio
+		static ReaHistogram Linear(double min, double max, size_t buckets);
+		static ReaHistogram Logarithmic(double min, double max, size_t buckets);
+
+		void Add(double value, uint64_t count = 1);
+
+		// Throws Exception if the edges differ
+		void Merge(const ReaHistogram& other);
+
+		const std::vector<double>& Edges() const { return m_edges; }
+		const std::vector<uint64_t>& Counts() const { return m_counts; }
+		uint64_t Total() const { return m_total; }
+
+	private:
+		std::vector<double> m_edges;
+		std::vector<uint64_t> m_counts;
+		uint64_t m_total = 0;
+
+		friend struct ReaCorpusStats;
+	};
+
+	// Approximate quantiles within a relative error, as in DDSketch. Values are counted in
+	// buckets whose bounds grow by (1 + accuracy) / (1 - accuracy), so any quantile comes
+	// back within accuracy of the true value, merging loses nothing, and memory grows with
+	// the log of the range of the values rather than their number.
+	class ReaQuantileSketch {
+	public:
+		explicit ReaQuantileSketch(double accuracy = 0.01);
+
+		void Add(double value, uint64_t count = 1);
+
+		// Throws Exception if the accuracies differ
+		void Merge(const ReaQuantileSketch& other);
+
+		// Value at rank q * (Count() - 1), 0 if empty
+		double Quantile(double q) const;
+
+		double Accuracy() const { return m_accuracy; }
+		uint64_t Count() const { return m_count; }
+		double Min() const { return m_count ? m_min : 0.0; }
+		double Max() const { return m_count ? m_max : 0.0; }
+		double Sum() const { return m_sum; }
+		double Mean() const { return m_count ? m_sum / m_count : 0.0; }
+
+		// Buckets in use, the sketch's memory footprint
+		size_t Buckets() const { return m_positive.Counts.size() + m_negative.Counts.size(); }
+
+	private:
+		// Counts of consecutive bucket indices from Offset
+		struct Store {
+			std::vector<uint64_t> Counts;
+			int Offset = 0;
+			void Add(int index, uint64_t count);
+		};
+
+		// Magnitudes below this count as zero, bounding the number of buckets
+		static constexpr double MinMagnitude = 1e-9;
+
+		double m_accuracy, m_logGamma;
+		Store m_positive, m_negative;
+		uint64_t m_zero = 0, m_count = 0;
+		double m_min = DBL_MAX, m_max = -DBL_MAX, m_sum = 0.0;
+
+		int Index(double magnitude) const { return static_cast<int>(ceil(log(magnitude) / m_logGamma)); }
+		double Value(int index) const;
+
+		friend struct ReaCorpusStats;
+	};
+
+	// Summary of a set of projects
+	struct ReaCorpusStats {
+		uint64_t Projects = 0, Failures = 0;
+		uint64_t Tracks = 0, Items = 0, Plugins = 0;
+
+		ReaCounter PluginNames, PluginTypes;
+		ReaCounter SampleRates;
+		ReaCounter Versions; // "6.53 Windows"
+
+		ReaQuantileSketch TracksPerProject;
+		ReaQuantileSketch ProjectLengths; // End of the last item, in seconds
+		ReaQuantileSketch ItemLengths;    // In seconds
+		ReaHistogram ItemLengthHistogram = ReaHistogram::Logarithmic(0.01, 3600.0, 22);
+
+		void Add(const ReaProject& project);
+
+		// Throws Exception if the histograms' edges or sketches' accuracies differ
+		void Merge(const ReaCorpusStats& other);
+
+		// Saves the summary as text, to be merged into another by Load
+		bool Save(const std::string& filepath) const;
+
+		// Merges a summary saved by Save, returns false if the file can't be read or parsed
+		bool Load(const std::string& filepath);
+	};
+
+	// Loads and summarizes projects on a pool of worker threads (0 for one per hardware
+	// thread), each keeping its own summary until they're merged at the end. Projects that
+	// fail to load are counted in Failures.
+	REAPARSER_API ReaCorpusStats CollectCorpusStats(const std::vector<std::string>& filepaths,
+		ReaOptions options = ReaOptions(), unsigned int threads = 0);
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	REAPARSER_API void ReaCounter::Add(const std::string& key, uint64_t count) {
+		m_counts[key] += count;
+		m_total += count;
+	}
+
+	REAPARSER_API void ReaCounter::Merge(const ReaCounter& other) {
+		for (auto& entry : other.m_counts)
+			m_counts[entry.first] += entry.second;
+		m_total += other.m_total;
+	}
+
+	REAPARSER_API uint64_t ReaCounter::Count(const std::string& key) const {
+		auto it = m_counts.find(key);
+		return it == m_counts.end() ? 0 : it->second;
+	}
+
+	REAPARSER_API std::vector<std::pair<std::string, uint64_t>> ReaCounter::Top(size_t n) const {
+		std::vector<std::pair<std::string, uint64_t>> top(m_counts.begin(), m_counts.end());
+		auto order = [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		};
+		n = std::min(n, top.size());
+		std::partial_sort(top.begin(), top.begin() + n, top.end(), order);
+		top.resize(n);
+		return top;
+	}
+
+	REAPARSER_API ReaHistogram::ReaHistogram(std::vector<double> edges)
+		: m_edges(std::move(edges)), m_counts(m_edges.size() + 1, 0) {
+		std::sort(m_edges.begin(), m_edges.end());
+	}
+
+	REAPARSER_API ReaHistogram ReaHistogram::Linear(double min, double max, size_t buckets) {
+		std::vector<double> edges;
+		for (size_t i = 0; i <= buckets; i++)
+			edges.push_back(min + (max - min) * i / std::max<size_t>(buckets, 1));
+		return ReaHistogram(edges);
+	}
+
+	REAPARSER_API ReaHistogram ReaHistogram::Logarithmic(double min, double max, size_t buckets) {
+		std::vector<double> edges;
+		for (size_t i = 0; i <= buckets; i++)
+			edges.push_back(min * pow(max / min, static_cast<double>(i) / std::max<size_t>(buckets, 1)));
+		return ReaHistogram(edges);
+	}
+
+	REAPARSER_API void ReaHistogram::Add(double value, uint64_t count) {
+		m_counts[std::upper_bound(m_edges.begin(), m_edges.end(), value) - m_edges.begin()] += count;
+		m_total += count;
+	}
+
+	REAPARSER_API void ReaHistogram::Merge(const ReaHistogram& other) {
+		if (other.m_edges != m_edges)
+			throw Exception("Can't merge histograms with different buckets");
+		for (size_t i = 0; i < m_counts.size(); i++)
+			m_counts[i] += other.m_counts[i];
+		m_total += other.m_total;
+	}
+
+	REAPARSER_API ReaQuantileSketch::ReaQuantileSketch(double accuracy)
+		: m_accuracy(std::min(std::max(accuracy, 1e-6), 0.5)),
+		m_logGamma(log((1.0 + m_accuracy) / (1.0 - m_accuracy))) {}
+
+	REAPARSER_API void ReaQuantileSketch::Store::Add(int index, uint64_t count) {
+		if (Counts.empty())
+			Offset = index;
+		if (index < Offset) {
+			Counts.insert(Counts.begin(), static_cast<size_t>(Offset - index), 0);
+			Offset = index;
+		}
+		if (static_cast<size_t>(index - Offset) >= Counts.size())
+			Counts.resize(static_cast<size_t>(index - Offset) + 1, 0);
+		Counts[static_cast<size_t>(index - Offset)] += count;
+	}
+
+	// Middle of the bucket relative to its bounds, so its values are all within accuracy
+	REAPARSER_API double ReaQuantileSketch::Value(int index) const {
+		double gamma = exp(m_logGamma);
+		return 2.0 * exp(index * m_logGamma) / (gamma + 1.0);
+	}
+
+	REAPARSER_API void ReaQuantileSketch::Add(double value, uint64_t count) {
+		if (count == 0 || value != value)
+			return;
+
+		if (value > MinMagnitude)
+			m_positive.Add(Index(value), count);
+		else if (value < -MinMagnitude)
+			m_negative.Add(Index(-value), count);
+		else
+			m_zero += count;
+
+		m_count += count;
+		m_sum += value * count;
+		m_min = std::min(m_min, value);
+		m_max = std::max(m_max, value);
+	}
+
+	REAPARSER_API void ReaQuantileSketch::Merge(const ReaQuantileSketch& other) {
+		if (other.m_accuracy != m_accuracy)
+			throw Exception("Can't merge quantile sketches of different accuracy");
+
+		for (size_t i = 0; i < other.m_positive.Counts.size(); i++) {
+			if (other.m_positive.Counts[i])
+				m_positive.Add(other.m_positive.Offset + static_cast<int>(i), other.m_positive.Counts[i]);
+		}
+		for (size_t i = 0; i < other.m_negative.Counts.size(); i++) {
+			if (other.m_negative.Counts[i])
+				m_negative.Add(other.m_negative.Offset + static_cast<int>(i), other.m_negative.Counts[i]);
+		}
+		m_zero += other.m_zero;
+		m_count += other.m_count;
+		m_sum += other.m_sum;
+		m_min = std::min(m_min, other.m_min);
+		m_max = std::max(m_max, other.m_max);
+	}
+
+	REAPARSER_API double ReaQuantileSketch::Quantile(double q) const {
+		if (m_count == 0)
+			return 0.0;
+
+		// Walk the buckets from the most negative value up until past the rank
+		double rank = std::min(std::max(q, 0.0), 1.0) * (m_count - 1);
+		uint64_t seen = 0;
+		double value = m_max;
+		bool found = false;
+
+		for (size_t i = m_negative.Counts.size(); i-- > 0 && !found;) {
+			seen += m_negative.Counts[i];
+			if (seen > rank) {
+				value = -Value(m_negative.Offset + static_cast<int>(i));
+				found = true;
+			}
+		}
+		if (!found && (seen += m_zero) > rank) {
+			value = 0.0;
+			found = true;
+		}
+		for (size_t i = 0; i < m_positive.Counts.size() && !found; i++) {
+			seen += m_positive.Counts[i];
+			if (seen > rank) {
+				value = Value(m_positive.Offset + static_cast<int>(i));
+				found = true;
+			}
+		}
+		return std::min(std::max(value, m_min), m_max);
+	}
+
+	REAPARSER_API void ReaCorpusStats::Add(const ReaProject& project) {
+		Projects++;
+		Tracks += project.Tracks.size();
+		TracksPerProject.Add(static_cast<double>(project.Tracks.size()));
+		SampleRates.Add(std::to_string(project.SampleRate));
+
+		ReaVersion version = project.Version;
+		Versions.Add(std::to_string(version.Major) + "." + std::to_string(version.Minor) + " " + version.PlatformString());
+
+		static const char* types[] = { "Undefined", "VST", "VST3", "VSTi", "VST3i", "AU", "AUi", "JS" };
+		double length = 0.0;
+		for (auto& track : project.Tracks) {
+			Items += track.MediaItems.size();
+			for (auto& item : track.MediaItems) {
+				ItemLengths.Add(item.Length);
+				ItemLengthHistogram.Add(item.Length);
+				length = std::max(length, static_cast<double>(item.End));
+			}
+
+			Plugins += track.FXChain.size();
+			for (auto& fx : track.FXChain) {
+				PluginNames.Add(fx.Name);
+				size_t type = static_cast<size_t>(fx.Type);
+				PluginTypes.Add(type < sizeof(types) / sizeof(types[0]) ? types[type] : types[0]);
+			}
+		}
+		ProjectLengths.Add(length);
+	}
+
+	REAPARSER_API void ReaCorpusStats::Merge(const ReaCorpusStats& other) {
+		Projects += other.Projects;
+		Failures += other.Failures;
+		Tracks += other.Tracks;
+		Items += other.Items;
+		Plugins += other.Plugins;
+		PluginNames.Merge(other.PluginNames);
+		PluginTypes.Merge(other.PluginTypes);
+		SampleRates.Merge(other.SampleRates);
+		Versions.Merge(other.Versions);
+		TracksPerProject.Merge(other.TracksPerProject);
+		ProjectLengths.Merge(other.ProjectLengths);
+		ItemLengths.Merge(other.ItemLengths);
+		ItemLengthHistogram.Merge(other.ItemLengthHistogram);
+	}
+
+	// One value per line, tab-separated: the kind of summary, its name, then its contents.
+	// Counter keys come last on their line, so they may hold tabs but not line breaks.
+	REAPARSER_API bool ReaCorpusStats::Save(const std::string& filepath) const {
+		FILE* fp = fopen(filepath.c_str(), "wb");
+		if (!fp)
+			return false;
+
+		fprintf(fp, "totals\t%llu\t%llu\t%llu\t%llu\t%llu\n", static_cast<unsigned long long>(Projects),
+			static_cast<unsigned long long>(Failures), static_cast<unsigned long long>(Tracks),
+			static_cast<unsigned long long>(Items), static_cast<unsigned long long>(Plugins));
+
+		const std::pair<const char*, const ReaCounter*> counters[] = {
+			{ "PluginNames", &PluginNames }, { "PluginTypes", &PluginTypes }, { "SampleRates", &SampleRates }, { "Versions", &Versions }
+		};
+		for (auto& counter : counters) {
+			for (auto& entry : counter.second->Counts()) {
+				if (entry.first.find('\n') == std::string::npos)
+					fprintf(fp, "counter\t%s\t%llu\t%s\n", counter.first, static_cast<unsigned long long>(entry.second), entry.first.c_str());
+			}
+		}
+
+		const std::pair<const char*, const ReaQuantileSketch*> sketches[] = {
+			{ "TracksPerProject", &TracksPerProject }, { "ProjectLengths", &ProjectLengths }, { "ItemLengths", &ItemLengths }
+		};
+		for (auto& sketch : sketches) {
+			const ReaQuantileSketch& s = *sketch.second;
+			fprintf(fp, "sketch\t%s\t%.17g\t%llu\t%llu\t%.17g\t%.17g\t%.17g", sketch.first, s.m_accuracy,
+				static_cast<unsigned long long>(s.m_count), static_cast<unsigned long long>(s.m_zero), s.m_min, s.m_max, s.m_sum);
+			for (const ReaQuantileSketch::Store* store : { &s.m_positive, &s.m_negative }) {
+				fprintf(fp, "\t%i\t%zu", store->Offset, store->Counts.size());
+				for (uint64_t count : store->Counts)
+					fprintf(fp, "\t%llu", static_cast<unsigned long long>(count));
+			}
+			fprintf(fp, "\n");
+		}
+
+		fprintf(fp, "histogram\tItemLengthHistogram\t%zu", ItemLengthHistogram.Edges().size());
+		for (double edge : ItemLengthHistogram.Edges())
+			fprintf(fp, "\t%.17g", edge);
+		for (uint64_t count : ItemLengthHistogram.Counts())
+			fprintf(fp, "\t%llu", static_cast<unsigned long long>(count));
+		fprintf(fp, "\n");
+
+		return fclose(fp) == 0;
+	}
+
+	REAPARSER_API bool ReaCorpusStats::Load(const std::string& filepath) {
+		FILE* fp = fopen(filepath.c_str(), "rb");
+		if (!fp)
+			return false;
+
+		// Parsed into a summary of its own and only merged once all of it has been read
+		ReaCorpusStats loaded;
+		std::string line;
+		bool ok = true;
+		for (int c = fgetc(fp); ok && c != EOF; c = fgetc(fp)) {
+			if (c != '\n') {
+				line += static_cast<char>(c);
+				continue;
+			}
+
+			const char* p = line.c_str();
+			char kind[16] = {}, name[32] = {};
+			int used = 0;
+			ok = sscanf(p, "%15[^\t]\t%n", kind, &used) == 1 && used > 0;
+			p += used;
+
+			if (ok && strcmp(kind, "totals") == 0) {
+				unsigned long long values[5];
+				ok = sscanf(p, "%llu\t%llu\t%llu\t%llu\t%llu", &values[0], &values[1], &values[2], &values[3], &values[4]) == 5;
+				loaded.Projects = values[0];
+				loaded.Failures = values[1];
+				loaded.Tracks = values[2];
+				loaded.Items = values[3];
+				loaded.Plugins = values[4];
+			}
+			else if (ok && strcmp(kind, "counter") == 0) {
+				unsigned long long count = 0;
+				ok = sscanf(p, "%31[^\t]\t%llu\t%n", name, &count, &used) == 2 && used > 0;
+				ReaCounter* counter = strcmp(name, "PluginNames") == 0 ? &loaded.PluginNames :
+					strcmp(name, "PluginTypes") == 0 ? &loaded.PluginTypes :
+					strcmp(name, "SampleRates") == 0 ? &loaded.SampleRates :
+					strcmp(name, "Versions") == 0 ? &loaded.Versions : nullptr;
+				if (ok && counter)
+					counter->Add(p + used, count);
+			}
+			else if (ok && strcmp(kind, "sketch") == 0) {
+				double accuracy = 0.0, min = 0.0, max = 0.0, sum = 0.0;
+				unsigned long long count = 0, zero = 0;
+				ok = sscanf(p, "%31[^\t]\t%lf\t%llu\t%llu\t%lf\t%lf\t%lf%n", name, &accuracy, &count, &zero, &min, &max, &sum, &used) == 7;
+				ReaQuantileSketch s(accuracy);
+				s.m_count = count;
+				s.m_zero = zero;
+				s.m_min = min;
+				s.m_max = max;
+				s.m_sum = sum;
+				p += used;
+
+				for (ReaQuantileSketch::Store* store : { &s.m_positive, &s.m_negative }) {
+					size_t size = 0;
+					ok = ok && sscanf(p, "\t%i\t%zu%n", &store->Offset, &size, &used) == 2 && size <= (1u << 20);
+					p += ok ? used : 0;
+					for (size_t i = 0; ok && i < size; i++) {
+						unsigned long long bucket = 0;
+						ok = sscanf(p, "\t%llu%n", &bucket, &used) == 1;
+						p += used;
+						store->Counts.push_back(bucket);
+					}
+				}
+
+				ReaQuantileSketch* sketch = strcmp(name, "TracksPerProject") == 0 ? &loaded.TracksPerProject :
+					strcmp(name, "ProjectLengths") == 0 ? &loaded.ProjectLengths :
+					strcmp(name, "ItemLengths") == 0 ? &loaded.ItemLengths : nullptr;
+				if (ok && sketch)
+					*sketch = s;
+			}
+			else if (ok && strcmp(kind, "histogram") == 0) {
+				size_t size = 0;
+				ok = sscanf(p, "%31[^\t]\t%zu%n", name, &size, &used) == 2 && size <= (1u << 20);
+				p += ok ? used : 0;
+				std::vector<double> edges(ok ? size : 0);
+				for (size_t i = 0; ok && i < size; i++) {
+					ok = sscanf(p, "\t%lf%n", &edges[i], &used) == 1;
+					p += used;
+				}
+
+				ReaHistogram histogram(edges);
+				for (size_t i = 0; ok && i <= size; i++) {
+					unsigned long long count = 0;
+					ok = sscanf(p, "\t%llu%n", &count, &used) == 1;
+					p += used;
+					histogram.m_counts[i] = count;
+					histogram.m_total += count;
+				}
+				if (ok && strcmp(name, "ItemLengthHistogram") == 0)
+					loaded.ItemLengthHistogram = histogram;
+			}
+			line.clear();
+		}
+		fclose(fp);
+
+		if (!ok || !line.empty())
+			return false;
+		Merge(loaded);
+		return true;
+	}
+
+	REAPARSER_API ReaCorpusStats CollectCorpusStats(const std::vector<std::string>& filepaths,
+		ReaOptions options, unsigned int threads) {
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		threads = std::max(1u, static_cast<unsigned int>(std::min<size_t>(threads, filepaths.size())));
+
+		// A summary per worker, so adding a project never waits on another thread
+		std::vector<ReaCorpusStats> partial(threads);
+		ForEachProjectFile(filepaths, options, [&](size_t, unsigned int worker, ReaProject& project, const std::string& error) {
+			if (error.empty())
+				partial[worker].Add(project);
+			else
+				partial[worker].Failures++;
+		}, threads);
+
+		for (unsigned int i = 1; i < threads; i++)
+			partial[0].Merge(partial[i]);
+		return partial[0];
+	}
+#endif
+}
@@ -0,0 +1,738 @@
+#pragma once
+
+#include "ReaParser.h"
+
+#include <fcntl.h>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// JSON export: writes projects as JSON text straight from the parsed structures, without
+// building a document in memory first. Output is buffered and written a large block at a
+// time to a file descriptor or appended to a string.
+
+namespace ReaParser {
+
+	struct ReaJsonOptions {
+		// Include FX state, base64 blobs that are often most of a project's size
+		bool FXData = true;
+
+		// Bytes buffered between writes
+		size_t BufferSize = 1 << 20;
+	};
+
+	// Streams JSON values, adding the commas between them. Strings are taken as UTF-8 and
+	// only quotes, backslashes and control characters are escaped.
+	class ReaJsonWriter {
+	public:
+		// Writes to fd, which stays open
+		explicit ReaJsonWriter(int fd, size_t bufferSize = 1 << 20);
+
+		// Appends to out
+		explicit ReaJsonWriter(std::string& out, size_t bufferSize = 1 << 16);
+
+		ReaJsonWriter(const ReaJsonWriter&) = delete;
+		~ReaJsonWriter();
+
+		void BeginObject();
+		void EndObject();
+		void BeginArray();
+		void EndArray();
+
+		void Key(const char* key);
+		void String(const char* value, size_t size);
+		void String(const std::string& value) { String(value.data(), value.size()); }
+
+		// Shortest text that reads back as the same float, null if not finite
+		void Number(float value);
+		void Number(double value);
+		void Integer(int64_t value);
+		void Bool(bool value);
+		void Null();
+
+		// Text written as is, such as the line breaks between NDJSON records. Ends the current value.
+		void Raw(const char* text, size_t size);
+
+		// Writes out the buffer, throws Exception if it can't be written
+		void Flush();
+
+		// Bytes written or buffered so far
+		uint64_t Size() const { return m_written + m_used; }
+
+	private:
+		int m_fd = -1;
+		std::string* m_out = nullptr;
+		std::vector<char> m_buffer;
+		size_t m_used = 0;
+		uint64_t m_written = 0;
+		bool m_comma = false;
+
+		void Separate() {
+			if (m_comma)
+				Put(',');
+			m_comma = true;
+		}
+
+		void Put(char c) {
+			if (m_used == m_buffer.size())
+				Flush();
+			m_buffer[m_used++] = c;
+		}
+
+		void Append(const char* data, size_t size);
+	};
+
+	// Writes project as a JSON object
+	REAPARSER_API void WriteProjectJson(ReaJsonWriter& writer, const ReaProject& project,
+		const ReaJsonOptions& options = ReaJsonOptions());
+
+	// Writes project as JSON to fd or a file, throws Exception if it can't be written
+	REAPARSER_API void ExportProjectJson(const ReaProject& project, int fd, const ReaJsonOptions& options = ReaJsonOptions());
+	REAPARSER_API void ExportProjectJson(const ReaProject& project, const std::string& filepath,
+		const ReaJsonOptions& options = ReaJsonOptions());
+
+	REAPARSER_API std::string ProjectToJson(const ReaProject& project, const ReaJsonOptions& options = ReaJsonOptions());
+
+	struct ReaNdjsonOptions {
+		// Shards are written to Directory as <Prefix>-<worker>-<sequence>.ndjson
+		std::string Directory = ".";
+		std::string Prefix = "reaparser";
+
+		// A worker starts its next shard once its current one holds this many bytes, 0 for no limit
+		uint64_t MaxShardBytes = 256ull << 20;
+
+		// Kinds of records written
+		bool Tracks = true, Items = true, FX = true;
+
+		ReaJsonOptions Json;
+
+		// Worker threads, each loading projects and writing shards of its own.
+		// 0 for one per hardware thread.
+		unsigned int Threads = 0;
+	};
+
+	struct ReaNdjsonResult {
+		uint64_t Projects = 0, Records = 0, Bytes = 0;
+
+		// Shards written, by worker then sequence
+		std::vector<std::string> Shards;
+
+		// "filepath: reason" for each project that failed to load
+		std::vector<std::string> Errors;
+	};
+
+	// Loads projects with ForEachProjectFile and writes a JSON object per line for each of
+	// their tracks, items and FX, tagged with "kind", the project's filepath and the
+	// indices of the track and of the item or FX. Each worker writes its own shards, so
+	// writing never waits on another thread. Throws Exception if a shard can't be written.
+	REAPARSER_API ReaNdjsonResult ExportNdjson(const std::vector<std::string>& filepaths,
+		const ReaNdjsonOptions& options = ReaNdjsonOptions(), ReaOptions loadOptions = ReaOptions());
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	namespace Json {
+		// Creates or truncates filepath for writing, -1 if it can't be
+		inline int OpenOutput(const std::string& filepath) {
+#ifdef _WIN32
+			return _open(filepath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+			return open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+		}
+
+		// False if the file's last writes failed
+		inline bool CloseOutput(int fd) {
+#ifdef _WIN32
+			return _close(fd) == 0;
+#else
+			return close(fd) == 0;
+#endif
+		}
+
+		// Hands write the descriptor of filepath, created for it and closed after. Throws
+		// Exception with error and the path if the file can't be opened or closed.
+		template <class Write>
+		void WriteOutput(const std::string& filepath, const char* error, const Write& write) {
+			int fd = OpenOutput(filepath);
+			if (fd < 0)
+				throw Exception(error + filepath);
+
+			try {
+				write(fd);
+			}
+			catch (...) {
+				CloseOutput(fd);
+				throw;
+			}
+
+			if (!CloseOutput(fd))
+				throw Exception(error + filepath);
+		}
+
+		// Length of the run at the start of text that needs no escaping, 16 bytes at a time
+		inline size_t CleanRun(const char* text, size_t size) {
+			size_t i = 0;
+#ifdef REAPARSER_SSE2
+			const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), control = _mm_set1_epi8(0x1f);
+			for (; i + 16 <= size; i += 16) {
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+				__m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)),
+					_mm_cmpeq_epi8(_mm_max_epu8(bytes, control), control)); // Bytes up to 0x1f
+				int mask = _mm_movemask_epi8(special);
+				if (mask) {
+					while (!(mask & 1)) {
+						mask >>= 1;
+						i++;
+					}
+					return i;
+				}
+			}
+#endif
+			for (; i < size; i++) {
+				unsigned char c = static_cast<unsigned char>(text[i]);
+				if (c < 0x20 || c == '"' || c == '\\')
+					break;
+			}
+			return i;
+		}
+
+		// Digits of value into the end of buffer, returns where they start
+		inline char* FormatUnsigned(uint64_t value, char* end) {
+			do {
+				*--end = static_cast<char>('0' + value % 10);
+				value /= 10;
+			} while (value);
+			return end;
+		}
+
+		// Shortest decimal that reads back as value, of up to the 9 significant digits a float
+		// needs, scaling in double precision. out must hold 32 characters.
+		inline size_t FormatFloat(float value, char* out) {
+			if (value == 0.0f) {
+				out[0] = '0';
+				return 1;
+			}
+
+			static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+				1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+			double magnitude = fabs(static_cast<double>(value));
+
+			// Plain notation covers what projects hold, anything else goes through printf with
+			// the fewest significant digits that read back
+			if (magnitude < 1e-5 || magnitude >= 1e15) {
+				int length = 0;
+				for (int digits = 1; digits <= 9; digits++) {
+					length = snprintf(out, 32, "%.*g", digits, value);
+					if (strtof(out, nullptr) == value)
+						break;
+				}
+				return static_cast<size_t>(length);
+			}
+
+			// Decimal exponent of the leading digit. Being off by one only costs a retry.
+			int exponent = 0;
+			if (magnitude >= 1.0) {
+				while (exponent < 14 && magnitude >= powers[exponent + 1])
+					exponent++;
+			}
+			else {
+				while (exponent > -5 && magnitude < 1.0 / powers[-exponent])
+					exponent--;
+			}
+
+			// Rounded to digits significant digits as mantissa / 10^decimals, decimals being
+			// negative for large values. Whether it reads back only ever improves with more
+			// digits, so the fewest that do are found by bisection.
+			uint64_t mantissa = 0;
+			int decimals = 0;
+			auto roundTrips = [&](int digits) {
+				decimals = digits - 1 - exponent;
+				double scale = decimals >= 0 ? powers[decimals] : 1.0 / powers[-decimals];
+				mantissa = static_cast<uint64_t>(magnitude * scale + 0.5);
+				double back = decimals >= 0 ? mantissa / powers[decimals] : mantissa * powers[-decimals];
+				return static_cast<float>(back) == static_cast<float>(magnitude);
+			};
+
+			int low = 1, high = 9;
+			while (low < high) {
+				int middle = (low + high) / 2;
+				if (roundTrips(middle))
+					high = middle;
+				else
+					low = middle + 1;
+			}
+
+			if (roundTrips(high)) {
+				char digitsBuffer[24];
+				char* end = digitsBuffer + sizeof(digitsBuffer);
+				char* start = FormatUnsigned(mantissa, end);
+				size_t length = static_cast<size_t>(end - start), size = 0;
+
+				if (value < 0.0f)
+					out[size++] = '-';
+				if (decimals <= 0) {
+					memcpy(out + size, start, length);
+					size += length;
+					memset(out + size, '0', static_cast<size_t>(-decimals));
+					return size + static_cast<size_t>(-decimals);
+				}
+
+				// Leading zeros for values below 1, then the point, dropping trailing zeros
+				if (static_cast<size_t>(decimals) >= length) {
+					out[size++] = '0';
+					out[size++] = '.';
+					memset(out + size, '0', static_cast<size_t>(decimals) - length);
+					size += static_cast<size_t>(decimals) - length;
+					memcpy(out + size, start, length);
+					size += length;
+				}
+				else {
+					size_t whole = length - static_cast<size_t>(decimals);
+					memcpy(out + size, start, whole);
+					size += whole;
+					out[size++] = '.';
+					memcpy(out + size, start + whole, static_cast<size_t>(decimals));
+					size += static_cast<size_t>(decimals);
+				}
+				while (out[size - 1] == '0')
+					size--;
+				if (out[size - 1] == '.')
+					size--;
+				return size;
+			}
+			return static_cast<size_t>(snprintf(out, 32, "%.9g", value));
+		}
+
+		inline bool WriteAll(int fd, const char* data, size_t size) {
+			while (size > 0) {
+#ifdef _WIN32
+				int written = _write(fd, data, static_cast<unsigned int>(std::min<size_t>(size, 1u << 30)));
+#else
+				ssize_t written = write(fd, data, size);
+#endif
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return false;
+				data += written;
+				size -= static_cast<size_t>(written);
+			}
+			return true;
+		}
+
+		inline const char* MediaType(ReaMediaType type) {
+			switch (type) {
+			case ReaMediaType::Sample: return "Sample";
+			case ReaMediaType::Midi: return "Midi";
+			default: return "Undefined";
+			}
+		}
+
+		inline const char* FXType(ReaFXType type) {
+			static const char* names[] = { "Undefined", "VST", "VST3", "VSTi", "VST3i", "AU", "AUi", "JS" };
+			size_t index = static_cast<size_t>(type);
+			return index < sizeof(names) / sizeof(names[0]) ? names[index] : names[0];
+		}
+
+		// Fields of an item, FX or track (without its items and FX) into the open object
+		inline void WriteItemFields(ReaJsonWriter& writer, const ReaMediaItem& item) {
+			writer.Key("name"); writer.String(item.Name);
+			writer.Key("type"); writer.String(MediaType(item.Type), strlen(MediaType(item.Type)));
+			writer.Key("filepath"); writer.String(item.Filepath);
+			writer.Key("start"); writer.Number(item.Start);
+			writer.Key("end"); writer.Number(item.End);
+			writer.Key("length"); writer.Number(item.Length);
+			writer.Key("startOffset"); writer.Number(item.StartOffset);
+			writer.Key("volume"); writer.Number(item.RawVolume);
+			writer.Key("pan"); writer.Number(item.RawPan);
+			writer.Key("muted"); writer.Bool(item.Muted);
+		}
+
+		inline void WriteFXFields(ReaJsonWriter& writer, const ReaFX& fx, const ReaJsonOptions& options) {
+			writer.Key("name"); writer.String(fx.Name);
+			writer.Key("type"); writer.String(FXType(fx.Type), strlen(FXType(fx.Type)));
+			writer.Key("filepath"); writer.String(fx.Filepath);
+			if (options.FXData) {
+				writer.Key("data");
+				writer.String(fx.Data);
+			}
+		}
+
+		inline void WriteTrackFields(ReaJsonWriter& writer, const ReaTrack& track) {
+			writer.Key("name"); writer.String(track.Name);
+			writer.Key("guid"); writer.String(track.GUID);
+			writer.Key("id"); writer.Integer(track.NumericID);
+			writer.Key("channels"); writer.Integer(track.Channels);
+			writer.Key("volume"); writer.Number(track.RawVolume);
+			writer.Key("pan"); writer.Number(track.RawPan);
+			writer.Key("muted"); writer.Bool(track.Muted);
+			writer.Key("phaseInverted"); writer.Bool(track.PhaseInverted);
+			writer.Key("folderDepth"); writer.Integer(track.FolderDepth);
+		}
+
+		// Fields of a project, without its tracks, into the open object
+		inline void WriteProjectFields(ReaJsonWriter& writer, const ReaProject& project) {
+			ReaVersion version = project.Version;
+			writer.Key("name"); writer.String(project.Name);
+			writer.Key("filepath"); writer.String(project.Filepath);
+			writer.Key("version");
+			writer.BeginObject();
+			writer.Key("major"); writer.Integer(version.Major);
+			writer.Key("minor"); writer.Integer(version.Minor);
+			writer.Key("platform"); writer.String(version.PlatformString());
+			writer.EndObject();
+			writer.Key("sampleRate"); writer.Integer(project.SampleRate);
+			writer.Key("tempo");
+			writer.BeginObject();
+			writer.Key("bpm"); writer.Number(project.Tempo.BPM);
+			writer.Key("beats"); writer.Integer(project.Tempo.Beats);
+			writer.Key("bars"); writer.Integer(project.Tempo.Bars);
+			writer.EndObject();
+			writer.Key("recordPath"); writer.String(project.RecordPath);
+			writer.Key("secondaryRecordPath"); writer.String(project.SecondaryRecordPath);
+		}
+	}
+
+	REAPARSER_API ReaJsonWriter::ReaJsonWriter(int fd, size_t bufferSize)
+		: m_fd(fd), m_buffer(std::max<size_t>(bufferSize, 64)) {}
+
+	REAPARSER_API ReaJsonWriter::ReaJsonWriter(std::string& out, size_t bufferSize)
+		: m_out(&out), m_buffer(std::max<size_t>(bufferSize, 64)) {}
+
+	REAPARSER_API ReaJsonWriter::~ReaJsonWriter() {
+		try {
+			Flush();
+		}
+		catch (Exception&) {}
+	}
+
+	REAPARSER_API void ReaJsonWriter::Flush() {
+		if (m_used == 0)
+			return;
+		size_t used = m_used;
+		m_used = 0;
+		m_written += used;
+
+		if (m_out)
+			m_out->append(m_buffer.data(), used);
+		else if (!Json::WriteAll(m_fd, m_buffer.data(), used))
+			throw Exception("Unable to write JSON: " + std::string(strerror(errno)));
+	}
+
+	REAPARSER_API void ReaJsonWriter::Append(const char* data, size_t size) {
+		if (m_used + size > m_buffer.size()) {
+			Flush();
+
+			// Larger than the buffer, so straight out
+			if (size >= m_buffer.size()) {
+				m_written += size;
+				if (m_out)
+					m_out->append(data, size);
+				else if (!Json::WriteAll(m_fd, data, size))
+					throw Exception("Unable to write JSON: " + std::string(strerror(errno)));
+				return;
+			}
+		}
+		memcpy(&m_buffer[m_used], data, size);
+		m_used += size;
+	}
+
+	REAPARSER_API void ReaJsonWriter::BeginObject() {
+		Separate();
+		Put('{');
+		m_comma = false;
+	}
+
+	REAPARSER_API void ReaJsonWriter::EndObject() {
+		Put('}');
+		m_comma = true;
+	}
+
+	REAPARSER_API void ReaJsonWriter::BeginArray() {
+		Separate();
+		Put('[');
+		m_comma = false;
+	}
+
+	REAPARSER_API void ReaJsonWriter::EndArray() {
+		Put(']');
+		m_comma = true;
+	}
+
+	REAPARSER_API void ReaJsonWriter::Key(const char* key) {
+		String(key, strlen(key));
+		Put(':');
+		m_comma = false;
+	}
+
+	REAPARSER_API void ReaJsonWriter::String(const char* value, size_t size) {
+		static const char hex[] = "0123456789abcdef";
+		Separate();
+		Put('"');
+		for (size_t i = 0; i < size;) {
+			size_t clean = Json::CleanRun(value + i, size - i);
+			Append(value + i, clean);
+			i += clean;
+			if (i == size)
+				break;
+
+			unsigned char c = static_cast<unsigned char>(value[i++]);
+			char escape[6] = { '\\', static_cast<char>(c), 0, 0, 0, 0 };
+			size_t length = 2;
+			switch (c) {
+			case '"': case '\\': break;
+			case '\n': escape[1] = 'n'; break;
+			case '\r': escape[1] = 'r'; break;
+			case '\t': escape[1] = 't'; break;
+			case '\b': escape[1] = 'b'; break;
+			case '\f': escape[1] = 'f'; break;
+			default:
+				memcpy(escape + 1, "u00", 3);
+				escape[4] = hex[c >> 4];
+				escape[5] = hex[c & 15];
+				length = 6;
+			}
+			Append(escape, length);
+		}
+		Put('"');
+	}
+
+	REAPARSER_API void ReaJsonWriter::Number(float value) {
+		if (!std::isfinite(value))
+			return Null();
+		char text[32];
+		Separate();
+		Append(text, Json::FormatFloat(value, text));
+	}
+
+	REAPARSER_API void ReaJsonWriter::Number(double value) {
+		if (!std::isfinite(value))
+			return Null();
+		char text[32];
+		Separate();
+		Append(text, static_cast<size_t>(snprintf(text, sizeof(text), "%.17g", value)));
+	}
+
+	REAPARSER_API void ReaJsonWriter::Integer(int64_t value) {
+		char text[24];
+		char* end = text + sizeof(text);
+		char* start = Json::FormatUnsigned(value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), end);
+		if (value < 0)
+			*--start = '-';
+		Separate();
+		Append(start, static_cast<size_t>(end - start));
+	}
+
+	REAPARSER_API void ReaJsonWriter::Bool(bool value) {
+		Separate();
+		Append(value ? "true" : "false", value ? 4 : 5);
+	}
+
+	REAPARSER_API void ReaJsonWriter::Null() {
+		Separate();
+		Append("null", 4);
+	}
+
+	REAPARSER_API void ReaJsonWriter::Raw(const char* text, size_t size) {
+		Append(text, size);
+		m_comma = false;
+	}
+
+	REAPARSER_API void WriteProjectJson(ReaJsonWriter& writer, const ReaProject& project, const ReaJsonOptions& options) {
+		writer.BeginObject();
+		Json::WriteProjectFields(writer, project);
+		writer.Key("tracks");
+		writer.BeginArray();
+		for (auto& track : project.Tracks) {
+			writer.BeginObject();
+			Json::WriteTrackFields(writer, track);
+			writer.Key("items");
+			writer.BeginArray();
+			for (auto& item : track.MediaItems) {
+				writer.BeginObject();
+				Json::WriteItemFields(writer, item);
+				writer.EndObject();
+			}
+			writer.EndArray();
+			writer.Key("fx");
+			writer.BeginArray();
+			for (auto& fx : track.FXChain) {
+				writer.BeginObject();
+				Json::WriteFXFields(writer, fx, options);
+				writer.EndObject();
+			}
+			writer.EndArray();
+			writer.EndObject();
+		}
+		writer.EndArray();
+		writer.EndObject();
+	}
+
+	REAPARSER_API void ExportProjectJson(const ReaProject& project, int fd, const ReaJsonOptions& options) {
+		ReaJsonWriter writer(fd, options.BufferSize);
+		WriteProjectJson(writer, project, options);
+		writer.Flush();
+	}
+
+	REAPARSER_API void ExportProjectJson(const ReaProject& project, const std::string& filepath, const ReaJsonOptions& options) {
+		Json::WriteOutput(filepath, "Unable to write JSON: ", [&](int fd) { ExportProjectJson(project, fd, options); });
+	}
+
+	REAPARSER_API std::string ProjectToJson(const ReaProject& project, const ReaJsonOptions& options) {
+		std::string out;
+		{
+			ReaJsonWriter writer(out, std::min<size_t>(options.BufferSize, 1 << 16));
+			WriteProjectJson(writer, project, options);
+		}
+		return out;
+	}
+	namespace Json {
+		// A worker's current shard, opened when its first record is written
+		struct Shard {
+			const ReaNdjsonOptions* Options = nullptr;
+			unsigned int Worker = 0, Sequence = 0;
+			int Fd = -1;
+			std::unique_ptr<ReaJsonWriter> Writer;
+			ReaNdjsonResult Result;
+
+			~Shard() {
+				try {
+					Close();
+				}
+				catch (Exception&) {}
+			}
+
+			void Close() {
+				if (!Writer)
+					return;
+				Writer->Flush();
+				Result.Bytes += Writer->Size();
+				Writer.reset();
+				bool closed = CloseOutput(Fd);
+				Fd = -1;
+				if (!closed)
+					throw Exception("Unable to write NDJSON shard: " + Result.Shards.back());
+			}
+
+			// Writer for the next record, on a new shard if the current one is full
+			ReaJsonWriter& Next() {
+				if (Writer && Options->MaxShardBytes && Writer->Size() >= Options->MaxShardBytes)
+					Close();
+
+				if (!Writer) {
+					std::string filepath = Options->Directory + "/" + Options->Prefix + "-" + std::to_string(Worker) + "-" +
+						std::to_string(Sequence++) + ".ndjson";
+					Fd = OpenOutput(filepath);
+					if (Fd < 0)
+						throw Exception("Unable to write NDJSON shard: " + filepath);
+					Writer.reset(new ReaJsonWriter(Fd, Options->Json.BufferSize));
+					Result.Shards.push_back(filepath);
+				}
+
+				Result.Records++;
+				return *Writer;
+			}
+		};
+
+		inline void BeginRecord(ReaJsonWriter& writer, const char* kind, const ReaProject& project, size_t track) {
+			writer.BeginObject();
+			writer.Key("kind"); writer.String(kind, strlen(kind));
+			writer.Key("project"); writer.String(project.Filepath);
+			writer.Key("track"); writer.Integer(static_cast<int64_t>(track));
+		}
+
+		inline void EndRecord(ReaJsonWriter& writer) {
+			writer.EndObject();
+			writer.Raw("\n", 1);
+		}
+	}
+
+	REAPARSER_API ReaNdjsonResult ExportNdjson(const std::vector<std::string>& filepaths,
+		const ReaNdjsonOptions& options, ReaOptions loadOptions) {
+		unsigned int threads = options.Threads ? options.Threads : std::max(1u, std::thread::hardware_concurrency());
+		threads = std::max(1u, static_cast<unsigned int>(std::min<size_t>(threads, filepaths.size())));
+
+		std::vector<Json::Shard> shards(threads);
+		for (unsigned int i = 0; i < threads; i++) {
+			shards[i].Options = &options;
+			shards[i].Worker = i;
+		}
+
+		// The first failure to write stops every worker
+		std::atomic<bool> failed(false);
+		std::vector<std::string> writeErrors(threads);
+
+		ForEachProjectFile(filepaths, loadOptions, [&](size_t index, unsigned int worker, ReaProject& project, const std::string& error) {
+			Json::Shard& shard = shards[worker];
+			if (failed)
+				return;
+			if (!error.empty()) {
+				shard.Result.Errors.push_back(filepaths[index] + ": " + error);
+				return;
+			}
+
+			try {
+				shard.Result.Projects++;
+				for (size_t t = 0; t < project.Tracks.size(); t++) {
+					const ReaTrack& track = project.Tracks[t];
+					if (options.Tracks) {
+						ReaJsonWriter& writer = shard.Next();
+						Json::BeginRecord(writer, "track", project, t);
+						Json::WriteTrackFields(writer, track);
+						writer.Key("items"); writer.Integer(static_cast<int64_t>(track.MediaItems.size()));
+						writer.Key("fxCount"); writer.Integer(static_cast<int64_t>(track.FXChain.size()));
+						Json::EndRecord(writer);
+					}
+					for (size_t i = 0; options.Items && i < track.MediaItems.size(); i++) {
+						ReaJsonWriter& writer = shard.Next();
+						Json::BeginRecord(writer, "item", project, t);
+						writer.Key("index"); writer.Integer(static_cast<int64_t>(i));
+						Json::WriteItemFields(writer, track.MediaItems[i]);
+						Json::EndRecord(writer);
+					}
+					for (size_t i = 0; options.FX && i < track.FXChain.size(); i++) {
+						ReaJsonWriter& writer = shard.Next();
+						Json::BeginRecord(writer, "fx", project, t);
+						writer.Key("index"); writer.Integer(static_cast<int64_t>(i));
+						Json::WriteFXFields(writer, track.FXChain[i], options.Json);
+						Json::EndRecord(writer);
+					}
+				}
+			}
+			catch (Exception& e) {
+				writeErrors[worker] = e.What();
+				failed = true;
+			}
+		}, threads);
+
+		ReaNdjsonResult result;
+		for (unsigned int i = 0; i < threads; i++) {
+			try {
+				shards[i].Close();
+			}
+			catch (Exception& e) {
+				writeErrors[i] = e.What();
+			}
+			ReaNdjsonResult& part = shards[i].Result;
+			result.Projects += part.Projects;
+			result.Records += part.Records;
+			result.Bytes += part.Bytes;
+			result.Shards.insert(result.Shards.end(), part.Shards.begin(), part.Shards.end());
+			result.Errors.insert(result.Errors.end(), part.Errors.begin(), part.Errors.end());
+		}
+
+		for (auto& error : writeErrors) {
+			if (!error.empty())
+				throw Exception(error);
+		}
+		return result;
+	}
+#endif
+}
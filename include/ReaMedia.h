@@ -0,0 +1,803 @@
+#pragma once
+
+#include "ReaParser.h"
+
+#include <sys/stat.h>
+#include <unordered_map>
+#include <cctype>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+// Media probing: reads the header of WAV, AIFF and MP3 files referenced by a project
+// for their format, sample rate, channel count and duration, without decoding audio.
+
+namespace ReaParser {
+
+	enum class ReaMediaFormat {
+		Undefined = 0,
+		WAV, AIFF, MP3
+	};
+
+	struct ReaMediaInfo {
+		ReaMediaFormat Format = ReaMediaFormat::Undefined;
+		unsigned int SampleRate = 0, Channels = 0, BitsPerSample = 0;
+		bool Float = false;
+
+		// Sample frames per channel, and their length in seconds
+		uint64_t Frames = 0;
+		double Duration = 0.0;
+
+		// Byte range of the sample data, for WAV and AIFF
+		uint64_t DataOffset = 0, DataSize = 0;
+
+		// File size and modification time (nanoseconds since the epoch) when probed
+		uint64_t FileSize = 0;
+		int64_t ModifiedTime = 0;
+
+		// Set when the file couldn't be read or isn't a supported format
+		std::string Error;
+
+		bool IsValid() const { return Error.empty() && Format != ReaMediaFormat::Undefined; }
+	};
+
+	// Probed media keyed by path, file size and modification time, so files changed since
+	// are probed again. Saved as a tab-separated text file, safe to share between threads.
+	class ReaMediaCache {
+	public:
+		ReaMediaCache() = default;
+		ReaMediaCache(const ReaMediaCache&) = delete;
+
+		// Merges entries saved by Save, returns false if the file can't be read
+		bool Load(const std::string& filepath);
+		bool Save(const std::string& filepath) const;
+
+		// Finds info probed from path when it had this size and modification time
+		bool Lookup(const std::string& path, uint64_t size, int64_t modifiedTime, ReaMediaInfo& info) const;
+		void Store(const std::string& path, const ReaMediaInfo& info);
+
+		size_t Size() const;
+		uint64_t Hits() const { return m_hits; }
+		uint64_t Misses() const { return m_misses; }
+
+	private:
+		mutable std::mutex m_mutex;
+		std::map<std::string, ReaMediaInfo> m_entries;
+		mutable std::atomic<uint64_t> m_hits{ 0 }, m_misses{ 0 };
+	};
+
+	// Finds the files media items refer to. Sources are looked up relative to the project's
+	// directory, its record paths and SearchPaths, then by file name alone in each of those,
+	// which finds media of projects moved from another machine or saved on Windows.
+	// Existence is checked against listings of each directory read once and kept,
+	// rather than one stat() per source.
+	class ReaPathResolver {
+	public:
+		// Directories searched after the project's own and its record paths, in order
+		std::vector<std::string> SearchPaths;
+
+		// Match file names regardless of case, as on Windows and macOS
+		bool IgnoreCase = false;
+
+		ReaPathResolver() = default;
+		ReaPathResolver(const ReaPathResolver&) = delete;
+
+		// Turns backslashes into slashes and drops repeated separators, "." and ".." segments
+		static std::string Normalize(const std::string& path);
+		static bool IsAbsolute(const std::string& path);
+
+		// Directories searched for project's media, in order
+		std::vector<std::string> Directories(const ReaProject& project) const;
+
+		// Resolves each path against directories, unresolved paths come back empty
+		std::vector<std::string> Resolve(const std::vector<std::string>& paths, const std::vector<std::string>& directories);
+
+		// Resolves the source of every media item in project, keyed by ReaMediaItem::Filepath
+		std::map<std::string, std::string> ResolveProject(const ReaProject& project);
+
+		// Forgets the directory listings read so far, for when files have changed since
+		void Invalidate();
+
+		// Number of directories listed so far
+		size_t Listings() const;
+
+	private:
+		struct Listing {
+			std::unordered_map<std::string, std::string> Names; // Lowercase name to name
+			std::vector<std::string> Exact;                      // Sorted names
+		};
+
+		mutable std::mutex m_mutex;
+		std::map<std::string, Listing> m_listings;
+
+		// Whether filepath exists, setting it to its actual case when ignoring case
+		bool Exists(std::string& filepath);
+	};
+
+	// Reads a media file's header. Failures are reported in ReaMediaInfo::Error, not thrown.
+	REAPARSER_API ReaMediaInfo ProbeMediaFile(const std::string& filepath);
+
+	// Probes many media files on a pool of worker threads (0 for one per hardware thread).
+	// Each distinct path is probed once, and looked up in or added to cache if given.
+	// Results are returned in the order of filepaths.
+	REAPARSER_API std::vector<ReaMediaInfo> ProbeMediaFiles(const std::vector<std::string>& filepaths,
+		ReaMediaCache* cache = nullptr, unsigned int threads = 0);
+
+	// Probes the source of every media item in project, keyed by ReaMediaItem::Filepath,
+	// as found by resolver (or a default ReaPathResolver).
+	REAPARSER_API std::map<std::string, ReaMediaInfo> ProbeProjectMedia(const ReaProject& project,
+		ReaMediaCache* cache = nullptr, unsigned int threads = 0, ReaPathResolver* resolver = nullptr);
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	namespace Media {
+		inline uint32_t ReadLE(const unsigned char* p, int bytes) {
+			uint32_t value = 0;
+			for (int i = bytes - 1; i >= 0; i--)
+				value = (value << 8) | p[i];
+			return value;
+		}
+
+		inline uint64_t ReadLE64(const unsigned char* p) {
+			return ReadLE(p, 4) | (static_cast<uint64_t>(ReadLE(p + 4, 4)) << 32);
+		}
+
+		inline uint32_t ReadBE(const unsigned char* p, int bytes) {
+			uint32_t value = 0;
+			for (int i = 0; i < bytes; i++)
+				value = (value << 8) | p[i];
+			return value;
+		}
+
+		// 80-bit IEEE extended float, as AIFF stores its sample rate
+		inline double ReadExtended(const unsigned char* p) {
+			int exponent = ((p[0] & 0x7f) << 8) | p[1];
+			uint64_t mantissa = (static_cast<uint64_t>(ReadBE(p + 2, 4)) << 32) | ReadBE(p + 6, 4);
+			if (exponent == 0 && mantissa == 0)
+				return 0.0;
+			double value = ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+			return p[0] & 0x80 ? -value : value;
+		}
+
+		inline bool Seek(FILE* fp, int64_t offset, int origin) {
+#ifdef _WIN32
+			return _fseeki64(fp, offset, origin) == 0;
+#else
+			return fseeko(fp, static_cast<off_t>(offset), origin) == 0;
+#endif
+		}
+
+		inline int64_t Tell(FILE* fp) {
+#ifdef _WIN32
+			return _ftelli64(fp);
+#else
+			return static_cast<int64_t>(ftello(fp));
+#endif
+		}
+
+		// Size and modification time in nanoseconds, false if the file doesn't exist
+		inline bool Stat(const std::string& filepath, uint64_t& size, int64_t& modifiedTime) {
+			struct stat st;
+			if (stat(filepath.c_str(), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG)
+				return false;
+
+			size = static_cast<uint64_t>(st.st_size);
+			modifiedTime = static_cast<int64_t>(st.st_mtime) * 1000000000;
+#if defined(__linux__)
+			modifiedTime += st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+			modifiedTime += st.st_mtimespec.tv_nsec;
+#endif
+			return true;
+		}
+
+		// One little endian PCM or float sample of bytes bytes, in [-1, 1)
+		inline float DecodeSample(const unsigned char* p, unsigned int bytes, bool isFloat) {
+			if (isFloat) {
+				if (bytes == 8) {
+					uint64_t bits = ReadLE64(p);
+					double value;
+					memcpy(&value, &bits, sizeof(value));
+					return static_cast<float>(value);
+				}
+				uint32_t bits = ReadLE(p, 4);
+				float value;
+				memcpy(&value, &bits, sizeof(value));
+				return value;
+			}
+
+			switch (bytes) {
+			case 1: return (static_cast<int>(p[0]) - 128) * (1.0f / 128);
+			case 2: return static_cast<int16_t>(ReadLE(p, 2)) * (1.0f / 32768);
+			case 3: return static_cast<int32_t>(ReadLE(p, 3) << 8) * (1.0f / 2147483648.0f);
+			default: return static_cast<int32_t>(ReadLE(p, 4)) * (1.0f / 2147483648.0f);
+			}
+		}
+
+		// Decodes count samples, eight at a time for 16-bit PCM
+		inline void DecodeSamples(const unsigned char* in, size_t count, unsigned int bytes, bool isFloat, float* out) {
+			size_t i = 0;
+#ifdef REAPARSER_SSE2
+			if (bytes == 2 && !isFloat) {
+				const __m128 scale = _mm_set1_ps(1.0f / 32768);
+				for (; i + 8 <= count; i += 8) {
+					// Unpacking a sample with itself and shifting right sign extends it
+					__m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+					__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+					__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+					_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+					_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+				}
+			}
+#endif
+			for (; i < count; i++)
+				out[i] = DecodeSample(in + i * bytes, bytes, isFloat);
+		}
+
+		inline void ProbeWAV(FILE* fp, const unsigned char* header, ReaMediaInfo& info) {
+			bool rf64 = memcmp(header, "RF64", 4) == 0;
+			uint64_t dataSize64 = 0;
+			uint32_t blockAlign = 0;
+			bool hasFormat = false;
+			unsigned char chunk[8], data[40];
+
+			Seek(fp, 12, SEEK_SET);
+			while (fread(chunk, 1, 8, fp) == 8) {
+				uint64_t size = ReadLE(chunk + 4, 4);
+				int64_t start = Tell(fp);
+
+				if (memcmp(chunk, "ds64", 4) == 0 && size >= 16 && fread(data, 1, 16, fp) == 16)
+					dataSize64 = ReadLE64(data + 8);
+				else if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+					size_t read = fread(data, 1, static_cast<size_t>(std::min<uint64_t>(size, sizeof(data))), fp);
+					if (read < 16)
+						break;
+
+					unsigned int formatTag = ReadLE(data, 2);
+					info.Channels = ReadLE(data + 2, 2);
+					info.SampleRate = ReadLE(data + 4, 4);
+					blockAlign = ReadLE(data + 12, 2);
+					info.BitsPerSample = ReadLE(data + 14, 2);
+
+					// WAVE_FORMAT_EXTENSIBLE carries the real format tag in its sub-format GUID
+					if (formatTag == 0xfffe && read >= 26)
+						formatTag = ReadLE(data + 24, 2);
+					if (formatTag != 1 && formatTag != 3) {
+						info.Error = "Unsupported WAV encoding " + std::to_string(formatTag);
+						return;
+					}
+					info.Float = formatTag == 3;
+					hasFormat = true;
+				}
+				else if (memcmp(chunk, "data", 4) == 0) {
+					info.DataOffset = static_cast<uint64_t>(start);
+					info.DataSize = rf64 && size == 0xffffffff ? dataSize64 : size;
+					break;
+				}
+
+				// Chunks are padded to an even size
+				if (!Seek(fp, start + static_cast<int64_t>(size + (size & 1)), SEEK_SET))
+					break;
+			}
+
+			if (!hasFormat || info.DataOffset == 0 || blockAlign == 0 || info.SampleRate == 0) {
+				info.Error = "Malformed WAV file";
+				return;
+			}
+
+			// The data chunk of a file still being written may claim more than there is
+			info.DataSize = std::min(info.DataSize, info.FileSize - info.DataOffset);
+			info.Format = ReaMediaFormat::WAV;
+			info.Frames = info.DataSize / blockAlign;
+			info.Duration = static_cast<double>(info.Frames) / info.SampleRate;
+		}
+
+		inline void ProbeAIFF(FILE* fp, const unsigned char* header, ReaMediaInfo& info) {
+			bool aifc = memcmp(header + 8, "AIFC", 4) == 0;
+			bool hasCommon = false;
+			unsigned char chunk[8], data[22];
+
+			Seek(fp, 12, SEEK_SET);
+			while (fread(chunk, 1, 8, fp) == 8) {
+				uint64_t size = ReadBE(chunk + 4, 4);
+				int64_t start = Tell(fp);
+
+				if (memcmp(chunk, "COMM", 4) == 0 && size >= 18) {
+					size_t read = fread(data, 1, static_cast<size_t>(std::min<uint64_t>(size, sizeof(data))), fp);
+					if (read < 18)
+						break;
+
+					info.Channels = ReadBE(data, 2);
+					info.Frames = ReadBE(data + 2, 4);
+					info.BitsPerSample = ReadBE(data + 6, 2);
+					info.SampleRate = static_cast<unsigned int>(ReadExtended(data + 8) + 0.5);
+
+					if (aifc && read >= 22) {
+						if (memcmp(data + 18, "fl32", 4) == 0 || memcmp(data + 18, "FL32", 4) == 0 ||
+							memcmp(data + 18, "fl64", 4) == 0 || memcmp(data + 18, "FL64", 4) == 0)
+							info.Float = true;
+						else if (memcmp(data + 18, "NONE", 4) != 0 && memcmp(data + 18, "sowt", 4) != 0) {
+							info.Error = "Unsupported AIFF compression " + std::string(reinterpret_cast<char*>(data + 18), 4);
+							return;
+						}
+					}
+					hasCommon = true;
+				}
+				else if (memcmp(chunk, "SSND", 4) == 0 && size >= 8 && fread(data, 1, 8, fp) == 8) {
+					// Sample data follows an offset and block size, the offset within the chunk
+					uint64_t offset = ReadBE(data, 4);
+					if (offset > size - 8) {
+						info.Error = "Malformed AIFF file";
+						return;
+					}
+					info.DataOffset = static_cast<uint64_t>(start) + 8 + offset;
+					info.DataSize = size - 8 - offset;
+				}
+
+				if (!Seek(fp, start + static_cast<int64_t>(size + (size & 1)), SEEK_SET))
+					break;
+			}
+
+			if (!hasCommon || info.SampleRate == 0) {
+				info.Error = "Malformed AIFF file";
+				return;
+			}
+
+			info.Format = ReaMediaFormat::AIFF;
+			info.Duration = static_cast<double>(info.Frames) / info.SampleRate;
+		}
+
+		struct MP3Frame {
+			unsigned int Version = 0, Layer = 0, Bitrate = 0, SampleRate = 0, Channels = 0;
+			unsigned int Samples = 0, Length = 0;
+		};
+
+		// Decodes an MPEG audio frame header, false if p isn't one
+		inline bool ReadMP3Frame(const unsigned char* p, MP3Frame& frame) {
+			if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+				return false;
+
+			// Version is 3 for MPEG 1, 2 for MPEG 2 and 0 for MPEG 2.5, layer is 4 - bits
+			unsigned int version = (p[1] >> 3) & 3, layerBits = (p[1] >> 1) & 3;
+			unsigned int bitrateIndex = p[2] >> 4, rateIndex = (p[2] >> 2) & 3, padding = (p[2] >> 1) & 1;
+			if (version == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+				return false;
+
+			static const unsigned short bitrates[5][15] = {
+				{ 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 }, // MPEG 1 layer I
+				{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },    // MPEG 1 layer II
+				{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },     // MPEG 1 layer III
+				{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },    // MPEG 2 layer I
+				{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }          // MPEG 2 layer II and III
+			};
+			static const unsigned int rates[3] = { 44100, 48000, 32000 };
+
+			bool mpeg1 = version == 3;
+			frame.Version = version;
+			frame.Layer = 4 - layerBits;
+			frame.Bitrate = bitrates[mpeg1 ? frame.Layer - 1 : (frame.Layer == 1 ? 3 : 4)][bitrateIndex] * 1000;
+			frame.SampleRate = rates[rateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+			frame.Channels = (p[3] >> 6) == 3 ? 1 : 2;
+
+			if (frame.Layer == 1) {
+				frame.Samples = 384;
+				frame.Length = (12 * frame.Bitrate / frame.SampleRate + padding) * 4;
+			}
+			else {
+				frame.Samples = frame.Layer == 3 && !mpeg1 ? 576 : 1152;
+				frame.Length = frame.Samples / 8 * frame.Bitrate / frame.SampleRate + padding;
+			}
+			return true;
+		}
+
+		inline void ProbeMP3(FILE* fp, ReaMediaInfo& info) {
+			// Skip an ID3v2 tag, its size is a syncsafe integer
+			unsigned char id3[10];
+			uint64_t start = 0;
+			Seek(fp, 0, SEEK_SET);
+			if (fread(id3, 1, 10, fp) == 10 && memcmp(id3, "ID3", 3) == 0)
+				start = 10 + ((id3[6] & 0x7f) << 21 | (id3[7] & 0x7f) << 14 | (id3[8] & 0x7f) << 7 | (id3[9] & 0x7f)) +
+					(id3[5] & 0x10 ? 10 : 0);
+
+			// Look for two consecutive frames within the first 64 KB, to rule out stray sync bits.
+			// Only a file holding a single frame, ending exactly where it does, is taken on one.
+			std::vector<unsigned char> buffer(64 * 1024);
+			Seek(fp, static_cast<int64_t>(start), SEEK_SET);
+			size_t size = fread(buffer.data(), 1, buffer.size(), fp);
+			bool whole = start + size == info.FileSize;
+
+			MP3Frame frame, next;
+			size_t at = 0;
+			bool found = false;
+			for (; at + 4 <= size; at++) {
+				if (!ReadMP3Frame(&buffer[at], frame))
+					continue;
+				if (at + frame.Length + 4 <= size)
+					found = ReadMP3Frame(&buffer[at + frame.Length], next) &&
+						next.Version == frame.Version && next.Layer == frame.Layer && next.SampleRate == frame.SampleRate;
+				else
+					found = whole && at + frame.Length == size;
+				if (found)
+					break;
+			}
+
+			if (!found) {
+				info.Error = "Unrecognized media format";
+				return;
+			}
+
+			info.Format = ReaMediaFormat::MP3;
+			info.SampleRate = frame.SampleRate;
+			info.Channels = frame.Channels;
+			info.DataOffset = start + at;
+
+			// A Xing/Info or VBRI header in the first frame gives the frame count of VBR files
+			uint64_t frames = 0;
+			size_t xing = at + 4 + (frame.Version == 3 ? (frame.Channels == 1 ? 17 : 32) : (frame.Channels == 1 ? 9 : 17));
+			size_t vbri = at + 36;
+			if (xing + 12 <= size && (memcmp(&buffer[xing], "Xing", 4) == 0 || memcmp(&buffer[xing], "Info", 4) == 0)) {
+				if (ReadBE(&buffer[xing + 4], 4) & 1)
+					frames = ReadBE(&buffer[xing + 8], 4);
+			}
+			else if (vbri + 18 <= size && memcmp(&buffer[vbri], "VBRI", 4) == 0)
+				frames = ReadBE(&buffer[vbri + 14], 4);
+
+			// Otherwise assume a constant bitrate over the rest of the file, less an ID3v1 tag
+			uint64_t end = info.FileSize;
+			unsigned char tag[3];
+			if (end >= 128 && Seek(fp, -128, SEEK_END) && fread(tag, 1, 3, fp) == 3 && memcmp(tag, "TAG", 3) == 0)
+				end -= 128;
+			info.DataSize = end > info.DataOffset ? end - info.DataOffset : 0;
+
+			if (frames) {
+				info.Frames = frames * frame.Samples;
+				info.Duration = static_cast<double>(info.Frames) / info.SampleRate;
+			}
+			else {
+				info.Duration = static_cast<double>(info.DataSize) * 8 / frame.Bitrate;
+				info.Frames = static_cast<uint64_t>(info.Duration * info.SampleRate + 0.5);
+			}
+		}
+	}
+
+	REAPARSER_API ReaMediaInfo ProbeMediaFile(const std::string& filepath) {
+		ReaTraceScope trace("probe", "media", filepath.c_str());
+		ReaMediaInfo info;
+
+		if (!Media::Stat(filepath, info.FileSize, info.ModifiedTime)) {
+			info.Error = "Unable to find media file: " + filepath;
+			return info;
+		}
+
+		FILE* fp = fopen(filepath.c_str(), "rb");
+		if (!fp) {
+			info.Error = "Unable to open media file: " + filepath;
+			return info;
+		}
+
+		unsigned char header[12] = {};
+		size_t read = fread(header, 1, sizeof(header), fp);
+
+		// Recognized by content, as extensions can't be trusted
+		if (read == 12 && (memcmp(header, "RIFF", 4) == 0 || memcmp(header, "RF64", 4) == 0) && memcmp(header + 8, "WAVE", 4) == 0)
+			Media::ProbeWAV(fp, header, info);
+		else if (read == 12 && memcmp(header, "FORM", 4) == 0 &&
+			(memcmp(header + 8, "AIFF", 4) == 0 || memcmp(header + 8, "AIFC", 4) == 0))
+			Media::ProbeAIFF(fp, header, info);
+		else
+			Media::ProbeMP3(fp, info);
+
+		fclose(fp);
+		if (!info.Error.empty())
+			info.Format = ReaMediaFormat::Undefined;
+		return info;
+	}
+
+	REAPARSER_API std::vector<ReaMediaInfo> ProbeMediaFiles(const std::vector<std::string>& filepaths,
+		ReaMediaCache* cache, unsigned int threads) {
+		// Probe each distinct path once
+		std::vector<std::string> unique(filepaths);
+		std::sort(unique.begin(), unique.end());
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+		std::vector<ReaMediaInfo> probed(unique.size());
+
+		ReaThreadPool::For(unique.size(), threads, [&](size_t i, unsigned int) {
+			uint64_t size = 0;
+			int64_t modifiedTime = 0;
+			if (cache && Media::Stat(unique[i], size, modifiedTime) &&
+				cache->Lookup(unique[i], size, modifiedTime, probed[i]))
+				return;
+
+			probed[i] = ProbeMediaFile(unique[i]);
+			if (cache && probed[i].FileSize)
+				cache->Store(unique[i], probed[i]);
+		});
+
+		std::vector<ReaMediaInfo> infos;
+		infos.reserve(filepaths.size());
+		for (auto& filepath : filepaths)
+			infos.push_back(probed[std::lower_bound(unique.begin(), unique.end(), filepath) - unique.begin()]);
+		return infos;
+	}
+
+	REAPARSER_API std::map<std::string, ReaMediaInfo> ProbeProjectMedia(const ReaProject& project,
+		ReaMediaCache* cache, unsigned int threads, ReaPathResolver* resolver) {
+		ReaPathResolver defaultResolver;
+		std::map<std::string, std::string> resolved = (resolver ? resolver : &defaultResolver)->ResolveProject(project);
+
+		std::vector<std::string> sources, filepaths;
+		std::map<std::string, ReaMediaInfo> media;
+		for (auto& source : resolved) {
+			if (source.second.empty())
+				media[source.first].Error = "Unable to find media file: " + source.first;
+			else {
+				sources.push_back(source.first);
+				filepaths.push_back(source.second);
+			}
+		}
+
+		std::vector<ReaMediaInfo> infos = ProbeMediaFiles(filepaths, cache, threads);
+		for (size_t i = 0; i < sources.size(); i++)
+			media[sources[i]] = infos[i];
+		return media;
+	}
+
+	REAPARSER_API std::string ReaPathResolver::Normalize(const std::string& path) {
+		std::string p = path;
+		std::replace(p.begin(), p.end(), '\\', '/');
+
+		// Keep the root of UNC, drive letter and absolute paths
+		std::string root;
+		if (p.compare(0, 2, "//") == 0)
+			root = "//";
+		else if (p.size() >= 2 && isalpha(static_cast<unsigned char>(p[0])) && p[1] == ':')
+			root = p.substr(0, p.size() > 2 && p[2] == '/' ? 3 : 2);
+		else if (!p.empty() && p[0] == '/')
+			root = "/";
+
+		std::vector<std::string> segments;
+		for (size_t start = root.size(), end; start <= p.size(); start = end + 1) {
+			end = std::min(p.find('/', start), p.size());
+			std::string segment = p.substr(start, end - start);
+
+			if (segment.empty() || segment == ".")
+				continue;
+			if (segment == ".." && !segments.empty() && segments.back() != "..")
+				segments.pop_back();
+			else if (segment != ".." || root.empty())
+				segments.push_back(segment);
+		}
+
+		std::string normalized = root;
+		for (size_t i = 0; i < segments.size(); i++)
+			normalized += (i ? "/" : "") + segments[i];
+		return normalized.empty() ? "." : normalized;
+	}
+
+	REAPARSER_API bool ReaPathResolver::IsAbsolute(const std::string& path) {
+		return (!path.empty() && (path[0] == '/' || path[0] == '\\')) ||
+			(path.size() >= 2 && isalpha(static_cast<unsigned char>(path[0])) && path[1] == ':');
+	}
+
+	REAPARSER_API std::vector<std::string> ReaPathResolver::Directories(const ReaProject& project) const {
+		std::string projectDirectory = ".";
+		size_t separator = project.Filepath.find_last_of("/\\");
+		if (separator != std::string::npos)
+			projectDirectory = project.Filepath.substr(0, separator);
+
+		std::vector<std::string> directories = { Normalize(projectDirectory) };
+		for (auto* recordPath : { &project.RecordPath, &project.SecondaryRecordPath }) {
+			if (!recordPath->empty())
+				directories.push_back(Normalize(IsAbsolute(*recordPath) ? *recordPath : projectDirectory + "/" + *recordPath));
+		}
+		for (auto& searchPath : SearchPaths)
+			directories.push_back(Normalize(searchPath));
+		return directories;
+	}
+
+	REAPARSER_API std::vector<std::string> ReaPathResolver::Resolve(const std::vector<std::string>& paths,
+		const std::vector<std::string>& directories) {
+		ReaTraceScope trace("resolve", "media");
+		std::map<std::string, std::string> resolved;
+
+		for (auto& path : paths) {
+			if (resolved.count(path))
+				continue;
+
+			std::string normalized = Normalize(path), candidate;
+			bool found = false;
+
+			if (IsAbsolute(normalized))
+				found = Exists(candidate = normalized);
+			else {
+				for (size_t i = 0; i < directories.size() && !found; i++)
+					found = Exists(candidate = Normalize(directories[i] + "/" + normalized));
+			}
+
+			// Fall back to the file name alone, for media moved along with the project
+			std::string name = normalized.substr(normalized.find_last_of('/') + 1);
+			for (size_t i = 0; i < directories.size() && !found; i++)
+				found = Exists(candidate = Normalize(directories[i] + "/" + name));
+
+			resolved[path] = found ? candidate : std::string();
+		}
+
+		std::vector<std::string> filepaths;
+		filepaths.reserve(paths.size());
+		for (auto& path : paths)
+			filepaths.push_back(resolved[path]);
+		return filepaths;
+	}
+
+	REAPARSER_API std::map<std::string, std::string> ReaPathResolver::ResolveProject(const ReaProject& project) {
+		std::vector<std::string> sources;
+		for (auto& track : project.Tracks) {
+			for (auto& item : track.MediaItems) {
+				if (!item.Filepath.empty())
+					sources.push_back(item.Filepath);
+			}
+		}
+		std::sort(sources.begin(), sources.end());
+		sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+		std::vector<std::string> filepaths = Resolve(sources, Directories(project));
+		std::map<std::string, std::string> resolved;
+		for (size_t i = 0; i < sources.size(); i++)
+			resolved[sources[i]] = filepaths[i];
+		return resolved;
+	}
+
+	REAPARSER_API void ReaPathResolver::Invalidate() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_listings.clear();
+	}
+
+	REAPARSER_API size_t ReaPathResolver::Listings() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_listings.size();
+	}
+
+	REAPARSER_API bool ReaPathResolver::Exists(std::string& filepath) {
+		size_t separator = filepath.find_last_of('/');
+		std::string directory = separator == std::string::npos ? "." : filepath.substr(0, separator ? separator : 1);
+		std::string name = filepath.substr(separator == std::string::npos ? 0 : separator + 1);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_listings.find(directory);
+		if (it == m_listings.end()) {
+			Listing listing;
+#ifdef _WIN32
+			struct _finddata_t entry;
+			intptr_t handle = _findfirst((directory + "/*").c_str(), &entry);
+			if (handle != -1) {
+				do {
+					if (!(entry.attrib & _A_SUBDIR))
+						listing.Exact.push_back(entry.name);
+				} while (_findnext(handle, &entry) == 0);
+				_findclose(handle);
+			}
+#else
+			if (DIR* dir = opendir(directory.c_str())) {
+				while (dirent* entry = readdir(dir)) {
+					if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+						listing.Exact.push_back(entry->d_name);
+				}
+				closedir(dir);
+			}
+#endif
+			std::sort(listing.Exact.begin(), listing.Exact.end());
+			for (auto& entry : listing.Exact) {
+				std::string lower = entry;
+				std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+				listing.Names.emplace(lower, entry);
+			}
+			it = m_listings.emplace(directory, std::move(listing)).first;
+		}
+
+		const Listing& listing = it->second;
+		if (std::binary_search(listing.Exact.begin(), listing.Exact.end(), name))
+			return true;
+		if (!IgnoreCase)
+			return false;
+
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		auto match = listing.Names.find(name);
+		if (match == listing.Names.end())
+			return false;
+		filepath = filepath.substr(0, separator + 1) + match->second;
+		return true;
+	}
+
+	REAPARSER_API bool ReaMediaCache::Load(const std::string& filepath) {
+		FILE* fp = fopen(filepath.c_str(), "rb");
+		if (!fp)
+			return false;
+
+		// One entry per line: path, size, mtime, format, rate, channels, bits, float, frames,
+		// duration, data offset, data size and error, separated by tabs
+		std::string line;
+		std::map<std::string, ReaMediaInfo> entries;
+		for (int c = fgetc(fp); c != EOF; c = fgetc(fp)) {
+			if (c != '\n') {
+				line += static_cast<char>(c);
+				continue;
+			}
+
+			size_t tab = line.find('\t');
+			ReaMediaInfo info;
+			int format = 0, isFloat = 0, errorAt = 0;
+			unsigned long long size = 0, frames = 0, offset = 0, dataSize = 0;
+			long long modifiedTime = 0;
+
+			if (tab != std::string::npos && sscanf(line.c_str() + tab + 1, "%llu\t%lld\t%i\t%u\t%u\t%u\t%i\t%llu\t%lf\t%llu\t%llu\t%n",
+				&size, &modifiedTime, &format, &info.SampleRate, &info.Channels, &info.BitsPerSample, &isFloat,
+				&frames, &info.Duration, &offset, &dataSize, &errorAt) == 11 && errorAt > 0) {
+				info.Format = static_cast<ReaMediaFormat>(format);
+				info.Float = isFloat != 0;
+				info.FileSize = size;
+				info.ModifiedTime = modifiedTime;
+				info.Frames = frames;
+				info.DataOffset = offset;
+				info.DataSize = dataSize;
+				info.Error = line.substr(tab + 1 + errorAt);
+				entries[line.substr(0, tab)] = info;
+			}
+			line.clear();
+		}
+		fclose(fp);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& entry : entries)
+			m_entries[entry.first] = entry.second;
+		return true;
+	}
+
+	REAPARSER_API bool ReaMediaCache::Save(const std::string& filepath) const {
+		FILE* fp = fopen(filepath.c_str(), "wb");
+		if (!fp)
+			return false;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& entry : m_entries) {
+			const ReaMediaInfo& info = entry.second;
+			if (entry.first.find_first_of("\t\n") != std::string::npos || info.Error.find('\n') != std::string::npos)
+				continue;
+
+			fprintf(fp, "%s\t%llu\t%lld\t%i\t%u\t%u\t%u\t%i\t%llu\t%.17g\t%llu\t%llu\t%s\n", entry.first.c_str(),
+				static_cast<unsigned long long>(info.FileSize), static_cast<long long>(info.ModifiedTime),
+				static_cast<int>(info.Format), info.SampleRate, info.Channels, info.BitsPerSample, info.Float ? 1 : 0,
+				static_cast<unsigned long long>(info.Frames), info.Duration, static_cast<unsigned long long>(info.DataOffset),
+				static_cast<unsigned long long>(info.DataSize), info.Error.c_str());
+		}
+		return fclose(fp) == 0;
+	}
+
+	REAPARSER_API bool ReaMediaCache::Lookup(const std::string& path, uint64_t size, int64_t modifiedTime, ReaMediaInfo& info) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(path);
+		if (it == m_entries.end() || it->second.FileSize != size || it->second.ModifiedTime != modifiedTime) {
+			m_misses++;
+			return false;
+		}
+		m_hits++;
+		info = it->second;
+		return true;
+	}
+
+	REAPARSER_API void ReaMediaCache::Store(const std::string& path, const ReaMediaInfo& info) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries[path] = info;
+	}
+
+	REAPARSER_API size_t ReaMediaCache::Size() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries.size();
+	}
+#endif
+}
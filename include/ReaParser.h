@@ -7,8 +7,52 @@
 #include <string>
 #include <vector>
 #include <cstring>
+#include <cstdint>
 #include <cmath>
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REAPARSER_SSE2
+#endif
+
+// Instrumentation hooks, called on entry and exit of every parser phase with the
+// phase (a ReaPhase) and the FILE* being read. Define them before including this
+// header to observe the parser (see testing/Benchmark.cpp), they expand to nothing otherwise.
+#ifndef REAPARSER_PHASE_BEGIN
+#define REAPARSER_PHASE_BEGIN(phase, fp)
+#endif
+#ifndef REAPARSER_PHASE_END
+#define REAPARSER_PHASE_END(phase, fp)
+#endif
+
+// Parse statistics (see ReaParseStats) are only gathered when REAPARSER_STATS is
+// defined, otherwise the statements wrapped in REAPARSER_STAT are compiled out.
+#ifdef REAPARSER_STATS
+#define REAPARSER_STAT(...) __VA_ARGS__
+#else
+#define REAPARSER_STAT(...)
+#endif
+
+// Header-only by default. Defining REAPARSER_STATIC only declares the parser's functions,
+// to link them from the compiled library instead (the ReaParser::static CMake target),
+// where src/ReaParser.cpp defines REAPARSER_IMPLEMENTATION to compile them once.
+// The hooks and REAPARSER_STATS then apply as the library was built, not per includer.
+#if defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+#define REAPARSER_API
+#else
+#define REAPARSER_API inline
+#endif
 
 namespace ReaParser {
 
@@ -23,6 +67,8 @@ namespace ReaParser {
 	// ------------ //
 
 	// Options to pass to parser
+	class ReaHandlers;
+
 	struct ReaOptions {
 		// By default Reaper serializes track volume by amplitude.
 		// Set this true to convert all volume to decibels (as seen on track fader tooltips).
@@ -31,6 +77,77 @@ namespace ReaParser {
 		// Set true, pan values will be between -1 (left) and 1 (right), as serialized.
 		// Set false to range pan values between -100% and 100% (as seen on track pan tooltips).
 		bool NormalizePan = true;
+
+		// Either way the serialized values are kept as well (see ReaVolumePan), so loading
+		// with ConvertVolumeToDB false and converting on access skips the conversion pass.
+
+		// Hard limits for untrusted input, 0 for no limit. Loading throws BadFile when a line
+		// is longer than MaxLineLength bytes or chunks nest deeper than MaxDepth.
+		// Reaper's own projects stay well within a depth of 16.
+		size_t MaxLineLength = 0;
+		unsigned int MaxDepth = 0;
+
+		// Volume is converted to decibels in one pass once the project is loaded, with an
+		// approximation of log10 within 1e-4 dB (see Util::ToDecibel).
+		// Set this true to use log10 itself.
+		bool ExactDecibels = false;
+
+		// Keep only the active take of each media item. The lines of takes known to be
+		// inactive are skipped without being parsed, which adds up in comped items.
+		bool ActiveTakesOnly = false;
+
+		// Callbacks for chunks and lines the parser doesn't read itself (see ReaHandlers)
+		std::shared_ptr<const ReaHandlers> Handlers;
+	};
+
+	// Parser phases, as reported to the instrumentation hooks.
+	// Items and FX are nested within Tracks.
+	enum class ReaPhase {
+		Metadata = 0, Properties, Master, Tracks, Items, FX,
+		Count
+	};
+
+	// Statistics filled in by LoadProjectFile when built with REAPARSER_STATS defined.
+	// Without it the parser never touches the struct and every field stays zero.
+	struct ReaParseStats {
+	public:
+		friend Parser;
+
+		// Wall time per phase in seconds, excluding nested phases (indexed by ReaPhase)
+		double PhaseSeconds[static_cast<size_t>(ReaPhase::Count)] = {};
+
+		// Total load time, and the part of it spent waiting on file reads
+		double TotalSeconds = 0.0, ReadSeconds = 0.0;
+
+		// Totals over every pass the parser makes through the file
+		uint64_t BytesScanned = 0, LinesScanned = 0;
+
+		// Chunks by tag ("TRACK", "ITEM", "FXCHAIN", ...), each counted once per file
+		std::map<std::string, uint64_t> Chunks;
+
+		// Heap allocations made during the load. Only counted when one translation unit
+		// defines REAPARSER_STATS_ALLOCATOR before including ReaParser.h.
+		uint64_t Allocations = 0, AllocatedBytes = 0;
+
+		// Lines within tracks, media items and FX chains that no field handler recognized
+		uint64_t UnknownLines = 0;
+
+		// Lines the track pass read past outside of any track
+		uint64_t SkippedLines = 0;
+	private:
+		std::chrono::steady_clock::time_point m_since;
+		ReaPhase m_stack[8];
+		int m_depth = 0;
+	};
+
+	// Per-thread heap allocation counters, see REAPARSER_STATS_ALLOCATOR
+	struct ReaAllocCounters {
+		uint64_t Count = 0, Bytes = 0;
+
+		static ReaAllocCounters& Current() {
+			static thread_local ReaAllocCounters counters;
+			return counters;
+		}
 	};
 
 	struct ReaVersion {
@@ -55,15 +172,43 @@ namespace ReaParser {
 		}
 	};
 	
+	// Volume and pan as serialized, converted on access. Tracks and media items also keep
+	// Volume and Pan as converted at load time by ReaOptions.
+	struct ReaVolumePan {
+		// Amplitude, 1 being 0 dB, as Reaper assumes when there's no VOLPAN line
+		float RawVolume = 1.0f;
+
+		// Between -1 (left) and 1 (right)
+		float RawPan = 0.0f;
+
+		float VolumeDB() const;
+		float VolumeAmplitude() const { return RawVolume; }
+		float PanNormalized() const { return RawPan; }
+		float PanPercent() const { return RawPan * 100.0f; }
+	};
+
 	enum class ReaMediaType {
 		Undefined = 0,
 		Sample, Midi
 	};
 
-	struct ReaMediaItem {
+	// One take of a media item: the source it plays and its own volume and pan
+	struct ReaTake : public ReaVolumePan {
+		std::string Name, Filepath;
+		ReaMediaType Type = ReaMediaType::Undefined;
+
+		// Position in the source the take starts playing from, in seconds
+		float StartOffset = 0.0f;
+
+		// Playback speed, 1 for the source's own
+		float PlayRate = 1.0f;
+	};
+	using ReaTakes = std::vector<ReaTake>;
+
+	struct ReaMediaItem : public ReaVolumePan {
 
 		std::string Name, Filepath;
-		float Volume = 0.0, Pan = 0.0;
+		float Volume = 1.0f, Pan = 0.0f;
 		bool Muted = false;
 		ReaMediaType Type = ReaMediaType::Undefined;
 
@@ -76,6 +221,22 @@ namespace ReaParser {
 		// Length in seconds
 		float Length = 0.0f;
 
+		// Position in the source the item starts playing from, in seconds
+		float StartOffset = 0.0f;
+
+		// Playback speed, 1 for the source's own
+		float PlayRate = 1.0f;
+
+		// Fade in and fade out lengths in seconds
+		float FadeIn = 0.0f, FadeOut = 0.0f;
+
+		bool Selected = false;
+
+		// The item's takes are TakeCount of ReaProject::Takes from FirstTake, ActiveTake being
+		// the one that plays, counted from FirstTake. Name, Filepath, Type and StartOffset
+		// above are the active take's.
+		uint32_t FirstTake = 0, TakeCount = 0, ActiveTake = 0;
+
 		std::string ToString() {
 			switch (Type) {
 			case ReaMediaType::Sample: return "Sample";
@@ -97,15 +258,20 @@ namespace ReaParser {
 	};
 	using ReaFXChain = std::vector<ReaFX>;
 
-	struct ReaTrack {
+	struct ReaTrack : public ReaVolumePan {
 	public:
 		friend Parser;
 
 		std::string Name, GUID;
-		float Volume = 0.0f, Pan = 0.0f;
+		float Volume = 1.0f, Pan = 0.0f;
 		unsigned int NumericID = 0, Channels = 0;
 		bool Muted = false;
 		bool PhaseInverted = false;
+		bool Selected = false;
+
+		// Change in folder depth after this track: 1 makes it the parent of the tracks
+		// that follow, -n closes n folders with it as their last child
+		int FolderDepth = 0;
 
 		ReaMediaItems MediaItems;
 		ReaFXChain FXChain;
@@ -121,21 +287,50 @@ namespace ReaParser {
 
 	struct ReaProject {
 	public:
-		friend ReaProject LoadProjectFile(const char* filepath, ReaOptions options);
+		template <class VolumePolicy, class PanPolicy>
+		friend ReaProject LoadProjectFile(const char* filepath, ReaOptions options, ReaParseStats* stats);
 		friend Parser;
 
 		std::string Name, Filepath;
 		ReaVersion Version;
 		ReaTracks Tracks;
 		ReaTempo Tempo;
+
+		// Takes of every media item, each item's in a run of their own
+		ReaTakes Takes;
 		unsigned int SampleRate = 0;
 
-		bool IsValid() { return m_valid; }
+		// Primary and secondary recording directories, relative to the project's unless absolute
+		std::string RecordPath, SecondaryRecordPath;
 
-		operator bool() { return m_valid; }
+		bool IsValid() const { return m_valid; }
+
+		operator bool() const { return m_valid; }
 	private:
 		bool m_valid = false;
 		ReaOptions m_options;
+		ReaParseStats* m_stats = nullptr;
+
+		// Reader state for the pass through the file in progress
+		struct ReadState {
+			int Depth = 0;             // Chunks open after the current line
+			uint64_t Line = 0;         // Current line number
+			size_t LineLength = 0;     // Bytes read of the current line so far
+			size_t Indent = 0;         // Leading spaces of the current line
+			bool Header = false;       // Current line opens a chunk
+			bool Footer = false;       // Current line closes a chunk
+			bool Continued = false;    // Last read continued a line longer than the buffer
+			std::string Pending;       // Line handed back by Parser::Unread
+
+			// Dispatch to ReaOptions::Handlers, in the pass loading tracks
+			const ReaHandlers* Handlers = nullptr;
+			const ReaTrack* Track = nullptr;       // Track being loaded
+			const ReaMediaItem* Item = nullptr;    // Media item being loaded
+			uint64_t Dispatched = 0;               // Last line handed to handlers
+			uint32_t ChunkFirst = 0, ChunkCount = 0; // Handlers of the chunk being handed over
+			int ChunkDepth = 0;
+			size_t ChunkIndent = 0;
+		} m_read;
 	};
 
 	// ---------- //
@@ -158,6 +353,269 @@ namespace ReaParser {
 		BadFile(const std::string& what) : Exception(what) {}
 	};
 
+	// ------- //
+	// Tracing //
+	// ------- //
+
+	// A completed span of parser activity on one thread
+	struct ReaTraceEvent {
+		const char* Name;
+		const char* Category;
+		std::string Detail;
+		uint32_t Thread;
+		double Start, Duration; // Microseconds since the tracer was created
+	};
+
+	// Records parser activity (files, track chunks, FX decodes and I/O waits) on every
+	// thread while installed, and writes it as Chrome trace-event JSON for chrome://tracing
+	// or Perfetto. Events go to per-thread buffers, so recording takes no locks.
+	// When no tracer is installed the parser's hooks cost a single atomic load.
+	class ReaTracer {
+	public:
+		// Reads taking longer than this many microseconds are recorded as I/O waits
+		double IOThreshold = 20.0;
+
+		ReaTracer() : m_serial(NextSerial()), m_origin(std::chrono::steady_clock::now()) {}
+		ReaTracer(const ReaTracer&) = delete;
+		~ReaTracer() { if (Active() == this) Install(nullptr); }
+
+		// Makes tracer receive events from all threads, pass nullptr to stop tracing
+		static void Install(ReaTracer* tracer) { Global().store(tracer, std::memory_order_release); }
+		static ReaTracer* Active() { return Global().load(std::memory_order_acquire); }
+
+		double Now() const {
+			return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_origin).count();
+		}
+
+		void Record(const char* name, const char* category, const std::string& detail, double start, double duration) {
+			ThreadBuffer& buffer = CurrentBuffer();
+			ReaTraceEvent event = { name, category, detail, buffer.Thread, start, duration };
+			buffer.Events.push_back(event);
+		}
+
+		// All events recorded so far. Only call once recording threads have finished.
+		std::vector<ReaTraceEvent> Events() const {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::vector<ReaTraceEvent> events;
+			for (auto& buffer : m_buffers)
+				events.insert(events.end(), buffer->Events.begin(), buffer->Events.end());
+			return events;
+		}
+
+		// Writes Chrome trace-event JSON, returns false if the file can't be written.
+		// Like Events(), only call once recording threads have finished.
+		bool WriteChromeTrace(const char* filepath) const {
+			FILE* fp = fopen(filepath, "wb");
+			if (!fp)
+				return false;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", fp);
+
+			bool first = true;
+			for (auto& buffer : m_buffers) {
+				fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+					first ? "" : ",", buffer->Thread, buffer->Thread);
+				first = false;
+
+				for (auto& event : buffer->Events) {
+					fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+						event.Name, event.Category, event.Thread, event.Start, event.Duration);
+					if (!event.Detail.empty()) {
+						fputs(",\"args\":{\"detail\":\"", fp);
+						for (char c : event.Detail) {
+							if (c == '"' || c == '\\')
+								fputc('\\', fp);
+							if (static_cast<unsigned char>(c) >= 0x20)
+								fputc(c, fp);
+						}
+						fputs("\"}", fp);
+					}
+					fputc('}', fp);
+				}
+			}
+
+			fputs("\n]}\n", fp);
+			return fclose(fp) == 0;
+		}
+
+	private:
+		struct ThreadBuffer {
+			uint32_t Thread;
+			std::vector<ReaTraceEvent> Events;
+		};
+
+		uint64_t m_serial;
+		std::chrono::steady_clock::time_point m_origin;
+		mutable std::mutex m_mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+
+		static std::atomic<ReaTracer*>& Global() {
+			static std::atomic<ReaTracer*> tracer(nullptr);
+			return tracer;
+		}
+
+		static uint64_t NextSerial() {
+			static std::atomic<uint64_t> serial(0);
+			return ++serial;
+		}
+
+		// The calling thread's buffer, registered on its first event. Cached by serial
+		// rather than address so a new tracer at a reused address isn't mistaken for an old one.
+		ThreadBuffer& CurrentBuffer() {
+			struct Cache { uint64_t Serial = 0; ThreadBuffer* Buffer = nullptr; };
+			static thread_local Cache cache;
+
+			if (cache.Serial != m_serial) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_buffers.emplace_back(new ThreadBuffer());
+				m_buffers.back()->Thread = static_cast<uint32_t>(m_buffers.size());
+				cache.Serial = m_serial;
+				cache.Buffer = m_buffers.back().get();
+			}
+			return *cache.Buffer;
+		}
+	};
+
+	// Records the lifetime of a scope to the active tracer, if any
+	class ReaTraceScope {
+	public:
+		ReaTraceScope(const char* name, const char* category, const char* detail = nullptr)
+			: m_tracer(ReaTracer::Active()), m_name(name), m_category(category) {
+			if (m_tracer) {
+				if (detail)
+					m_detail = detail;
+				m_start = m_tracer->Now();
+			}
+		}
+		ReaTraceScope(const ReaTraceScope&) = delete;
+
+		~ReaTraceScope() {
+			if (m_tracer)
+				m_tracer->Record(m_name, m_category, m_detail, m_start, m_tracer->Now() - m_start);
+		}
+
+	private:
+		ReaTracer* m_tracer;
+		const char* m_name;
+		const char* m_category;
+		std::string m_detail;
+		double m_start = 0.0;
+	};
+
+	// ------- //
+	// Threads //
+	// ------- //
+
+	// Worker threads kept for repeated parallel loops. Run hands the indices of a loop out
+	// to the workers and the calling thread, which is worker 0, and returns once all are done.
+	class ReaThreadPool {
+	public:
+		using Task = std::function<void(size_t index, unsigned int worker)>;
+
+		// Threads counts the calling thread, 0 for one per hardware thread
+		explicit ReaThreadPool(unsigned int threads = 0) {
+			if (threads == 0)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			for (unsigned int i = 1; i < threads; i++)
+				m_workers.emplace_back(&ReaThreadPool::Work, this, i);
+		}
+		ReaThreadPool(const ReaThreadPool&) = delete;
+
+		~ReaThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			for (auto& worker : m_workers)
+				worker.join();
+		}
+
+		unsigned int Threads() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+		// Calls task for every index below count. Once a task throws on any thread no further
+		// indices are handed out, and the first exception is rethrown when the tasks already
+		// running have finished.
+		void Run(size_t count, const Task& task) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_task = &task;
+				m_count = count;
+				m_next = 0;
+				m_running = m_workers.size();
+				m_error = nullptr;
+				m_generation++;
+			}
+			m_wake.notify_all();
+
+			Loop(0);
+			Wait();
+
+			std::exception_ptr error;
+			std::swap(error, m_error);
+			if (error)
+				std::rethrow_exception(error);
+		}
+
+		// Runs a single loop on a pool of up to threads threads, no more than there are indices
+		static void For(size_t count, unsigned int threads, const Task& task) {
+			if (threads == 0)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			ReaThreadPool pool(static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threads, count))));
+			pool.Run(count, task);
+		}
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::mutex m_mutex;
+		std::condition_variable m_wake, m_done;
+		const Task* m_task = nullptr;
+		size_t m_count = 0;
+		std::atomic<size_t> m_next{ 0 };
+		size_t m_running = 0;
+		uint64_t m_generation = 0;
+		bool m_stop = false;
+		std::exception_ptr m_error;
+
+		void Loop(unsigned int worker) {
+			try {
+				for (size_t i = m_next++; i < m_count; i = m_next++)
+					(*m_task)(i, worker);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_error)
+					m_error = std::current_exception();
+				m_next = m_count;
+			}
+		}
+
+		void Wait() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock, [this]() { return m_running == 0; });
+		}
+
+		void Work(unsigned int worker) {
+			uint64_t generation = 0;
+			for (;;) {
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_wake.wait(lock, [&]() { return m_stop || m_generation != generation; });
+					if (m_stop)
+						return;
+					generation = m_generation;
+				}
+
+				Loop(worker);
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (--m_running == 0)
+					m_done.notify_one();
+			}
+		}
+	};
+
 	// --------- //
 	// Functions //
 	// --------- //
@@ -169,30 +627,505 @@ namespace ReaParser {
 		Util(const Util&) = delete;
 
 		static inline float ToDecibel(float amplitude) { return 20.0f * log10(amplitude); }
+
+		// Converted volume or pan of every track or media item in objects, in order
+		template <class Container>
+		static std::vector<float> VolumesDB(const Container& objects, bool exact = false) {
+			std::vector<float> volumes = VolumesAmplitude(objects);
+			ToDecibel(volumes.data(), volumes.size(), exact);
+			return volumes;
+		}
+
+		template <class Container>
+		static std::vector<float> VolumesAmplitude(const Container& objects) {
+			std::vector<float> volumes;
+			volumes.reserve(objects.size());
+			for (const ReaVolumePan& object : objects)
+				volumes.push_back(object.RawVolume);
+			return volumes;
+		}
+
+		template <class Container>
+		static std::vector<float> PansNormalized(const Container& objects) {
+			std::vector<float> pans;
+			pans.reserve(objects.size());
+			for (const ReaVolumePan& object : objects)
+				pans.push_back(object.RawPan);
+			return pans;
+		}
+
+		template <class Container>
+		static std::vector<float> PansPercent(const Container& objects) {
+			std::vector<float> pans = PansNormalized(objects);
+			for (float& pan : pans)
+				pan *= 100.0f;
+			return pans;
+		}
+
+		// Converts count amplitudes to decibels in place, four at a time where SSE2 is available.
+		// Unless exact, log10 is approximated within 1e-4 dB over all normal floats (3e-7
+		// relative), no further off than float log10 itself. Zero, negative, subnormal,
+		// infinite and NaN amplitudes are always converted exactly.
+		static void ToDecibel(float* amplitudes, size_t count, bool exact = false) {
+			size_t i = 0;
+			if (!exact) {
+#ifdef REAPARSER_SSE2
+				for (; i + 4 <= count; i += 4) {
+					__m128 x = _mm_loadu_ps(amplitudes + i);
+					__m128 special = _mm_or_ps(_mm_cmpnge_ps(x, _mm_set1_ps(FLT_MIN)), _mm_cmpnle_ps(x, _mm_set1_ps(FLT_MAX)));
+					int lanes = _mm_movemask_ps(special);
+
+					if (lanes) {
+						float in[4];
+						_mm_storeu_ps(in, x);
+						_mm_storeu_ps(amplitudes + i, ApproxDecibel(x));
+						for (int lane = 0; lane < 4; lane++) {
+							if (lanes & (1 << lane))
+								amplitudes[i + lane] = ToDecibel(in[lane]);
+						}
+					}
+					else
+						_mm_storeu_ps(amplitudes + i, ApproxDecibel(x));
+				}
+#endif
+				for (; i < count; i++) {
+					float x = amplitudes[i];
+					amplitudes[i] = x >= FLT_MIN && x <= FLT_MAX ? ApproxDecibel(x) : ToDecibel(x);
+				}
+			}
+			for (; i < count; i++)
+				amplitudes[i] = ToDecibel(amplitudes[i]);
+		}
+
+	private:
+		// 20 log10(x) for normal positive x. With x = m * 2^e and m within [sqrt(1/2), sqrt(2)),
+		// ln(m) = 2 atanh(t) for t = (m - 1) / (m + 1), |t| < 0.172, and the series is cut after t^9.
+		static float ApproxDecibel(float x) {
+			uint32_t bits;
+			memcpy(&bits, &x, sizeof(bits));
+			float e = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+			bits = (bits & 0x007fffff) | 0x3f800000;
+			float m;
+			memcpy(&m, &bits, sizeof(m));
+			if (m > 1.41421356f) {
+				m *= 0.5f;
+				e += 1.0f;
+			}
+
+			float t = (m - 1.0f) / (m + 1.0f), t2 = t * t;
+			float ln = 2.0f * t * (1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9)))));
+			return e * 6.02059991f + ln * 8.68588964f;
+		}
+
+#ifdef REAPARSER_SSE2
+		static __m128 ApproxDecibel(__m128 x) {
+			__m128i bits = _mm_castps_si128(x);
+			__m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+			__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+
+			__m128 high = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+			m = _mm_sub_ps(m, _mm_and_ps(high, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+			e = _mm_add_ps(e, _mm_and_ps(high, _mm_set1_ps(1.0f)));
+
+			__m128 one = _mm_set1_ps(1.0f);
+			__m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+			__m128 t2 = _mm_mul_ps(t, t);
+			__m128 series = _mm_add_ps(_mm_set1_ps(1.0f / 7), _mm_mul_ps(t2, _mm_set1_ps(1.0f / 9)));
+			series = _mm_add_ps(_mm_set1_ps(1.0f / 5), _mm_mul_ps(t2, series));
+			series = _mm_add_ps(_mm_set1_ps(1.0f / 3), _mm_mul_ps(t2, series));
+			series = _mm_add_ps(one, _mm_mul_ps(t2, series));
+			__m128 ln = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), t), series);
+
+			return _mm_add_ps(_mm_mul_ps(e, _mm_set1_ps(6.02059991f)), _mm_mul_ps(ln, _mm_set1_ps(8.68588964f)));
+		}
+#endif
+	};
+
+	inline float ReaVolumePan::VolumeDB() const { return Util::ToDecibel(RawVolume); }
+
+	// Compile-time counterparts of ReaOptions::ConvertVolumeToDB and NormalizePan for
+	// LoadProjectFile<VolumePolicy, PanPolicy>. Volume is converted in one pass over every
+	// gain once the project is loaded, pan as it is read.
+	struct ReaVolumeDB {
+		static constexpr bool Converts = true;
+		static void Convert(float* amplitudes, size_t count, bool exact) { Util::ToDecibel(amplitudes, count, exact); }
+	};
+
+	struct ReaVolumeAmplitude {
+		static constexpr bool Converts = false;
+		static void Convert(float*, size_t, bool) {}
+	};
+
+	struct ReaPanNormalized {
+		static float Convert(float pan) { return pan; }
+	};
+
+	struct ReaPanPercent {
+		static float Convert(float pan) { return pan * 100.0f; }
 	};
 
+	template <class Target>
+	class ReaFieldTable;
+
 	// Core parser functions
 	class Parser {
 	public:
-		friend ReaProject LoadProjectFile(const char* filepath, ReaOptions options);
+		template <class VolumePolicy, class PanPolicy>
+		friend ReaProject LoadProjectFile(const char* filepath, ReaOptions options, ReaParseStats* stats);
+
+		template <class Target>
+		friend class ReaFieldTable;
 
 		Parser() = delete;
 		Parser(const Parser&) = delete;
 	private:
 		static void LoadMetadata(FILE* fp, ReaProject& project);
 		static void LoadProperties(FILE* fp, ReaProject& project);
+		template <class PanPolicy>
 		static void LoadTracks(FILE* fp, ReaProject& project);
+		template <class PanPolicy>
 		static void LoadMasterTrack(FILE* fp, ReaProject& project);
+		template <class PanPolicy>
 		static void LoadMediaItem(FILE* fp, ReaTrack& track);
+		template <class VolumePolicy>
+		static void ConvertVolumes(ReaProject& project);
 		static void LoadFX(FILE* fp, ReaTrack& track);
+
+		// Instrumentation
+		static void PhaseBegin(ReaPhase phase, FILE* fp, ReaProject& project);
+		static void PhaseEnd(ReaPhase phase, FILE* fp, ReaProject& project);
+		static char* ReadLine(ReaBuffer& buffer, FILE* fp, ReaProject& project);
+		static char* ReadFile(ReaBuffer& buffer, FILE* fp, ReaProject& project);
+		static void Unread(const char* line, ReaProject& project);
+		static bool ChunkEnded(const char* line, int depth, size_t indent, ReaProject& project);
+		static void Rewind(FILE* fp, ReaProject& project);
+		static void CountChunk(const char* line, ReaProject& project);
+		static void CountLine(size_t indent, size_t fieldIndent, int fields, ReaProject& project);
+
+		// Handler dispatch
+		static void Dispatch(const char* line, ReaProject& project);
+		static void SkipChunk(ReaBuffer& buffer, FILE* fp, ReaProject& project);
+
+		// Reads a string field, quoted or not, and advances line past it
+		static bool ReadString(const char*& line, std::string& value);
+	};
+
+	enum class ReaFieldType {
+		Float, Int, Unsigned, Bool, String
+	};
+
+	// A value on a project line: the line's keyword, which of the values after the keyword
+	// it is, counting from 0, and the member of Target it's stored in
+	template <class Target>
+	struct ReaField {
+		const char* Keyword;
+		unsigned int Argument;
+		ReaFieldType Type;
+		union {
+			float Target::* Float;
+			int Target::* Int;
+			unsigned int Target::* Unsigned;
+			bool Target::* Bool;
+			std::string Target::* String;
+		} Member;
+
+		ReaField(const char* keyword, unsigned int argument, float Target::* member)
+			: Keyword(keyword), Argument(argument), Type(ReaFieldType::Float) { Member.Float = member; }
+		ReaField(const char* keyword, unsigned int argument, int Target::* member)
+			: Keyword(keyword), Argument(argument), Type(ReaFieldType::Int) { Member.Int = member; }
+		ReaField(const char* keyword, unsigned int argument, unsigned int Target::* member)
+			: Keyword(keyword), Argument(argument), Type(ReaFieldType::Unsigned) { Member.Unsigned = member; }
+		ReaField(const char* keyword, unsigned int argument, bool Target::* member)
+			: Keyword(keyword), Argument(argument), Type(ReaFieldType::Bool) { Member.Bool = member; }
+		ReaField(const char* keyword, unsigned int argument, std::string Target::* member)
+			: Keyword(keyword), Argument(argument), Type(ReaFieldType::String) { Member.String = member; }
+	};
+
+	// Keywords hashed (FNV-1a, open addressing) for lookup by the start of a line, so a line
+	// costs one probe however many keywords there are. Entries sharing a keyword are
+	// indexed as a run.
+	class ReaKeywordIndex {
+	public:
+		struct Run {
+			uint32_t First = 0, Count = 0;
+		};
+
+		// keywords[i] is entry i's, with entries sharing a keyword next to each other
+		void Build(const std::vector<const char*>& keywords) {
+			size_t slots = 16;
+			while (slots < keywords.size() * 2)
+				slots *= 2;
+			m_slots.assign(slots, Slot());
+			for (size_t i = 0; i < keywords.size();) {
+				size_t count = 1;
+				while (i + count < keywords.size() && strcmp(keywords[i], keywords[i + count]) == 0)
+					count++;
+
+				Slot slot;
+				size_t length;
+				slot.Hash = Hash(keywords[i], length);
+				slot.Keyword.assign(keywords[i], length);
+				slot.Entries.First = static_cast<uint32_t>(i);
+				slot.Entries.Count = static_cast<uint32_t>(count);
+				size_t at = slot.Hash & (slots - 1);
+				while (m_slots[at].Entries.Count)
+					at = (at + 1) & (slots - 1);
+				m_slots[at] = std::move(slot);
+				i += count;
+			}
+		}
+
+		// Entries for the keyword text starts with, nullptr if it has none. length is set to the
+		// keyword's length either way.
+		const Run* Find(const char* text, size_t& length) const {
+			uint32_t hash = Hash(text, length);
+			if (m_slots.empty())
+				return nullptr;
+
+			size_t mask = m_slots.size() - 1;
+			for (size_t at = hash & mask; m_slots[at].Entries.Count; at = (at + 1) & mask) {
+				const Slot& slot = m_slots[at];
+				if (slot.Hash == hash && slot.Keyword.size() == length && memcmp(slot.Keyword.data(), text, length) == 0)
+					return &slot.Entries;
+			}
+			return nullptr;
+		}
+
+		static bool Separator(char c) {
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0';
+		}
+
+	private:
+		struct Slot {
+			std::string Keyword;
+			uint32_t Hash = 0;
+			Run Entries;
+		};
+		std::vector<Slot> m_slots;
+
+		// FNV-1a of the keyword starting text, up to the first separator
+		static uint32_t Hash(const char* text, size_t& length) {
+			uint32_t hash = 2166136261u;
+			for (length = 0; !Separator(text[length]); length++)
+				hash = (hash ^ static_cast<uint8_t>(text[length])) * 16777619u;
+			return hash;
+		}
 	};
 
+	// Fields looked up by the keyword starting a line, so a line costs one probe whether or
+	// not it carries any. A keyword's arguments are read in one pass, so each may be
+	// described once; values skipped to reach one are taken to be unquoted.
+	template <class Target>
+	class ReaFieldTable {
+	public:
+		ReaFieldTable(std::initializer_list<ReaField<Target>> fields) : m_fields(fields) {
+			std::stable_sort(m_fields.begin(), m_fields.end(), [](const ReaField<Target>& a, const ReaField<Target>& b) {
+				int order = strcmp(a.Keyword, b.Keyword);
+				return order < 0 || (order == 0 && a.Argument < b.Argument);
+			});
+
+			std::vector<const char*> keywords;
+			for (const ReaField<Target>& field : m_fields)
+				keywords.push_back(field.Keyword);
+			m_index.Build(keywords);
+		}
+
+		// Stores the values line carries into target and returns how many. line starts at its keyword.
+		int Read(const char* line, Target& target) const {
+			size_t length;
+			const ReaKeywordIndex::Run* run = m_index.Find(line, length);
+			return run ? Store(line + length, *run, target) : 0;
+		}
+
+	private:
+		std::vector<ReaField<Target>> m_fields;
+		ReaKeywordIndex m_index;
+
+		int Store(const char* values, const ReaKeywordIndex::Run& run, Target& target) const {
+			int stored = 0;
+			unsigned int argument = 0;
+			for (uint32_t i = run.First; i < run.First + run.Count; i++, argument++) {
+				const ReaField<Target>& field = m_fields[i];
+				for (; argument < field.Argument; argument++) {
+					values += strspn(values, " \t");
+					values += strcspn(values, " \t\r\n");
+				}
+				values += strspn(values, " \t");
+				if (ReaKeywordIndex::Separator(*values))
+					break;
+
+				// Like sscanf, the first value that doesn't read ends the line
+				char* end = nullptr;
+				switch (field.Type) {
+				case ReaFieldType::Float: {
+					float value = strtof(values, &end);
+					if (end != values)
+						target.*field.Member.Float = value;
+					break;
+				}
+				case ReaFieldType::Int: {
+					long value = strtol(values, &end, 0);
+					if (end != values)
+						target.*field.Member.Int = static_cast<int>(value);
+					break;
+				}
+				case ReaFieldType::Unsigned: {
+					unsigned long value = strtoul(values, &end, 0);
+					if (end != values)
+						target.*field.Member.Unsigned = static_cast<unsigned int>(value);
+					break;
+				}
+				case ReaFieldType::Bool: {
+					long value = strtol(values, &end, 0);
+					if (end != values)
+						target.*field.Member.Bool = value != 0;
+					break;
+				}
+				case ReaFieldType::String: {
+					const char* next = values;
+					if (Parser::ReadString(next, target.*field.Member.String))
+						end = const_cast<char*>(next);
+					break;
+				}
+				}
+				if (!end || end == values)
+					break;
+				values = end;
+				stored++;
+			}
+			return stored;
+		}
+	};
+
+	// A line handed to a ReaHandlers callback
+	struct ReaLine {
+		// The line from its first non-blank character, newline included. A line longer than
+		// the parser's buffer comes in parts, the later ones Continued.
+		const char* Text = nullptr;
+		bool Continued = false;
+
+		uint64_t Number = 0;   // Line number, from 1
+		int Depth = 0;         // Chunks open after the line
+
+		// The project, and the track and media item being loaded, as loaded so far. Track and
+		// Item are nullptr outside of them and on their headers.
+		const ReaProject* Project = nullptr;
+		const ReaTrack* Track = nullptr;
+		const ReaMediaItem* Item = nullptr;
+	};
+
+	// Callbacks for chunks and lines the parser doesn't read itself, such as the <EXT chunks
+	// extensions keep their data in. Handlers are looked up through the same hashed index as
+	// the parser's own fields, and chunks without any are skipped looking at nothing but
+	// where their lines start.
+	//
+	// They're called in file order while tracks load, on the loading thread, so LoadProjectFiles
+	// calls them from its workers at once. An exception thrown by one ends the load: it leaves
+	// LoadProjectFile as it is, and becomes the file's error under LoadProjectFiles and
+	// ForEachProjectFile.
+	class ReaHandlers {
+	public:
+		friend Parser;
+		using Handler = std::function<void(const ReaLine&)>;
+
+		// Calls handler with every line of chunks tagged tag, from their "<tag" header to their
+		// footer, nested chunks included
+		ReaHandlers& OnChunk(const std::string& tag, Handler handler) {
+			m_chunks.Add(tag, std::move(handler));
+			return *this;
+		}
+
+		// Calls handler with lines starting with keyword, other than those of handled chunks
+		ReaHandlers& OnLine(const std::string& keyword, Handler handler) {
+			m_lines.Add(keyword, std::move(handler));
+			return *this;
+		}
+
+	private:
+		// Handlers in order of their keywords, then of registration
+		struct Handlers {
+			std::vector<std::pair<std::string, Handler>> Entries;
+			ReaKeywordIndex Index;
+
+			void Add(const std::string& keyword, Handler handler) {
+				auto after = std::upper_bound(Entries.begin(), Entries.end(), keyword,
+					[](const std::string& k, const std::pair<std::string, Handler>& entry) { return k < entry.first; });
+				Entries.emplace(after, keyword, std::move(handler));
+
+				std::vector<const char*> keywords;
+				for (const auto& entry : Entries)
+					keywords.push_back(entry.first.c_str());
+				Index.Build(keywords);
+			}
+
+			void Call(uint32_t first, uint32_t count, const ReaLine& line) const {
+				for (uint32_t i = first; i < first + count; i++)
+					Entries[i].second(line);
+			}
+		} m_chunks, m_lines;
+	};
+
+	// Loads Reaper project data from file, converting volume and pan as the policies say
+	// (ReaVolumeDB or ReaVolumeAmplitude, ReaPanNormalized or ReaPanPercent) instead of by
+	// options.ConvertVolumeToDB and NormalizePan. With REAPARSER_STATIC only these four
+	// combinations are compiled into the library.
+	template <class VolumePolicy, class PanPolicy>
+	ReaProject LoadProjectFile(const char* filepath, ReaOptions options, ReaParseStats* stats);
+
+	template <class VolumePolicy, class PanPolicy>
+	ReaProject LoadProjectFile(const char* filepath, ReaOptions options) {
+		return LoadProjectFile<VolumePolicy, PanPolicy>(filepath, options, nullptr);
+	}
+
+	// Loads Reaper project data from file.
+	// If stats is set and the parser is built with REAPARSER_STATS, it is filled in as well.
+	REAPARSER_API ReaProject LoadProjectFile(const char* filepath, ReaOptions options, ReaParseStats* stats);
+
 	// Loads Reaper project data from file
-	inline ReaProject LoadProjectFile(const char* filepath, ReaOptions options) {
+	REAPARSER_API ReaProject LoadProjectFile(const char* filepath, ReaOptions options);
+
+	// Loads many Reaper projects on a pool of worker threads like LoadProjectFiles, but hands
+	// each to callback on the worker that loaded it rather than keeping them all. callback
+	// gets the index of the file, the worker's number (below threads), the project, and
+	// why it failed to load, empty if it didn't. Calls from different workers overlap.
+	// Whatever a load throws, std::exception or not, is caught and handed over as the error;
+	// only an exception from callback itself leaves ForEachProjectFile, once the loads
+	// already running have finished and without starting any more.
+	REAPARSER_API void ForEachProjectFile(const std::vector<std::string>& filepaths, ReaOptions options,
+		const std::function<void(size_t index, unsigned int worker, ReaProject& project, const std::string& error)>& callback,
+		unsigned int threads = 0);
+
+	// Loads many Reaper projects on a pool of worker threads (0 for one per hardware thread).
+	// Projects are returned in the order of filepaths. A file that fails to load leaves an
+	// invalid project in its place, with the reason in errors if given.
+	REAPARSER_API std::vector<ReaProject> LoadProjectFiles(const std::vector<std::string>& filepaths, ReaOptions options,
+		unsigned int threads = 0, std::vector<std::string>* errors = nullptr);
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	template <class VolumePolicy, class PanPolicy>
+	ReaProject LoadProjectFile(const char* filepath, ReaOptions options, ReaParseStats* stats) {
+		ReaTraceScope trace("file", "load", filepath);
 		ReaProject project;
 		project.m_options = options;
 
-		FILE* fp = fopen(filepath, "rb");
+		REAPARSER_STAT(
+			project.m_stats = stats;
+			if (stats)
+				*stats = ReaParseStats();
+			ReaAllocCounters allocsBefore = ReaAllocCounters::Current();
+			auto loadStart = std::chrono::steady_clock::now();
+		);
+		(void)stats;
+
+		FILE* fp;
+		{
+			ReaTraceScope io("open", "io", filepath);
+			fp = fopen(filepath, "rb");
+		}
 
 		if (!fp) {
 			throw BadFile("Unable to load Reaper project: " + std::string(filepath));
@@ -200,20 +1133,389 @@ namespace ReaParser {
 		}
 		project.Filepath = filepath;
 
-		Parser::LoadMetadata(fp, project);
-		Parser::LoadProperties(fp, project);
-		Parser::LoadTracks(fp, project);
+		try {
+			Parser::LoadMetadata(fp, project);
+			Parser::LoadProperties(fp, project);
+			Parser::LoadTracks<PanPolicy>(fp, project);
+		}
+		catch (...) {
+			fclose(fp);
+			throw;
+		}
 
 		fclose(fp);
+		Parser::ConvertVolumes<VolumePolicy>(project);
+
+		REAPARSER_STAT(
+			if (stats) {
+				ReaAllocCounters& allocs = ReaAllocCounters::Current();
+				stats->Allocations = allocs.Count - allocsBefore.Count;
+				stats->AllocatedBytes = allocs.Bytes - allocsBefore.Bytes;
+				stats->TotalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+			}
+			project.m_stats = nullptr;
+		);
+
 		project.m_valid = true;
 		return project;
 	}
 
-	inline void Parser::LoadMetadata(FILE* fp, ReaProject& project) {
+	// Dispatches to the loader specialized on the options' conversions
+	REAPARSER_API ReaProject LoadProjectFile(const char* filepath, ReaOptions options, ReaParseStats* stats) {
+		if (options.ConvertVolumeToDB) {
+			if (options.NormalizePan)
+				return LoadProjectFile<ReaVolumeDB, ReaPanNormalized>(filepath, options, stats);
+			return LoadProjectFile<ReaVolumeDB, ReaPanPercent>(filepath, options, stats);
+		}
+		if (options.NormalizePan)
+			return LoadProjectFile<ReaVolumeAmplitude, ReaPanNormalized>(filepath, options, stats);
+		return LoadProjectFile<ReaVolumeAmplitude, ReaPanPercent>(filepath, options, stats);
+	}
+
+	REAPARSER_API ReaProject LoadProjectFile(const char* filepath, ReaOptions options) {
+		return LoadProjectFile(filepath, options, nullptr);
+	}
+
+	REAPARSER_API void ForEachProjectFile(const std::vector<std::string>& filepaths, ReaOptions options,
+		const std::function<void(size_t, unsigned int, ReaProject&, const std::string&)>& callback, unsigned int threads) {
+		ReaThreadPool::For(filepaths.size(), threads, [&](size_t i, unsigned int worker) {
+			ReaProject project;
+			std::string error;
+			try {
+				project = LoadProjectFile(filepaths[i].c_str(), options);
+			}
+			catch (Exception& e) {
+				error = e.What();
+			}
+			catch (std::exception& e) {
+				error = e.what();
+			}
+			catch (...) {
+				error = "Unknown error loading project file";
+			}
+			callback(i, worker, project, error);
+		});
+	}
+
+	REAPARSER_API std::vector<ReaProject> LoadProjectFiles(const std::vector<std::string>& filepaths, ReaOptions options,
+		unsigned int threads, std::vector<std::string>* errors) {
+		std::vector<ReaProject> projects(filepaths.size());
+		if (errors)
+			errors->assign(filepaths.size(), std::string());
+
+		ForEachProjectFile(filepaths, options, [&](size_t index, unsigned int, ReaProject& project, const std::string& error) {
+			projects[index] = std::move(project);
+			if (errors)
+				(*errors)[index] = error;
+		}, threads);
+		return projects;
+	}
+
+	// Volumes are read as amplitudes and converted in one batch, gathered from the master,
+	// tracks and items so the conversion runs over a contiguous array
+	template <class VolumePolicy>
+	void Parser::ConvertVolumes(ReaProject& project) {
+		if (!VolumePolicy::Converts)
+			return;
+
+		ReaTraceScope trace("volume", "convert");
+		std::vector<float> volumes;
+		for (auto& track : project.Tracks) {
+			volumes.push_back(track.RawVolume);
+			for (auto& item : track.MediaItems)
+				volumes.push_back(item.RawVolume);
+		}
+
+		VolumePolicy::Convert(volumes.data(), volumes.size(), project.m_options.ExactDecibels);
+
+		size_t i = 0;
+		for (auto& track : project.Tracks) {
+			track.Volume = volumes[i++];
+			for (auto& item : track.MediaItems)
+				item.Volume = volumes[i++];
+		}
+	}
+
+	REAPARSER_API void Parser::PhaseBegin(ReaPhase phase, FILE* fp, ReaProject& project) {
+		REAPARSER_PHASE_BEGIN(phase, fp);
+		(void)phase; (void)fp; (void)project;
+
+		REAPARSER_STAT(
+			if (ReaParseStats* stats = project.m_stats) {
+				auto now = std::chrono::steady_clock::now();
+				if (stats->m_depth > 0)
+					stats->PhaseSeconds[static_cast<size_t>(stats->m_stack[stats->m_depth - 1])] +=
+						std::chrono::duration<double>(now - stats->m_since).count();
+				stats->m_stack[stats->m_depth++] = phase;
+				stats->m_since = now;
+			}
+		);
+	}
+
+	REAPARSER_API void Parser::PhaseEnd(ReaPhase phase, FILE* fp, ReaProject& project) {
+		REAPARSER_PHASE_END(phase, fp);
+		(void)phase; (void)fp; (void)project;
+
+		REAPARSER_STAT(
+			if (ReaParseStats* stats = project.m_stats) {
+				auto now = std::chrono::steady_clock::now();
+				stats->PhaseSeconds[static_cast<size_t>(phase)] +=
+					std::chrono::duration<double>(now - stats->m_since).count();
+				stats->m_depth--;
+				stats->m_since = now;
+			}
+		);
+	}
+
+	REAPARSER_API char* Parser::ReadLine(ReaBuffer& buffer, FILE* fp, ReaProject& project) {
+		ReaProject::ReadState& read = project.m_read;
+		char* line;
+
+		// Hand back a line returned by Unread first
+		if (!read.Pending.empty()) {
+			strcpy(buffer, read.Pending.c_str());
+			read.Pending.clear();
+			line = buffer;
+		}
+		else if (!(line = ReadFile(buffer, fp, project)))
+			return NULL;
+
+		size_t length = strlen(line);
+		const ReaOptions& options = project.m_options;
+		read.Continued = read.LineLength != 0;
+
+		// Only the start of a line says whether it opens or closes a chunk,
+		// the rest of a line longer than the buffer arrives in later reads
+		if (read.LineLength == 0) {
+			read.Line++;
+			read.Indent = strspn(line, " \t");
+			read.Header = line[read.Indent] == '<';
+			read.Footer = line[read.Indent] == '>';
+
+			if (read.Header)
+				read.Depth++;
+			else if (read.Footer)
+				read.Depth--;
+
+			if (options.MaxDepth && read.Depth > static_cast<int>(options.MaxDepth))
+				throw BadFile("Reaper project nested too deeply: " + project.Filepath +
+					" (line " + std::to_string(read.Line) + ")");
+		}
+
+		read.LineLength += length;
+		if (options.MaxLineLength && read.LineLength > options.MaxLineLength)
+			throw BadFile("Reaper project line too long: " + project.Filepath +
+				" (line " + std::to_string(read.Line) + ")");
+
+		if (length > 0 && line[length - 1] == '\n')
+			read.LineLength = 0;
+
+		if (read.Handlers)
+			Dispatch(line, project);
+		return line;
+	}
+
+	// Hands a line back to be returned by the next ReadLine, closing the chunk it was read in.
+	// Used when a chunk's footer is missing and the line belongs to one of its ancestors.
+	REAPARSER_API void Parser::Unread(const char* line, ReaProject& project) {
+		ReaProject::ReadState& read = project.m_read;
+
+		// Undo the line's own count, as it's counted again when reread, and close the chunk
+		if (read.Header)
+			read.Depth--;
+		else if (read.Footer)
+			read.Depth++;
+		read.Depth--;
+		read.Line--;
+		read.LineLength = 0;
+		read.Pending = line;
+	}
+
+	// Whether the chunk opened at depth by a header indented by indent has ended with the
+	// current line. Besides its own footer, a footer indented less than its header or a header
+	// indented no deeper than its own also end it: its footer is missing and the line belongs
+	// to an ancestor, so it's handed back for the ancestor to read instead of being swallowed.
+	REAPARSER_API bool Parser::ChunkEnded(const char* line, int depth, size_t indent, ReaProject& project) {
+		ReaProject::ReadState& read = project.m_read;
+
+		if (read.Continued)
+			return false;
+
+		if ((read.Header && read.Indent <= indent) || (read.Footer && read.Indent < indent)) {
+			Unread(line, project);
+			return true;
+		}
+		return read.Depth < depth;
+	}
+
+	// Hands the line just read to its handlers: each line of a handled chunk to the chunk's,
+	// others to their keyword's
+	REAPARSER_API void Parser::Dispatch(const char* line, ReaProject& project) {
+		ReaProject::ReadState& read = project.m_read;
+		const ReaHandlers& handlers = *read.Handlers;
+
+		// A line handed back by Unread comes again
+		if (!read.Continued) {
+			if (read.Line == read.Dispatched)
+				return;
+			read.Dispatched = read.Line;
+		}
+
+		ReaLine view;
+		view.Text = read.Continued ? line : line + read.Indent;
+		view.Continued = read.Continued;
+		view.Number = read.Line;
+		view.Depth = read.Depth;
+		view.Project = &project;
+		view.Track = read.Track;
+		view.Item = read.Item;
+
+		if (read.ChunkCount) {
+			// A header no deeper than the chunk's or a footer shallower ends it, its footer missing
+			bool ended = false, footer = false;
+			if (!read.Continued && (read.Header || read.Footer)) {
+				ended = read.Indent < read.ChunkIndent || (read.Header && read.Indent == read.ChunkIndent);
+				footer = read.Footer && (read.Indent == read.ChunkIndent || read.Depth < read.ChunkDepth);
+			}
+			if (!ended) {
+				handlers.m_chunks.Call(read.ChunkFirst, read.ChunkCount, view);
+				if (footer)
+					read.ChunkCount = 0;
+				return;
+			}
+			read.ChunkCount = 0;
+		}
+		if (read.Continued || read.Footer)
+			return;
+
+		size_t length;
+		if (read.Header) {
+			if (const ReaKeywordIndex::Run* run = handlers.m_chunks.Index.Find(view.Text + 1, length)) {
+				read.ChunkFirst = run->First;
+				read.ChunkCount = run->Count;
+				read.ChunkDepth = read.Depth;
+				read.ChunkIndent = read.Indent;
+				handlers.m_chunks.Call(run->First, run->Count, view);
+			}
+		}
+		else if (const ReaKeywordIndex::Run* run = handlers.m_lines.Index.Find(view.Text, length))
+			handlers.m_lines.Call(run->First, run->Count, view);
+	}
+
+	// Reads past the chunk whose header was just read, looking at nothing but where its lines start
+	REAPARSER_API void Parser::SkipChunk(ReaBuffer& buffer, FILE* fp, ReaProject& project) {
+		int depth = project.m_read.Depth;
+		size_t indent = project.m_read.Indent;
+
+		while (ReadLine(buffer, fp, project) != NULL) {
+			bool ended = ChunkEnded(buffer, depth, indent, project);
+			REAPARSER_STAT(if (project.m_read.Pending.empty()) CountLine(1, 0, 0, project));
+			if (ended)
+				break;
+		}
+	}
+
+	REAPARSER_API void Parser::Rewind(FILE* fp, ReaProject& project) {
+		project.m_read = ReaProject::ReadState();
+		rewind(fp);
+	}
+
+	REAPARSER_API char* Parser::ReadFile(ReaBuffer& buffer, FILE* fp, ReaProject& project) {
+		(void)project;
+
+		// Reads stalling on the disk show up as I/O waits in traces
+		if (ReaTracer* tracer = ReaTracer::Active()) {
+			double start = tracer->Now();
+			char* line = fgets(buffer, ReaBuffer_Max, fp);
+			double duration = tracer->Now() - start;
+
+			if (duration >= tracer->IOThreshold)
+				tracer->Record("read", "io", std::string(), start, duration);
+
+			REAPARSER_STAT(
+				if (ReaParseStats* stats = project.m_stats) {
+					stats->ReadSeconds += duration * 1e-6;
+					if (line) {
+						stats->LinesScanned++;
+						stats->BytesScanned += strlen(line);
+					}
+				}
+			);
+			return line;
+		}
+
+		REAPARSER_STAT(
+			if (ReaParseStats* stats = project.m_stats) {
+				auto start = std::chrono::steady_clock::now();
+				char* line = fgets(buffer, ReaBuffer_Max, fp);
+				stats->ReadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				if (line) {
+					stats->LinesScanned++;
+					stats->BytesScanned += strlen(line);
+				}
+				return line;
+			}
+		);
+
+		return fgets(buffer, ReaBuffer_Max, fp);
+	}
+
+	REAPARSER_API void Parser::CountChunk(const char* line, ReaProject& project) {
+		ReaParseStats* stats = project.m_stats;
+		if (!stats)
+			return;
+
+		while (*line == ' ' || *line == '\t')
+			line++;
+		if (*line != '<')
+			return;
+
+		size_t length = strcspn(++line, " \t\r\n");
+		stats->Chunks[std::string(line, length)]++;
+	}
+
+	// Lines indented deeper than the chunk's own fields belong to nested chunks the loader
+	// doesn't descend into and are skipped, lines at field level matching no field are unknown
+	REAPARSER_API void Parser::CountLine(size_t indent, size_t fieldIndent, int fields, ReaProject& project) {
+		ReaParseStats* stats = project.m_stats;
+		if (!stats)
+			return;
+
+		if (indent > fieldIndent)
+			stats->SkippedLines++;
+		else if (fields == 0)
+			stats->UnknownLines++;
+	}
+
+	REAPARSER_API bool Parser::ReadString(const char*& line, std::string& value) {
+		line += strspn(line, " \t");
+		if (*line == '\0' || *line == '\r' || *line == '\n')
+			return false;
+
+		// Reaper quotes strings containing spaces with whichever quote character they don't contain
+		if (*line == '"' || *line == '\'' || *line == '`') {
+			const char* end = strchr(line + 1, *line);
+			if (!end)
+				return false;
+			value.assign(line + 1, end);
+			line = end + 1;
+		}
+		else {
+			size_t length = strcspn(line, " \t\r\n");
+			value.assign(line, length);
+			line += length;
+		}
+		return true;
+	}
+
+	REAPARSER_API void Parser::LoadMetadata(FILE* fp, ReaProject& project) {
+		PhaseBegin(ReaPhase::Metadata, fp, project);
 		ReaBuffer buffer;
 
 		// Verify valid Reaper project using the first line of the file
-		if (fscanf(fp, "<REAPER_PROJECT %*f \"%i.%i/%[^\"]s\" %*i",
+		// Platform is read into buffer, so bound it by ReaBuffer_Max - 1
+		if (fscanf(fp, "<REAPER_PROJECT %*f \"%i.%i/%1023[^\"]s\" %*i",
 			&project.Version.Major, &project.Version.Minor, buffer) == 3) {
 			if (strcmp(buffer, "win64") == 0 ||
 				strcmp(buffer, "win32") == 0)
@@ -224,7 +1526,6 @@ namespace ReaParser {
 		}
 		else {
 			throw BadFile("Invalid Reaper project: " + project.Filepath);
-			fclose(fp);
 		}
 
 		// Set name
@@ -237,174 +1538,306 @@ namespace ReaParser {
 		if (endIndex != std::string::npos)
 			project.Name = project.Name.substr(0, endIndex);
 
+		PhaseEnd(ReaPhase::Metadata, fp, project);
 
 		// Rewind before loading properties
-		rewind(fp);
+		Rewind(fp, project);
 	}
 
-	inline void Parser::LoadProperties(FILE* fp, ReaProject& project) {
+	REAPARSER_API void Parser::LoadProperties(FILE* fp, ReaProject& project) {
+		PhaseBegin(ReaPhase::Properties, fp, project);
 		ReaBuffer buffer;
 		const char* markerHeader = "  MARKER";
 
-		while (fgets(buffer, ReaBuffer_Max, fp) != NULL) {
+		while (ReadLine(buffer, fp, project) != NULL) {
+			REAPARSER_STAT(CountChunk(buffer, project));
+
 			sscanf(buffer, "  SAMPLERATE %i %*i %*i", &project.SampleRate);
 			sscanf(buffer, "  TEMPO %f %i %i",
 				&project.Tempo.BPM, &project.Tempo.Beats, &project.Tempo.Bars);
+
+			if (strncmp(buffer, "  RECORD_PATH ", 14) == 0) {
+				const char* line = buffer + 14;
+				if (ReadString(line, project.RecordPath))
+					ReadString(line, project.SecondaryRecordPath);
+			}
 		}
 
+		PhaseEnd(ReaPhase::Properties, fp, project);
+
 		// Rewind before loading tracks
-		rewind(fp);
+		Rewind(fp, project);
 	}
 
-	inline void Parser::LoadTracks(FILE* fp, ReaProject& project) {
+	template <class PanPolicy>
+	void Parser::LoadTracks(FILE* fp, ReaProject& project) {
 		// Initialize Master track. It will always be at the 0th index!
-		LoadMasterTrack(fp, project);
+		LoadMasterTrack<PanPolicy>(fp, project);
 
+		PhaseBegin(ReaPhase::Tracks, fp, project);
 		ReaBuffer buffer;
 		int trackCount = 0;
-		const char* trackFooter = "  >";
 		const char* itemHeader = "    <ITEM";
+		static const ReaFieldTable<ReaTrack> trackFields = {
+			{ "NAME", 0, &ReaTrack::Name },
+			{ "VOLPAN", 0, &ReaTrack::RawVolume },
+			{ "VOLPAN", 1, &ReaTrack::RawPan },
+			{ "MUTESOLO", 0, &ReaTrack::Muted },
+			{ "IPHASE", 0, &ReaTrack::PhaseInverted },
+			{ "ISBUS", 1, &ReaTrack::FolderDepth },
+			{ "NCHAN", 0, &ReaTrack::Channels },
+			{ "SEL", 0, &ReaTrack::Selected },
+		};
+
+		// This is the pass handlers are called from, the file being read through once more
+		project.m_read.Handlers = project.m_options.Handlers.get();
 
 		// Scan entire file for tracks
 		// Using the XOR operator with scanset specifier is helpful here
-		while (fgets(buffer, ReaBuffer_Max, fp) != NULL) {
+		while (ReadLine(buffer, fp, project) != NULL) {
 			
 			// Track found, begin parsing
 			if (sscanf(buffer, "  <TRACK {%[^}]s}", &buffer) == 1) {
+				ReaTraceScope trace("track", "parse", buffer);
 				ReaTrack track;
 				track.m_project = &project;
 				track.GUID = buffer;
 				track.NumericID = ++trackCount;
+				project.m_read.Track = &track;
 
 				const char* fxChainHeader = "    <FXCHAIN";
+				int depth = project.m_read.Depth;
 
 				// Read from track data
-				while (fgets(buffer, ReaBuffer_Max, fp) != NULL) {
-					if (strncmp(buffer, trackFooter, strlen(trackFooter)) == 0)
+				while (ReadLine(buffer, fp, project) != NULL) {
+					if (ChunkEnded(buffer, depth, 2, project))
 						break; // Track footer hit
 
-					if (sscanf(buffer, "    NAME \"%[^\"]s\"", buffer) == 1 ||
-						sscanf(buffer, "    NAME %s", buffer) == 1)
-						track.Name = buffer;
-					sscanf(buffer, "    VOLPAN %f %f %*i %*i %*i",
-						&track.Volume, &track.Pan);
-					int invPhase = 0;
-					if (sscanf(buffer, "    IPHASE %i", &invPhase) == 1) {
-						track.PhaseInverted = invPhase;
-					}
-					int muted = 0;
-					if (sscanf(buffer, "    MUTESOLO %i %*i %*i", &muted) == 1) {
-						track.Muted = muted;
-					}
+					// Number of fields read from this line, only used for statistics
+					int fields = 0;
+					REAPARSER_STAT(size_t indent = project.m_read.Indent);
+
+					if (!project.m_read.Continued && project.m_read.Indent == 4)
+						fields += trackFields.Read(buffer + 4, track) > 0;
 
 					// Load MediaItem
-					if (strncmp(buffer, itemHeader, strlen(itemHeader)) == 0)
-						LoadMediaItem(fp, track);
+					if (strncmp(buffer, itemHeader, strlen(itemHeader)) == 0) {
+						LoadMediaItem<PanPolicy>(fp, track);
+						fields++;
+					}
 
 					// Load FX
-					if (strncmp(buffer, fxChainHeader, strlen(fxChainHeader)) == 0) {
+					else if (strncmp(buffer, fxChainHeader, strlen(fxChainHeader)) == 0) {
 						LoadFX(fp, track);
+						fields++;
 					}
-				}
 
-				// Apply options
-				ReaOptions options = track.m_project->m_options;
+					// Other chunks of the track
+					else if (project.m_read.Header && project.m_read.Indent == 4 && !project.m_read.Continued)
+						SkipChunk(buffer, fp, project);
 
-				if (options.ConvertVolumeToDB)
-					track.Volume = Util::ToDecibel(track.Volume);
-				if (!options.NormalizePan)
-					track.Pan *= 100.0f;
+					REAPARSER_STAT(CountLine(indent, 4, fields, project));
+				}
 
+				// Without a VOLPAN line these are the defaults, as if serialized as 1 and 0
+				track.Volume = track.RawVolume;
+				track.Pan = PanPolicy::Convert(track.RawPan);
+				project.m_read.Track = nullptr;
 				project.Tracks.push_back(track);
 			}
+			else {
+				REAPARSER_STAT(CountLine(1, 0, 0, project));
+
+				// Other chunks of the project
+				if (project.m_read.Header && project.m_read.Indent == 2 && !project.m_read.Continued)
+					SkipChunk(buffer, fp, project);
+			}
 		}
+
+		PhaseEnd(ReaPhase::Tracks, fp, project);
 	}
 
-	inline void Parser::LoadMasterTrack(FILE* fp, ReaProject& project) {
+	template <class PanPolicy>
+	void Parser::LoadMasterTrack(FILE* fp, ReaProject& project) {
+		PhaseBegin(ReaPhase::Master, fp, project);
 		ReaBuffer buffer;
 		ReaTrack master;
 		master.m_project = &project;
 		master.GUID = "0";
 		master.Name = "MASTER";
+		static const ReaFieldTable<ReaTrack> masterFields = {
+			{ "MASTER_NCH", 1, &ReaTrack::Channels }, // Output channels
+			{ "MASTER_VOLUME", 0, &ReaTrack::RawVolume },
+			{ "MASTER_VOLUME", 1, &ReaTrack::RawPan },
+		};
+
+		while (ReadLine(buffer, fp, project) != NULL) {
+			if (!project.m_read.Continued && project.m_read.Indent == 2)
+				masterFields.Read(buffer + 2, master);
+		}
 
-		while (fgets(buffer, ReaBuffer_Max, fp) != NULL) {
-			// Second digit is output channels
-			sscanf(buffer, "  MASTER_NCH %*i %i", &master.Channels);
-			sscanf(buffer, "  MASTER_VOLUME %f %f %*i %*i %*i",
-				&master.Volume, &master.Pan);
-		}		
-		
-		// Apply options
-		ReaOptions options = project.m_options;
-
-		if (options.ConvertVolumeToDB)
-			master.Volume = Util::ToDecibel(master.Volume);
-		if (!options.NormalizePan)
-			master.Pan *= 100.0f;
-
+		master.Volume = master.RawVolume;
+		master.Pan = PanPolicy::Convert(master.RawPan);
 		project.Tracks.push_back(master);
 
+		PhaseEnd(ReaPhase::Master, fp, project);
+
 		// Rewind before returning to load tracks
-		rewind(fp);
+		Rewind(fp, project);
 	}
 
-	inline void Parser::LoadMediaItem(FILE* fp, ReaTrack& track) {
+	template <class PanPolicy>
+	void Parser::LoadMediaItem(FILE* fp, ReaTrack& track) {
+		ReaProject& project = *track.m_project;
+		PhaseBegin(ReaPhase::Items, fp, project);
 		ReaBuffer buffer;
 		ReaMediaItem item;
-		const char* itemFooter = "    >";
+		int depth = project.m_read.Depth;
+		project.m_read.Item = &item;
 		const char* midiHeader = "      <SOURCE MIDI";
 		const char* waveHeader = "      <SOURCE WAVE";
 		const char* mp3Header  = "      <SOURCE MP3";
+		const char* takeHeader = "      TAKE";
+		static const ReaFieldTable<ReaMediaItem> itemFields = {
+			{ "POSITION", 0, &ReaMediaItem::Start },
+			{ "LENGTH", 0, &ReaMediaItem::Length },
+			{ "MUTE", 0, &ReaMediaItem::Muted },
+			{ "SEL", 0, &ReaMediaItem::Selected },
+			{ "FADEIN", 1, &ReaMediaItem::FadeIn },
+			{ "FADEOUT", 1, &ReaMediaItem::FadeOut },
+			{ "VOLPAN", 0, &ReaMediaItem::RawVolume },
+			{ "VOLPAN", 1, &ReaMediaItem::RawPan },
+		};
+
+		// An item's VOLPAN holds the item volume, the take pan, the take volume and the pan law,
+		// the take being the first. The item has no pan of its own and takes the first take's.
+		// Later takes have theirs on TAKEVOLPAN.
+		static const ReaFieldTable<ReaTake> takeFields = {
+			{ "NAME", 0, &ReaTake::Name },
+			{ "SOFFS", 0, &ReaTake::StartOffset },
+			{ "PLAYRATE", 0, &ReaTake::PlayRate },
+			{ "VOLPAN", 1, &ReaTake::RawPan },
+			{ "VOLPAN", 2, &ReaTake::RawVolume },
+			{ "TAKEVOLPAN", 0, &ReaTake::RawPan },
+			{ "TAKEVOLPAN", 1, &ReaTake::RawVolume },
+		};
+
+		// Takes go straight into the project's list. The first starts with the item and each
+		// TAKE line starts another, TAKE SEL the active one. With ActiveTakesOnly, takes before
+		// the active one are dropped when it starts and those after it are skipped.
+		ReaTakes& takes = project.Takes;
+		size_t firstTake = takes.size(), index = 0, active = 0;
+		bool activeOnly = project.m_options.ActiveTakesOnly, skipping = false, hasTake = false;
+		ReaTake take;
+
+		while (ReadLine(buffer, fp, project) != NULL) {
+			if (ChunkEnded(buffer, depth, 4, project))
+				break; // Item footer hit
+
+			// Number of fields read from this line, only used for statistics
+			int fields = 0;
+			REAPARSER_STAT(size_t indent = project.m_read.Indent);
+
+			// TAKE on its own or followed by flags, not TAKEVOLPAN and the like
+			if (strncmp(buffer, takeHeader, 10) == 0 && strchr(" \r\n", buffer[10])) {
+				bool selected = strstr(buffer + 10, " SEL") != NULL;
+				if (!skipping)
+					takes.push_back(std::move(take));
+				take = ReaTake();
+				hasTake = true;
+				index++;
+
+				if (selected && activeOnly)
+					takes.resize(firstTake);
+				if (selected)
+					active = activeOnly ? 0 : index;
+				skipping = activeOnly && !selected;
+				REAPARSER_STAT(CountLine(indent, 6, 1, project));
+				continue;
+			}
+			if (skipping) {
+				REAPARSER_STAT(CountLine(indent, 6, 0, project));
+				if (project.m_read.Header && !project.m_read.Continued)
+					SkipChunk(buffer, fp, project);
+				continue;
+			}
 
-		while (fgets(buffer, ReaBuffer_Max, fp) != NULL) {
-			if (strncmp(buffer, itemFooter, strlen(itemFooter)) == 0)
-				break;
+			if (!project.m_read.Continued && project.m_read.Indent == 6) {
+				fields += itemFields.Read(buffer + 6, item) > 0;
+				fields += takeFields.Read(buffer + 6, take) > 0;
+			}
 
-			sscanf(buffer, "      POSITION %f", &item.Start);
-			sscanf(buffer, "      LENGTH %f", &item.Length);
-			sscanf(buffer, "      MUTE %i %*i", &item.Muted);
-			if (sscanf(buffer, "      NAME \"%[^\"]s\"", buffer) == 1 ||
-				sscanf(buffer, "      NAME %s", buffer) == 1)
-				item.Name = buffer;
-			sscanf(buffer, "      VOLPAN %f %f %*f %*f",
-				&item.Volume, &item.Pan);
-
-			if (strncmp(buffer, midiHeader, strlen(midiHeader)) == 0)
-				item.Type = ReaMediaType::Midi;
-			if (strncmp(buffer, waveHeader, strlen(waveHeader)) == 0 ||
+			if (strncmp(buffer, midiHeader, strlen(midiHeader)) == 0) {
+				take.Type = ReaMediaType::Midi;
+				hasTake = true;
+				fields++;
+
+				// Nothing is read from the events
+				SkipChunk(buffer, fp, project);
+			}
+			else if (strncmp(buffer, waveHeader, strlen(waveHeader)) == 0 ||
 				strncmp(buffer, mp3Header, strlen(mp3Header)) == 0) {
-				item.Type = ReaMediaType::Sample;
+				take.Type = ReaMediaType::Sample;
+				hasTake = true;
+				fields++;
 				// Advance to next line and attempt to grab filepath
-				fgets(buffer, ReaBuffer_Max, fp);
-				if (sscanf(buffer, "        FILE \"%[^\"]s\" %*f", &buffer) == 1)
-					item.Filepath = buffer;
+				ReadLine(buffer, fp, project);
+				const char* file = buffer + strspn(buffer, " ");
+				if (strncmp(file, "FILE ", 5) == 0) {
+					file += 5;
+					ReadString(file, take.Filepath);
+				}
 			}
-		}
 
-		// Apply options
-		ReaOptions options = track.m_project->m_options;
+			// Other chunks of the item
+			else if (project.m_read.Header && project.m_read.Indent == 6 && !project.m_read.Continued)
+				SkipChunk(buffer, fp, project);
 
-		if (options.ConvertVolumeToDB)
-			item.Volume = Util::ToDecibel(item.Volume);
-		if (!options.NormalizePan)
-			item.Pan *= 100.0f;
+			REAPARSER_STAT(CountLine(indent, 6, fields, project));
+		}
+
+		// An empty item has no takes, a take has a name or a source
+		if (!skipping && (hasTake || !take.Name.empty()))
+			takes.push_back(std::move(take));
+		item.FirstTake = static_cast<uint32_t>(firstTake);
+		item.TakeCount = static_cast<uint32_t>(takes.size() - firstTake);
+		if (item.TakeCount) {
+			const ReaTake& playing = takes[firstTake + active];
+			item.ActiveTake = static_cast<uint32_t>(active);
+			item.Name = playing.Name;
+			item.Filepath = playing.Filepath;
+			item.Type = playing.Type;
+			item.StartOffset = playing.StartOffset;
+			item.PlayRate = playing.PlayRate;
+		}
 
+		item.Volume = item.RawVolume;
+		item.Pan = PanPolicy::Convert(item.RawPan);
 		item.End = item.Start + item.Length;
+		project.m_read.Item = nullptr;
 		track.MediaItems.push_back(item);
+
+		PhaseEnd(ReaPhase::Items, fp, project);
 	}
 
-	inline void Parser::LoadFX(FILE* fp, ReaTrack& track) {
+	REAPARSER_API void Parser::LoadFX(FILE* fp, ReaTrack& track) {
+		ReaProject& project = *track.m_project;
+		PhaseBegin(ReaPhase::FX, fp, project);
 		ReaBuffer buffer, fxTypeName, fxName, fxFile;
-		const char* fxChainFooter = "    >";
-		const char* fxFooter = "      >";
+		int depth = project.m_read.Depth;
 
-		while (fgets(buffer, ReaBuffer_Max, fp) != NULL) {
-			if (strncmp(buffer, fxChainFooter, strlen(fxChainFooter)) == 0)
-				break;
+		while (ReadLine(buffer, fp, project) != NULL) {
+			if (ChunkEnded(buffer, depth, 4, project))
+				break; // FX chain footer hit
+
+			// Number of FX read from this line, only used for statistics
+			int fields = 0;
+			REAPARSER_STAT(size_t indent = project.m_read.Indent);
 
 			// Standard FX
 			if (sscanf(buffer, "      <%*s \"%[^:]: %[^\"]\" %s 0 \"\" %*i<%*32s> \"\"", 
 				fxTypeName, fxName, fxFile) == 3) {
+				ReaTraceScope trace("fx", "decode", fxName);
 				ReaFX fx;
 				
 				fx.Name = fxName;
@@ -423,8 +1856,9 @@ namespace ReaParser {
 					fx.Type = ReaFXType::AUi;
 
 				// Grab data strings from FX
-				while (fgets(buffer, ReaBuffer_Max, fp) != NULL) {
-					if (strncmp(buffer, fxFooter, strlen(fxFooter)) == 0)
+				int fxDepth = project.m_read.Depth;
+				while (ReadLine(buffer, fp, project) != NULL) {
+					if (ChunkEnded(buffer, fxDepth, 6, project))
 						break; // FX footer hit
 					
 					fx.Data.append(buffer);
@@ -436,6 +1870,7 @@ namespace ReaParser {
 				fx.Data.erase(std::remove(fx.Data.begin(), fx.Data.end(), '\r'), fx.Data.cend());
 
 				track.FXChain.push_back(fx);
+				fields++;
 			}
 
 			// JesuSonic FX
@@ -446,7 +1881,7 @@ namespace ReaParser {
 				jsFx.Type = ReaFXType::JS;
 
 				// Just grab the next line's data string
-				fgets(buffer, ReaBuffer_Max, fp);
+				ReadLine(buffer, fp, project);
 				jsFx.Data = buffer;
 
 				// And then remove leading spaces
@@ -460,7 +1895,53 @@ namespace ReaParser {
 				}
 
 				track.FXChain.push_back(jsFx);
+				fields++;
 			}
+
+			REAPARSER_STAT(CountLine(indent, 6, fields, project));
 		}
+
+		PhaseEnd(ReaPhase::FX, fp, project);
 	}
-}
\ No newline at end of file
+#endif
+}
+
+// Counting replacements of the global allocation functions, feeding ReaAllocCounters.
+// Define REAPARSER_STATS_ALLOCATOR in exactly one translation unit to enable them.
+// They count with or without REAPARSER_STATS, which only adds ReaParseStats on top.
+#ifdef REAPARSER_STATS_ALLOCATOR
+#include <new>
+#include <cstdlib>
+
+// GCC flags free() on memory from operator new even when operator new is this malloc
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+	ReaParser::ReaAllocCounters& counters = ReaParser::ReaAllocCounters::Current();
+	counters.Count++;
+	counters.Bytes += size;
+
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+// The nothrow forms too, as memory from them is freed through the plain operator delete
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	ReaParser::ReaAllocCounters& counters = ReaParser::ReaAllocCounters::Current();
+	counters.Count++;
+	counters.Bytes += size;
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#endif
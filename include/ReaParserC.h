@@ -0,0 +1,140 @@
+#pragma once
+
+// C API for binding ReaParser from other languages. A project is loaded behind an opaque
+// handle and read through plain structs whose strings are views into the project's own
+// memory, so nothing is copied or converted. Views stay valid until the project is freed.
+//
+// Getters fill caller provided arrays, many entries a call. Nothing here throws: failures
+// return NULL, -1 or 0 with the reason from rea_last_error.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Users of the shared library on Windows define REAPARSER_C_SHARED
+#ifndef REAPARSER_C_API
+#if defined(_WIN32) && defined(REAPARSER_C_EXPORTS)
+#define REAPARSER_C_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(REAPARSER_C_SHARED)
+#define REAPARSER_C_API __declspec(dllimport)
+#elif defined(__GNUC__)
+#define REAPARSER_C_API __attribute__((visibility("default")))
+#else
+#define REAPARSER_C_API
+#endif
+#endif
+
+// Changes whenever a struct or signature below does
+#define REAPARSER_C_ABI_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rea_project rea_project;
+
+// Bytes of a string, not copied. They're followed by a NUL as well.
+typedef struct rea_string {
+	const char* data;
+	size_t size;
+} rea_string;
+
+typedef struct rea_options {
+	// As ReaOptions, non-zero for true
+	int convert_volume_to_db;
+	int normalize_pan;
+	int exact_decibels;
+	size_t max_line_length;
+	unsigned int max_depth;
+} rea_options;
+
+// Media types, as ReaMediaType
+enum { REA_MEDIA_UNDEFINED = 0, REA_MEDIA_SAMPLE, REA_MEDIA_MIDI };
+
+// FX types, as ReaFXType
+enum { REA_FX_UNDEFINED = 0, REA_FX_VST, REA_FX_VST3, REA_FX_VSTI, REA_FX_VST3I, REA_FX_AU, REA_FX_AUI, REA_FX_JS };
+
+typedef struct rea_project_info {
+	rea_string name, filepath, record_path, secondary_record_path;
+	uint32_t version_major, version_minor;
+	uint32_t sample_rate;
+	uint32_t beats, bars;
+	float bpm;
+
+	// Tracks, and items and FX on all of them
+	size_t track_count, item_count, fx_count;
+} rea_project_info;
+
+typedef struct rea_track {
+	rea_string name, guid;
+	uint32_t id, channels;
+
+	// As loaded by the options, and as serialized
+	float volume, pan, raw_volume, raw_pan;
+
+	int32_t folder_depth;
+	uint8_t muted, phase_inverted;
+	size_t item_count, fx_count;
+} rea_track;
+
+typedef struct rea_item {
+	rea_string name, filepath;
+	int32_t type;
+
+	// In seconds
+	float start, end, length, start_offset;
+
+	// As loaded by the options, and as serialized
+	float volume, pan, raw_volume, raw_pan;
+
+	// Index of the item's track
+	uint32_t track;
+	uint8_t muted;
+} rea_item;
+
+typedef struct rea_fx {
+	rea_string name, filepath, data;
+	int32_t type;
+	uint32_t track;
+} rea_fx;
+
+// Item fields rea_project_item_column can gather
+typedef enum rea_item_field {
+	REA_ITEM_START = 0, REA_ITEM_END, REA_ITEM_LENGTH, REA_ITEM_START_OFFSET,
+	REA_ITEM_VOLUME, REA_ITEM_PAN, REA_ITEM_RAW_VOLUME, REA_ITEM_RAW_PAN
+} rea_item_field;
+
+// REAPARSER_C_ABI_VERSION of the library, to check against the header built with
+REAPARSER_C_API int rea_abi_version(void);
+
+// Why the last call on this thread failed, "" if it didn't
+REAPARSER_C_API const char* rea_last_error(void);
+
+REAPARSER_C_API void rea_options_default(rea_options* options);
+
+// options may be NULL for the defaults. Returns NULL if the project can't be loaded.
+REAPARSER_C_API rea_project* rea_project_load(const char* filepath, const rea_options* options);
+REAPARSER_C_API void rea_project_free(rea_project* project);
+
+// Returns 0, or -1 if project or info is NULL
+REAPARSER_C_API int rea_project_info_get(const rea_project* project, rea_project_info* info);
+
+// Bulk getters: fill out with up to capacity entries starting from index first, and
+// return how many were filled, 0 past the end or if project or out is NULL.
+
+REAPARSER_C_API size_t rea_project_tracks(const rea_project* project, size_t first, rea_track* out, size_t capacity);
+
+// Items or FX of one track
+REAPARSER_C_API size_t rea_track_items(const rea_project* project, size_t track, size_t first, rea_item* out, size_t capacity);
+REAPARSER_C_API size_t rea_track_fx(const rea_project* project, size_t track, size_t first, rea_fx* out, size_t capacity);
+
+// Items or FX of every track, by track then index
+REAPARSER_C_API size_t rea_project_items(const rea_project* project, size_t first, rea_item* out, size_t capacity);
+REAPARSER_C_API size_t rea_project_fx(const rea_project* project, size_t first, rea_fx* out, size_t capacity);
+
+// One field of every item, by track then index, into a float array
+REAPARSER_C_API size_t rea_project_item_column(const rea_project* project, rea_item_field field, size_t first,
+	float* out, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,520 @@
+#pragma once
+
+#include "ReaParser.h"
+#include "ReaMedia.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Waveform peaks: the minimum and maximum sample of each channel over runs of frames of
+// a WAV source, at several resolutions, so a waveform can be drawn at any zoom without
+// reading the audio. Peaks are kept in the same layout in memory and in peak files, which
+// are mapped rather than read when loaded from a ReaPeakCache.
+
+namespace ReaParser {
+
+	struct ReaPeakOptions {
+		// Frames summarized by each peak of the finest level
+		unsigned int SamplesPerPeak = 256;
+
+		// Peaks of a level summarized by each peak of the next, coarser one
+		unsigned int Factor = 4;
+
+		// Frames decoded at a time
+		size_t BlockFrames = 1 << 16;
+
+		// Sources built at once, 0 for one per hardware thread
+		unsigned int Threads = 0;
+
+		// Finds item sources, a default ReaPathResolver if not set
+		ReaPathResolver* Resolver = nullptr;
+	};
+
+	struct ReaPeakLevel {
+		// Frames summarized by each peak
+		uint64_t SamplesPerPeak = 0;
+		uint64_t Count = 0;
+
+		// Minimum then maximum of each channel, for each peak in turn
+		const float* Data = nullptr;
+	};
+
+	class ReaPeakCache;
+
+	// Peaks of one source, built or mapped from a peak file. Copies share the same data.
+	class ReaPeaks {
+	public:
+		ReaPeaks() = default;
+
+		bool IsValid() const { return m_base != nullptr; }
+
+		// Why the peaks couldn't be built or loaded
+		const std::string& Error() const { return m_error; }
+
+		// Whether the peaks are mapped from a peak file rather than held in memory
+		bool Mapped() const { return m_storage && m_storage->Map; }
+
+		// Source the peaks were built from
+		std::string Source() const;
+		unsigned int Channels() const { return IsValid() ? Head().Channels : 0; }
+		unsigned int SampleRate() const { return IsValid() ? Head().SampleRate : 0; }
+		uint64_t Frames() const { return IsValid() ? Head().Frames : 0; }
+
+		// Levels from the finest to the coarsest, which has a single peak
+		size_t Levels() const { return IsValid() ? Head().Levels : 0; }
+		ReaPeakLevel Level(size_t level) const;
+
+		// Minimum then maximum of each channel over columns equal slices of frames [start, end),
+		// from the coarsest level with at least a peak per column
+		std::vector<float> Query(uint64_t start, uint64_t end, size_t columns) const;
+
+		// Writes the peaks to a peak file, false if it can't be written
+		bool Save(const std::string& filepath) const;
+
+		// Maps a peak file written by Save
+		static ReaPeaks Open(const std::string& filepath);
+
+	private:
+		// Peak file header, followed by a LevelEntry per level, the source path and the data.
+		// Values are in native byte order, Version reads wrong on machines of the other one.
+		struct Header {
+			char Magic[8];
+			uint32_t Version, Channels, SampleRate, Levels;
+			uint64_t Frames;
+			uint64_t SourceSize;
+			int64_t SourceTime;
+			uint32_t SamplesPerPeak, Factor;
+			uint32_t PathSize, Reserved;
+		};
+
+		struct LevelEntry {
+			uint64_t SamplesPerPeak, Count, Offset;
+		};
+
+		struct Storage {
+			std::vector<char> Image;
+			void* Map = nullptr;
+			size_t MapSize = 0;
+			~Storage();
+		};
+
+		static constexpr uint32_t Version = 1;
+
+		std::shared_ptr<Storage> m_storage;
+		const char* m_base = nullptr;
+		size_t m_size = 0;
+		std::string m_error;
+
+		const Header& Head() const { return *reinterpret_cast<const Header*>(m_base); }
+		const LevelEntry* Entries() const { return reinterpret_cast<const LevelEntry*>(m_base + sizeof(Header)); }
+
+		// Checks the layout of image before any of it is trusted
+		bool Attach(std::shared_ptr<Storage> storage, const char* base, size_t size);
+
+		friend class ReaPeakCache;
+		friend ReaPeaks BuildPeaks(const std::string& filepath, const ReaPeakOptions& options);
+		friend std::map<std::string, ReaPeaks> BuildProjectPeaks(const ReaProject& project,
+			ReaPeakCache* cache, const ReaPeakOptions& options);
+	};
+
+	// Directory of peak files named after their source's path. Peaks are only reused if
+	// they were built with the same options from the source at its current size and
+	// modification time. Safe to share between threads.
+	class ReaPeakCache {
+	public:
+		explicit ReaPeakCache(const std::string& directory) : m_directory(directory) {}
+		ReaPeakCache(const ReaPeakCache&) = delete;
+
+		// Where the peaks of filepath are kept
+		std::string PeakPath(const std::string& filepath) const;
+
+		// Maps the cached peaks of filepath, or builds and stores them
+		ReaPeaks Get(const std::string& filepath, const ReaPeakOptions& options = ReaPeakOptions());
+
+		uint64_t Hits() const { return m_hits; }
+		uint64_t Misses() const { return m_misses; }
+
+	private:
+		std::string m_directory;
+		std::atomic<uint64_t> m_hits{ 0 }, m_misses{ 0 };
+	};
+
+	// Decodes a WAV file and builds its peaks. Failures are reported in ReaPeaks::Error, not thrown.
+	REAPARSER_API ReaPeaks BuildPeaks(const std::string& filepath, const ReaPeakOptions& options = ReaPeakOptions());
+
+	// Builds or loads the peaks of every media item's source on a pool of threads, keyed by
+	// ReaMediaItem::Filepath. Each distinct file is built once.
+	REAPARSER_API std::map<std::string, ReaPeaks> BuildProjectPeaks(const ReaProject& project,
+		ReaPeakCache* cache = nullptr, const ReaPeakOptions& options = ReaPeakOptions());
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	namespace Peaks {
+		// Minimum and maximum of each channel over interleaved frames into out, four samples
+		// at a time when channels divide the lanes evenly
+		inline void MinMax(const float* samples, size_t frames, unsigned int channels, float* out) {
+			float low[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX }, high[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			size_t i = 0, count = frames * channels;
+#ifdef REAPARSER_SSE2
+			if (channels == 1 || channels == 2 || channels == 4) {
+				__m128 lows = _mm_loadu_ps(low), highs = _mm_loadu_ps(high);
+				for (; i + 4 <= count; i += 4) {
+					__m128 values = _mm_loadu_ps(samples + i);
+					lows = _mm_min_ps(lows, values);
+					highs = _mm_max_ps(highs, values);
+				}
+				_mm_storeu_ps(low, lows);
+				_mm_storeu_ps(high, highs);
+			}
+#endif
+			for (unsigned int channel = 0; channel < channels; channel++) {
+				out[channel * 2] = FLT_MAX;
+				out[channel * 2 + 1] = -FLT_MAX;
+			}
+			// Lane l held samples of channel l % channels
+			for (unsigned int lane = 0; lane < 4 && channels <= 4; lane++) {
+				out[(lane % channels) * 2] = std::min(out[(lane % channels) * 2], low[lane]);
+				out[(lane % channels) * 2 + 1] = std::max(out[(lane % channels) * 2 + 1], high[lane]);
+			}
+			for (; i < count; i++) {
+				unsigned int channel = static_cast<unsigned int>(i % channels);
+				out[channel * 2] = std::min(out[channel * 2], samples[i]);
+				out[channel * 2 + 1] = std::max(out[channel * 2 + 1], samples[i]);
+			}
+		}
+
+		// Combines count peaks of channels into out
+		inline void Merge(const float* peaks, size_t count, unsigned int channels, float* out) {
+			for (unsigned int channel = 0; channel < channels; channel++) {
+				float low = FLT_MAX, high = -FLT_MAX;
+				for (size_t i = 0; i < count; i++) {
+					low = std::min(low, peaks[(i * channels + channel) * 2]);
+					high = std::max(high, peaks[(i * channels + channel) * 2 + 1]);
+				}
+				out[channel * 2] = low;
+				out[channel * 2 + 1] = high;
+			}
+		}
+
+		inline uint64_t Hash(const std::string& text) {
+			uint64_t hash = 14695981039346656037ull; // FNV-1a
+			for (unsigned char c : text)
+				hash = (hash ^ c) * 1099511628211ull;
+			return hash;
+		}
+	}
+
+	REAPARSER_API ReaPeaks::Storage::~Storage() {
+#ifndef _WIN32
+		if (Map)
+			munmap(Map, MapSize);
+#endif
+	}
+
+	REAPARSER_API bool ReaPeaks::Attach(std::shared_ptr<Storage> storage, const char* base, size_t size) {
+		const Header* header = reinterpret_cast<const Header*>(base);
+		if (size < sizeof(Header) || memcmp(header->Magic, "REAPEAKS", 8) != 0 || header->Version != Version) {
+			m_error = "Not a peak file";
+			return false;
+		}
+
+		// Level table, path and every level's data must lie within the image
+		uint64_t end = sizeof(Header) + static_cast<uint64_t>(header->Levels) * sizeof(LevelEntry) + header->PathSize;
+		const LevelEntry* entries = reinterpret_cast<const LevelEntry*>(base + sizeof(Header));
+		bool valid = end <= size && header->Channels > 0;
+		for (uint32_t i = 0; valid && i < header->Levels; i++) {
+			valid = entries[i].Offset % sizeof(float) == 0 && entries[i].Offset >= end && entries[i].Offset <= size &&
+				entries[i].Count <= (size - entries[i].Offset) / (sizeof(float) * 2 * header->Channels) &&
+				entries[i].SamplesPerPeak > 0;
+		}
+		if (!valid) {
+			m_error = "Corrupt peak file";
+			return false;
+		}
+
+		m_storage = storage;
+		m_base = base;
+		m_size = size;
+		m_error.clear();
+		return true;
+	}
+
+	REAPARSER_API std::string ReaPeaks::Source() const {
+		if (!IsValid())
+			return std::string();
+		return std::string(m_base + sizeof(Header) + Head().Levels * sizeof(LevelEntry), Head().PathSize);
+	}
+
+	REAPARSER_API ReaPeakLevel ReaPeaks::Level(size_t level) const {
+		ReaPeakLevel peaks;
+		if (level < Levels()) {
+			peaks.SamplesPerPeak = Entries()[level].SamplesPerPeak;
+			peaks.Count = Entries()[level].Count;
+			peaks.Data = reinterpret_cast<const float*>(m_base + Entries()[level].Offset);
+		}
+		return peaks;
+	}
+
+	REAPARSER_API std::vector<float> ReaPeaks::Query(uint64_t start, uint64_t end, size_t columns) const {
+		unsigned int channels = Channels();
+		std::vector<float> out(columns * channels * 2, 0.0f);
+		end = std::min(end, Frames());
+		if (!IsValid() || start >= end || columns == 0 || Levels() == 0)
+			return out;
+
+		// Coarsest level whose peaks are no wider than a column
+		double frames = static_cast<double>(end - start) / columns;
+		size_t level = 0;
+		while (level + 1 < Levels() && Entries()[level + 1].SamplesPerPeak <= frames)
+			level++;
+		ReaPeakLevel peaks = Level(level);
+
+		for (size_t column = 0; column < columns; column++) {
+			uint64_t from = start + static_cast<uint64_t>(column * frames);
+			uint64_t to = std::max(from + 1, start + static_cast<uint64_t>((column + 1) * frames));
+			uint64_t first = std::min(from / peaks.SamplesPerPeak, peaks.Count - 1);
+			uint64_t last = std::min((to + peaks.SamplesPerPeak - 1) / peaks.SamplesPerPeak, peaks.Count);
+			Peaks::Merge(peaks.Data + first * channels * 2, static_cast<size_t>(std::max(last, first + 1) - first),
+				channels, &out[column * channels * 2]);
+		}
+		return out;
+	}
+
+	REAPARSER_API bool ReaPeaks::Save(const std::string& filepath) const {
+		if (!IsValid())
+			return false;
+
+		// Written under another name and renamed, so readers never map a partial file. The name
+		// is the process's and thread's own, so concurrent writers don't share it.
+#ifdef _WIN32
+		long pid = _getpid();
+#else
+		long pid = getpid();
+#endif
+		std::string temporary = filepath + "." + std::to_string(pid) + "." +
+			std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+		FILE* fp = fopen(temporary.c_str(), "wb");
+		if (!fp)
+			return false;
+		bool ok = fwrite(m_base, 1, m_size, fp) == m_size;
+		ok &= fclose(fp) == 0;
+
+#ifdef _WIN32
+		remove(filepath.c_str());
+#endif
+		if (!ok || rename(temporary.c_str(), filepath.c_str()) != 0) {
+			remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	REAPARSER_API ReaPeaks ReaPeaks::Open(const std::string& filepath) {
+		ReaPeaks peaks;
+		std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+
+#ifdef _WIN32
+		// Read whole rather than mapped on Windows
+		FILE* fp = fopen(filepath.c_str(), "rb");
+		if (!fp) {
+			peaks.m_error = "Unable to open peak file: " + filepath;
+			return peaks;
+		}
+		Media::Seek(fp, 0, SEEK_END);
+		storage->Image.resize(static_cast<size_t>(Media::Tell(fp)));
+		Media::Seek(fp, 0, SEEK_SET);
+		size_t read = fread(storage->Image.data(), 1, storage->Image.size(), fp);
+		fclose(fp);
+		storage->Image.resize(read);
+		peaks.Attach(storage, storage->Image.data(), storage->Image.size());
+#else
+		int fd = open(filepath.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= 0) {
+			if (fd >= 0)
+				close(fd);
+			peaks.m_error = "Unable to open peak file: " + filepath;
+			return peaks;
+		}
+
+		void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) {
+			peaks.m_error = "Unable to map peak file: " + filepath;
+			return peaks;
+		}
+		storage->Map = map;
+		storage->MapSize = static_cast<size_t>(st.st_size);
+		peaks.Attach(storage, static_cast<const char*>(map), storage->MapSize);
+#endif
+		return peaks;
+	}
+
+	REAPARSER_API std::string ReaPeakCache::PeakPath(const std::string& filepath) const {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.reapeaks", static_cast<unsigned long long>(Peaks::Hash(filepath)));
+		return m_directory + "/" + name;
+	}
+
+	REAPARSER_API ReaPeaks ReaPeakCache::Get(const std::string& filepath, const ReaPeakOptions& options) {
+		uint64_t size = 0;
+		int64_t modifiedTime = 0;
+		std::string peakPath = PeakPath(filepath);
+
+		if (Media::Stat(filepath, size, modifiedTime)) {
+			ReaPeaks peaks = ReaPeaks::Open(peakPath);
+			if (peaks.IsValid() && peaks.Head().SourceSize == size && peaks.Head().SourceTime == modifiedTime &&
+				peaks.Head().SamplesPerPeak == options.SamplesPerPeak && peaks.Head().Factor == options.Factor &&
+				peaks.Source() == filepath) {
+				m_hits++;
+				return peaks;
+			}
+		}
+
+		m_misses++;
+		ReaPeaks peaks = BuildPeaks(filepath, options);
+		if (peaks.IsValid())
+			peaks.Save(peakPath);
+		return peaks;
+	}
+
+	REAPARSER_API ReaPeaks BuildPeaks(const std::string& filepath, const ReaPeakOptions& options) {
+		ReaTraceScope trace("peaks", "peaks", filepath.c_str());
+		typedef ReaPeaks::Header Header;
+		typedef ReaPeaks::LevelEntry LevelEntry;
+		ReaPeaks peaks;
+
+		ReaMediaInfo info = ProbeMediaFile(filepath);
+		if (!info.IsValid()) {
+			peaks.m_error = info.Error;
+			return peaks;
+		}
+		if (info.Format != ReaMediaFormat::WAV || info.Channels == 0 || info.BitsPerSample == 0) {
+			peaks.m_error = "Peaks can only be built from WAV files: " + filepath;
+			return peaks;
+		}
+
+		// Levels shrink by Factor down to a single peak
+		uint64_t samplesPerPeak = std::max(1u, options.SamplesPerPeak);
+		unsigned int factor = std::max(2u, options.Factor);
+		std::vector<LevelEntry> levels;
+		uint64_t count = (info.Frames + samplesPerPeak - 1) / samplesPerPeak;
+		for (uint64_t spp = samplesPerPeak;; spp *= factor, count = (count + factor - 1) / factor) {
+			levels.push_back({ spp, count, 0 });
+			if (count <= 1)
+				break;
+		}
+
+		// Lay out the image, data aligned for floats after the header, level table and path
+		unsigned int channels = info.Channels;
+		uint64_t offset = sizeof(Header) + levels.size() * sizeof(LevelEntry) + filepath.size();
+		offset = (offset + 7) & ~static_cast<uint64_t>(7);
+		for (auto& level : levels) {
+			level.Offset = offset;
+			offset += level.Count * channels * 2 * sizeof(float);
+		}
+
+		std::shared_ptr<ReaPeaks::Storage> storage = std::make_shared<ReaPeaks::Storage>();
+		std::vector<char>& image = storage->Image;
+		image.assign(static_cast<size_t>(offset), 0);
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.Magic, "REAPEAKS", 8);
+		header.Version = ReaPeaks::Version;
+		header.Channels = channels;
+		header.SampleRate = info.SampleRate;
+		header.Levels = static_cast<uint32_t>(levels.size());
+		header.Frames = info.Frames;
+		header.SourceSize = info.FileSize;
+		header.SourceTime = info.ModifiedTime;
+		header.SamplesPerPeak = options.SamplesPerPeak;
+		header.Factor = options.Factor;
+		header.PathSize = static_cast<uint32_t>(filepath.size());
+		memcpy(image.data(), &header, sizeof(header));
+		memcpy(image.data() + sizeof(header), levels.data(), levels.size() * sizeof(LevelEntry));
+		memcpy(image.data() + sizeof(header) + levels.size() * sizeof(LevelEntry), filepath.data(), filepath.size());
+
+		// Decode blocks of whole peaks into the finest level
+		FILE* fp = fopen(filepath.c_str(), "rb");
+		if (!fp || !Media::Seek(fp, static_cast<int64_t>(info.DataOffset), SEEK_SET)) {
+			if (fp)
+				fclose(fp);
+			peaks.m_error = "Unable to read media file: " + filepath;
+			return peaks;
+		}
+
+		unsigned int bytes = (info.BitsPerSample + 7) / 8;
+		size_t blockFrames = static_cast<size_t>(std::max<uint64_t>(options.BlockFrames / samplesPerPeak, 1) * samplesPerPeak);
+		std::vector<unsigned char> raw(blockFrames * channels * bytes);
+		std::vector<float> samples(blockFrames * channels);
+		float* finest = reinterpret_cast<float*>(&image[static_cast<size_t>(levels[0].Offset)]);
+		uint64_t peak = 0;
+
+		for (uint64_t frame = 0; frame < info.Frames; frame += blockFrames) {
+			size_t frames = static_cast<size_t>(std::min<uint64_t>(blockFrames, info.Frames - frame));
+			size_t read = fread(raw.data(), channels * bytes, frames, fp);
+			if (read < frames)
+				memset(&raw[read * channels * bytes], 0, (frames - read) * channels * bytes); // Truncated file
+
+			Media::DecodeSamples(raw.data(), frames * channels, bytes, info.Float, samples.data());
+			for (size_t i = 0; i < frames; i += static_cast<size_t>(samplesPerPeak), peak++) {
+				size_t length = static_cast<size_t>(std::min<uint64_t>(samplesPerPeak, frames - i));
+				Peaks::MinMax(&samples[i * channels], length, channels, finest + peak * channels * 2);
+			}
+		}
+		fclose(fp);
+
+		// Each coarser level from the one before
+		for (size_t level = 1; level < levels.size(); level++) {
+			const float* finer = reinterpret_cast<const float*>(&image[static_cast<size_t>(levels[level - 1].Offset)]);
+			float* coarser = reinterpret_cast<float*>(&image[static_cast<size_t>(levels[level].Offset)]);
+			for (uint64_t i = 0; i < levels[level].Count; i++) {
+				uint64_t first = i * factor, last = std::min(first + factor, levels[level - 1].Count);
+				Peaks::Merge(finer + first * channels * 2, static_cast<size_t>(last - first), channels, coarser + i * channels * 2);
+			}
+		}
+
+		peaks.Attach(storage, image.data(), image.size());
+		return peaks;
+	}
+
+	REAPARSER_API std::map<std::string, ReaPeaks> BuildProjectPeaks(const ReaProject& project,
+		ReaPeakCache* cache, const ReaPeakOptions& options) {
+		ReaPathResolver defaultResolver;
+		std::map<std::string, std::string> resolved =
+			(options.Resolver ? options.Resolver : &defaultResolver)->ResolveProject(project);
+
+		// Build each distinct file once
+		std::vector<std::string> unique;
+		for (auto& source : resolved) {
+			if (!source.second.empty())
+				unique.push_back(source.second);
+		}
+		std::sort(unique.begin(), unique.end());
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+		std::vector<ReaPeaks> built(unique.size());
+
+		ReaThreadPool::For(unique.size(), options.Threads, [&](size_t i, unsigned int) {
+			built[i] = cache ? cache->Get(unique[i], options) : BuildPeaks(unique[i], options);
+		});
+
+		std::map<std::string, ReaPeaks> peaks;
+		for (auto& source : resolved) {
+			if (source.second.empty())
+				peaks[source.first].m_error = "Unable to find media file: " + source.first;
+			else
+				peaks[source.first] = built[std::lower_bound(unique.begin(), unique.end(), source.second) - unique.begin()];
+		}
+		return peaks;
+	}
+#endif
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+#include "ReaParser.h"
+#include "ReaMedia.h"
+
+// Offline mixdown: renders the WAV sourced media items of a project to a stereo WAV
+// file, without Reaper. Items are placed by position, length and start offset and mixed
+// with item and track volume, pan, mute and phase, through the folder hierarchy to the
+// master. Playback rate, fades, envelopes and FX are not applied and nothing is resampled.
+
+namespace ReaParser {
+
+	struct ReaRenderOptions {
+		// Output sample rate, 0 for the project's (or 44100 if it has none).
+		// Items whose source has another rate are skipped.
+		unsigned int SampleRate = 0;
+
+		// 16 or 24 bit integer, or 32 bit float samples
+		unsigned int BitsPerSample = 24;
+
+		// Range rendered in seconds, an End of 0 renders up to the end of the last item
+		double Start = 0.0, End = 0.0;
+
+		// Frames mixed at a time. Memory use is about 8 bytes per frame per track.
+		size_t BlockFrames = 4096;
+
+		// Worker threads rendering tracks, 0 for one per hardware thread
+		unsigned int Threads = 0;
+
+		// Finds item sources, a default ReaPathResolver if not set
+		ReaPathResolver* Resolver = nullptr;
+	};
+
+	struct ReaRenderResult {
+		uint64_t Frames = 0;
+		unsigned int SampleRate = 0;
+		size_t RenderedItems = 0, SkippedItems = 0;
+
+		// Largest absolute sample before conversion, above 1 means the output clipped
+		float Peak = 0.0f;
+
+		// Why items were skipped
+		std::vector<std::string> Warnings;
+	};
+
+	// Renders project to a WAV file at filepath, throws Exception if it can't be written or
+	// the project has no master track
+	REAPARSER_API ReaRenderResult RenderProject(const ReaProject& project, const std::string& filepath,
+		const ReaRenderOptions& options = ReaRenderOptions());
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	namespace Render {
+		// Balance pan law: panning attenuates the opposite side, the centre is at unity
+		inline void PanGains(float gain, float pan, float& left, float& right) {
+			left = gain * (pan > 0.0f ? 1.0f - pan : 1.0f);
+			right = gain * (pan < 0.0f ? 1.0f + pan : 1.0f);
+		}
+
+		// out += in * (left, right), over interleaved stereo frames
+		inline void MixStereo(float* out, const float* in, size_t frames, float left, float right) {
+			size_t i = 0, samples = frames * 2;
+#ifdef REAPARSER_SSE2
+			__m128 gains = _mm_setr_ps(left, right, left, right);
+			for (; i + 4 <= samples; i += 4)
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), gains)));
+#endif
+			for (; i < samples; i += 2) {
+				out[i] += in[i] * left;
+				out[i + 1] += in[i + 1] * right;
+			}
+		}
+
+		// buffer *= (left, right), over interleaved stereo frames
+		inline void ScaleStereo(float* buffer, size_t frames, float left, float right) {
+			size_t i = 0, samples = frames * 2;
+#ifdef REAPARSER_SSE2
+			__m128 gains = _mm_setr_ps(left, right, left, right);
+			for (; i + 4 <= samples; i += 4)
+				_mm_storeu_ps(buffer + i, _mm_mul_ps(_mm_loadu_ps(buffer + i), gains));
+#endif
+			for (; i < samples; i += 2) {
+				buffer[i] *= left;
+				buffer[i + 1] *= right;
+			}
+		}
+
+		// Decodes WAV sample frames to interleaved stereo, mono to both sides and
+		// anything wider than stereo by its first two channels
+		inline void DecodeStereo(const unsigned char* in, size_t frames, const ReaMediaInfo& info, float* out) {
+			unsigned int bytes = (info.BitsPerSample + 7) / 8, frameBytes = bytes * info.Channels;
+			unsigned int right = info.Channels > 1 ? bytes : 0;
+
+			for (size_t i = 0; i < frames; i++, in += frameBytes) {
+				out[i * 2] = Media::DecodeSample(in, bytes, info.Float);
+				out[i * 2 + 1] = right ? Media::DecodeSample(in + right, bytes, info.Float) : out[i * 2];
+			}
+		}
+
+		// Streams a stereo WAV file. A JUNK chunk reserves room for the ds64 chunk that
+		// turns it into RF64 if the data outgrows 4 GB.
+		class WavWriter {
+		public:
+			WavWriter() = default;
+			WavWriter(const WavWriter&) = delete;
+			~WavWriter() { if (m_fp) fclose(m_fp); }
+
+			bool Open(const std::string& filepath, unsigned int sampleRate, unsigned int bitsPerSample) {
+				m_fp = fopen(filepath.c_str(), "wb");
+				if (!m_fp)
+					return false;
+
+				m_bytes = bitsPerSample / 8;
+				m_float = bitsPerSample == 32;
+				std::string header = "RIFF";
+				header += std::string(4, '\0') + "WAVEJUNK";
+				Put(header, 28, 4);
+				header += std::string(28, '\0');
+				header += "fmt ";
+				Put(header, 16, 4);
+				Put(header, m_float ? 3 : 1, 2);
+				Put(header, 2, 2);
+				Put(header, sampleRate, 4);
+				Put(header, sampleRate * 2 * m_bytes, 4);
+				Put(header, 2 * m_bytes, 2);
+				Put(header, bitsPerSample, 2);
+				header += "data";
+				Put(header, 0, 4);
+				return fwrite(header.data(), 1, header.size(), m_fp) == header.size();
+			}
+
+			// Writes interleaved stereo frames, clipping integer samples to full scale
+			bool Write(const float* samples, size_t frames) {
+				m_buffer.resize(frames * 2 * m_bytes);
+				unsigned char* out = m_buffer.data();
+
+				for (size_t i = 0; i < frames * 2; i++, out += m_bytes) {
+					if (m_float) {
+						memcpy(out, &samples[i], 4);
+						continue;
+					}
+					float sample = std::max(-1.0f, std::min(1.0f, samples[i]));
+					int32_t value = m_bytes == 2 ? static_cast<int32_t>(lrintf(sample * 32767.0f)) :
+						static_cast<int32_t>(lrintf(sample * 8388607.0f));
+					for (unsigned int b = 0; b < m_bytes; b++)
+						out[b] = static_cast<unsigned char>(value >> (8 * b));
+				}
+
+				m_dataSize += m_buffer.size();
+				return fwrite(m_buffer.data(), 1, m_buffer.size(), m_fp) == m_buffer.size();
+			}
+
+			// Fills in the chunk sizes and closes the file
+			bool Close() {
+				std::string sizes;
+				bool rf64 = m_dataSize + HeaderSize - 8 > 0xffffffffull;
+				bool ok = true;
+
+				if (rf64) {
+					// RF64 marks the 32-bit sizes as unused and gives the real ones in ds64
+					std::string ds64 = "ds64";
+					Put(ds64, 28, 4);
+					Put64(ds64, m_dataSize + HeaderSize - 8);
+					Put64(ds64, m_dataSize);
+					Put64(ds64, m_dataSize / (2 * m_bytes));
+					Put(ds64, 0, 4);
+					ok &= Media::Seek(m_fp, 0, SEEK_SET) && fwrite("RF64\xff\xff\xff\xff", 1, 8, m_fp) == 8;
+					ok &= Media::Seek(m_fp, 12, SEEK_SET) && fwrite(ds64.data(), 1, ds64.size(), m_fp) == ds64.size();
+					ok &= Media::Seek(m_fp, HeaderSize - 4, SEEK_SET) && fwrite("\xff\xff\xff\xff", 1, 4, m_fp) == 4;
+				}
+				else {
+					Put(sizes, static_cast<uint32_t>(m_dataSize + HeaderSize - 8), 4);
+					ok &= Media::Seek(m_fp, 4, SEEK_SET) && fwrite(sizes.data(), 1, 4, m_fp) == 4;
+					sizes.clear();
+					Put(sizes, static_cast<uint32_t>(m_dataSize), 4);
+					ok &= Media::Seek(m_fp, HeaderSize - 4, SEEK_SET) && fwrite(sizes.data(), 1, 4, m_fp) == 4;
+				}
+
+				ok &= fclose(m_fp) == 0;
+				m_fp = nullptr;
+				return ok;
+			}
+
+		private:
+			// RIFF, WAVE, JUNK (8 + 28), fmt (8 + 16) and the data chunk header
+			static constexpr uint64_t HeaderSize = 12 + 36 + 24 + 8;
+
+			FILE* m_fp = nullptr;
+			unsigned int m_bytes = 3;
+			bool m_float = false;
+			uint64_t m_dataSize = 0;
+			std::vector<unsigned char> m_buffer;
+
+			static void Put(std::string& out, uint32_t value, int bytes) {
+				for (int i = 0; i < bytes; i++)
+					out += static_cast<char>(value >> (8 * i));
+			}
+
+			static void Put64(std::string& out, uint64_t value) {
+				Put(out, static_cast<uint32_t>(value), 4);
+				Put(out, static_cast<uint32_t>(value >> 32), 4);
+			}
+		};
+
+		// An item to mix, in output sample frames
+		struct Item {
+			uint64_t Start, End;
+			int64_t SourceStart; // Source frame played at Start
+			const ReaMediaInfo* Source;
+			std::string Filepath;
+			float Left, Right;
+		};
+
+		struct Track {
+			std::vector<Item> Items; // By start
+			std::vector<float> Buffer;
+			std::vector<unsigned char> Raw;
+			std::vector<float> Decoded;
+			std::map<std::string, FILE*> Files; // Sources open for items playing in the last block
+			size_t Parent = 0;
+			bool Muted = false;
+			float Left = 1.0f, Right = 1.0f;
+		};
+
+		// Closes the tracks' open sources however the render ends
+		class FileCloser {
+		public:
+			explicit FileCloser(std::vector<Track>& tracks) : m_tracks(tracks) {}
+			FileCloser(const FileCloser&) = delete;
+
+			~FileCloser() {
+				for (auto& track : m_tracks) {
+					for (auto& file : track.Files)
+						fclose(file.second);
+					track.Files.clear();
+				}
+			}
+
+		private:
+			std::vector<Track>& m_tracks;
+		};
+
+		// Mixes the track's items playing within [start, start + frames) into its buffer
+		inline void RenderBlock(Track& track, uint64_t start, size_t frames) {
+			track.Buffer.assign(frames * 2, 0.0f);
+			std::map<std::string, FILE*> used;
+
+			for (auto& item : track.Items) {
+				if (item.Start >= start + frames)
+					break;
+				if (item.End <= start)
+					continue;
+
+				uint64_t from = std::max(item.Start, start), to = std::min(item.End, start + frames);
+				int64_t sourceFrame = item.SourceStart + static_cast<int64_t>(from - item.Start);
+
+				// Silence before the source starts and after it ends
+				if (sourceFrame < 0) {
+					from += static_cast<uint64_t>(std::min<int64_t>(-sourceFrame, static_cast<int64_t>(to - from)));
+					sourceFrame = 0;
+				}
+				uint64_t available = static_cast<uint64_t>(sourceFrame) < item.Source->Frames ?
+					item.Source->Frames - static_cast<uint64_t>(sourceFrame) : 0;
+				to = std::min(to, from + available);
+				if (to <= from)
+					continue;
+
+				// Sources stay open from block to block while items play from them
+				FILE* fp;
+				auto use = used.find(item.Filepath);
+				if (use != used.end())
+					fp = use->second;
+				else {
+					auto open = track.Files.find(item.Filepath);
+					if (open != track.Files.end()) {
+						fp = open->second;
+						track.Files.erase(open);
+					}
+					else if (!(fp = fopen(item.Filepath.c_str(), "rb")))
+						continue;
+					used[item.Filepath] = fp;
+				}
+
+				size_t count = static_cast<size_t>(to - from);
+				size_t frameBytes = ((item.Source->BitsPerSample + 7) / 8) * item.Source->Channels;
+				track.Raw.resize(count * frameBytes);
+				track.Decoded.resize(count * 2);
+
+				if (!Media::Seek(fp, static_cast<int64_t>(item.Source->DataOffset + static_cast<uint64_t>(sourceFrame) * frameBytes), SEEK_SET))
+					continue;
+				count = fread(track.Raw.data(), frameBytes, count, fp);
+
+				DecodeStereo(track.Raw.data(), count, *item.Source, track.Decoded.data());
+				MixStereo(&track.Buffer[(from - start) * 2], track.Decoded.data(), count, item.Left, item.Right);
+			}
+
+			// Close the sources no item played from in this block
+			for (auto& file : track.Files)
+				fclose(file.second);
+			track.Files.swap(used);
+		}
+	}
+
+	REAPARSER_API ReaRenderResult RenderProject(const ReaProject& project, const std::string& filepath,
+		const ReaRenderOptions& options) {
+		ReaTraceScope trace("render", "render", filepath.c_str());
+		ReaRenderResult result;
+		result.SampleRate = options.SampleRate ? options.SampleRate : (project.SampleRate ? project.SampleRate : 44100);
+		double rate = result.SampleRate;
+
+		if (options.BitsPerSample != 16 && options.BitsPerSample != 24 && options.BitsPerSample != 32)
+			throw Exception("Unsupported render bit depth: " + std::to_string(options.BitsPerSample));
+		if (project.Tracks.empty())
+			throw Exception("Unable to render a project without a master track");
+
+		// Find and probe every source up front
+		ReaPathResolver defaultResolver;
+		ReaPathResolver* resolver = options.Resolver ? options.Resolver : &defaultResolver;
+		std::map<std::string, std::string> resolved = resolver->ResolveProject(project);
+		std::vector<std::string> sources, filepaths;
+		for (auto& source : resolved) {
+			sources.push_back(source.first);
+			filepaths.push_back(source.second);
+		}
+		std::vector<ReaMediaInfo> infos = ProbeMediaFiles(filepaths, nullptr, options.Threads);
+
+		// Tracks in project order, each summed into its folder parent or the master (0)
+		std::vector<Render::Track> tracks(project.Tracks.size());
+		std::vector<size_t> folders;
+		uint64_t end = 0;
+
+		for (size_t i = 0; i < project.Tracks.size(); i++) {
+			const ReaTrack& track = project.Tracks[i];
+			Render::Track& state = tracks[i];
+			Render::PanGains(track.PhaseInverted ? -track.RawVolume : track.RawVolume, track.RawPan, state.Left, state.Right);
+			state.Muted = track.Muted;
+
+			if (i > 0) {
+				state.Parent = folders.empty() ? 0 : folders.back();
+				if (track.FolderDepth > 0)
+					folders.push_back(i);
+				for (int depth = track.FolderDepth; depth < 0 && !folders.empty(); depth++)
+					folders.pop_back();
+			}
+
+			for (auto& item : track.MediaItems) {
+				if (item.Muted || item.Type != ReaMediaType::Sample)
+					continue;
+
+				size_t index = std::lower_bound(sources.begin(), sources.end(), item.Filepath) - sources.begin();
+				const ReaMediaInfo* info = index < sources.size() && sources[index] == item.Filepath ? &infos[index] : nullptr;
+				std::string skipped;
+				if (!info || filepaths[index].empty())
+					skipped = "not found";
+				else if (info->Format != ReaMediaFormat::WAV)
+					skipped = info->IsValid() ? "not a WAV file" : info->Error;
+				else if (info->SampleRate != result.SampleRate)
+					skipped = "sample rate " + std::to_string(info->SampleRate) + " needs resampling";
+
+				if (!skipped.empty()) {
+					result.SkippedItems++;
+					result.Warnings.push_back("Skipped item \"" + item.Name + "\" on track " + std::to_string(i) +
+						" (" + item.Filepath + "): " + skipped);
+					continue;
+				}
+
+				Render::Item render;
+				render.Start = static_cast<uint64_t>(std::max(0.0, llround(static_cast<double>(item.Start) * rate) - options.Start * rate));
+				render.End = static_cast<uint64_t>(std::max(0.0, llround((static_cast<double>(item.Start) + item.Length) * rate) - options.Start * rate));
+				render.SourceStart = llround(static_cast<double>(item.StartOffset) * rate) +
+					llround(std::max(0.0, options.Start * rate - llround(static_cast<double>(item.Start) * rate)));
+				render.Source = info;
+				render.Filepath = filepaths[index];
+				Render::PanGains(item.RawVolume, item.RawPan, render.Left, render.Right);
+
+				state.Items.push_back(render);
+				end = std::max(end, render.End);
+				result.RenderedItems++;
+			}
+
+			std::sort(state.Items.begin(), state.Items.end(),
+				[](const Render::Item& a, const Render::Item& b) { return a.Start < b.Start; });
+		}
+
+		if (options.End > options.Start)
+			end = static_cast<uint64_t>(llround((options.End - options.Start) * rate));
+		result.Frames = end;
+
+		Render::WavWriter writer;
+		if (!writer.Open(filepath, result.SampleRate, options.BitsPerSample))
+			throw Exception("Unable to write render: " + filepath);
+
+		// The workers are started once and handed every block in turn
+		unsigned int threads = options.Threads ? options.Threads : std::max(1u, std::thread::hardware_concurrency());
+		ReaThreadPool pool(static_cast<unsigned int>(std::min<size_t>(threads, tracks.size())));
+		Render::FileCloser closer(tracks);
+		size_t blockFrames = std::max<size_t>(options.BlockFrames, 64);
+		uint64_t start = 0;
+		size_t frames = 0;
+		ReaThreadPool::Task renderTrack = [&](size_t i, unsigned int) { Render::RenderBlock(tracks[i], start, frames); };
+
+		for (; start < end; start += blockFrames) {
+			frames = static_cast<size_t>(std::min<uint64_t>(blockFrames, end - start));
+
+			// Tracks render in parallel, then sum bottom up through the folders
+			pool.Run(tracks.size(), renderTrack);
+
+			for (size_t i = tracks.size() - 1; i > 0; i--) {
+				if (tracks[i].Muted)
+					continue;
+				Render::ScaleStereo(tracks[i].Buffer.data(), frames, tracks[i].Left, tracks[i].Right);
+				Render::MixStereo(tracks[tracks[i].Parent].Buffer.data(), tracks[i].Buffer.data(), frames, 1.0f, 1.0f);
+			}
+
+			std::vector<float>& master = tracks[0].Buffer;
+			Render::ScaleStereo(master.data(), frames, tracks[0].Left, tracks[0].Right);
+			for (float sample : master)
+				result.Peak = std::max(result.Peak, fabsf(sample));
+
+			if (!writer.Write(master.data(), frames))
+				throw Exception("Unable to write render: " + filepath);
+		}
+
+		if (!writer.Close())
+			throw Exception("Unable to write render: " + filepath);
+		return result;
+	}
+#endif
+}
@@ -0,0 +1,541 @@
+#pragma once
+
+#include "ReaParser.h"
+
+#include <functional>
+#include <deque>
+
+// Immutable project snapshots for sharing between threads. A snapshot never changes once
+// made, so any number of threads can read and copy one without locking. Its project
+// properties, tracks, media items and FX are each held by a shared pointer, and the lists of
+// them are persistent vectors. An edit makes a new snapshot sharing everything it leaves
+// alone: changing an item copies that item and the O(log n) nodes leading to it in its
+// track's list and the project's, never another item.
+//
+// ReaHistory keeps a run of snapshots for undo and redo, each step costing only what it copied.
+
+namespace ReaParser {
+
+	// Immutable vector stored as a 32-way trie of shared nodes. Set, PushBack and PopBack
+	// return a new vector copying the O(log n) nodes on the way to the element they change and
+	// sharing the rest. Insert and Erase keep the leaves before them and push every element
+	// after them again, costing O((n - at) log n): cheap near the end, a rebuild at the front.
+	// Track, item and FX lists are short enough for that, a relaxed radix tree would do better.
+	template <class T>
+	class ReaPersistentVector {
+	public:
+		ReaPersistentVector() = default;
+
+		// From values, built bottom up rather than pushed one by one
+		explicit ReaPersistentVector(std::vector<T> values) {
+			std::vector<std::shared_ptr<const Node>> level;
+			for (size_t i = 0; i < values.size(); i += Width) {
+				std::shared_ptr<Node> leaf = std::make_shared<Node>();
+				size_t end = std::min<size_t>(values.size(), i + Width);
+				leaf->Values.assign(std::make_move_iterator(values.begin() + i), std::make_move_iterator(values.begin() + end));
+				level.push_back(std::move(leaf));
+			}
+			while (level.size() > 1) {
+				std::vector<std::shared_ptr<const Node>> parents;
+				for (size_t i = 0; i < level.size(); i += Width) {
+					std::shared_ptr<Node> parent = std::make_shared<Node>();
+					size_t end = std::min<size_t>(level.size(), i + Width);
+					parent->Children.assign(level.begin() + i, level.begin() + end);
+					parents.push_back(std::move(parent));
+				}
+				level.swap(parents);
+				m_shift += Bits;
+			}
+			if (!level.empty())
+				m_root = level[0];
+			m_size = values.size();
+		}
+
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		const T& operator[](size_t index) const {
+			const Node* node = m_root.get();
+			for (unsigned int shift = m_shift; shift > 0; shift -= Bits)
+				node = node->Children[(index >> shift) & Mask].get();
+			return node->Values[index & Mask];
+		}
+
+		ReaPersistentVector Set(size_t index, T value) const {
+			ReaPersistentVector result(*this);
+			result.m_root = SetIn(*m_root, m_shift, index, value);
+			return result;
+		}
+
+		ReaPersistentVector PushBack(T value) const {
+			ReaPersistentVector result(*this);
+			if (m_root && m_size == (static_cast<size_t>(Width) << m_shift)) {
+				// Full, so a new root takes the old one and a path to the new element
+				std::shared_ptr<Node> root = std::make_shared<Node>();
+				root->Children.push_back(m_root);
+				root->Children.push_back(PushIn(nullptr, m_shift, m_size, value));
+				result.m_root = std::move(root);
+				result.m_shift = m_shift + Bits;
+			}
+			else
+				result.m_root = PushIn(m_root.get(), m_shift, m_size, value);
+			result.m_size = m_size + 1;
+			return result;
+		}
+
+		ReaPersistentVector PopBack() const {
+			if (m_size <= 1)
+				return ReaPersistentVector();
+
+			ReaPersistentVector result(*this);
+			result.m_root = PopIn(*m_root, m_shift, m_size - 1);
+			result.m_size = m_size - 1;
+
+			// A root left with one child hands over to it
+			while (result.m_shift > 0 && result.m_root->Children.size() == 1) {
+				std::shared_ptr<const Node> child = result.m_root->Children[0];
+				result.m_root = std::move(child);
+				result.m_shift -= Bits;
+			}
+			return result;
+		}
+
+		ReaPersistentVector Insert(size_t at, T value) const {
+			std::vector<T> moved;
+			ReaPersistentVector result = Truncate(at, moved);
+			result = result.PushBack(std::move(value));
+			for (T& element : moved)
+				result = result.PushBack(std::move(element));
+			return result;
+		}
+
+		ReaPersistentVector Erase(size_t at) const {
+			std::vector<T> moved;
+			ReaPersistentVector result = Truncate(at, moved);
+			for (size_t i = 1; i < moved.size(); i++)
+				result = result.PushBack(std::move(moved[i]));
+			return result;
+		}
+
+	private:
+		static const unsigned int Bits = 5, Width = 1u << Bits, Mask = Width - 1;
+
+		// Branches hold children, leaves values
+		struct Node {
+			std::vector<std::shared_ptr<const Node>> Children;
+			std::vector<T> Values;
+		};
+		std::shared_ptr<const Node> m_root;
+		size_t m_size = 0;
+		unsigned int m_shift = 0;
+
+		static std::shared_ptr<const Node> SetIn(const Node& node, unsigned int shift, size_t index, T& value) {
+			std::shared_ptr<Node> copy = std::make_shared<Node>(node);
+			if (shift == 0)
+				copy->Values[index & Mask] = std::move(value);
+			else {
+				size_t child = (index >> shift) & Mask;
+				copy->Children[child] = SetIn(*node.Children[child], shift - Bits, index, value);
+			}
+			return copy;
+		}
+
+		// Adds value at index, the end, below node, or on a new path if node is nullptr
+		static std::shared_ptr<const Node> PushIn(const Node* node, unsigned int shift, size_t index, T& value) {
+			std::shared_ptr<Node> copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+			if (shift == 0)
+				copy->Values.push_back(std::move(value));
+			else {
+				size_t child = (index >> shift) & Mask;
+				if (child < copy->Children.size())
+					copy->Children[child] = PushIn(copy->Children[child].get(), shift - Bits, index, value);
+				else
+					copy->Children.push_back(PushIn(nullptr, shift - Bits, index, value));
+			}
+			return copy;
+		}
+
+		// Removes the element at index, the last, returning nullptr for a node left empty
+		static std::shared_ptr<const Node> PopIn(const Node& node, unsigned int shift, size_t index) {
+			std::shared_ptr<Node> copy = std::make_shared<Node>(node);
+			if (shift == 0)
+				copy->Values.pop_back();
+			else {
+				size_t child = (index >> shift) & Mask;
+				std::shared_ptr<const Node> popped = PopIn(*node.Children[child], shift - Bits, index);
+				if (popped)
+					copy->Children[child] = std::move(popped);
+				else
+					copy->Children.pop_back();
+			}
+			if (copy->Values.empty() && copy->Children.empty())
+				return nullptr;
+			return copy;
+		}
+
+		// The first count elements below node, sharing its children that are kept whole
+		static std::shared_ptr<const Node> TakeIn(const Node& node, unsigned int shift, size_t count) {
+			std::shared_ptr<Node> copy = std::make_shared<Node>();
+			if (shift == 0)
+				copy->Values.assign(node.Values.begin(), node.Values.begin() + count);
+			else {
+				size_t last = (count - 1) >> shift, kept = count - (last << shift);
+				copy->Children.assign(node.Children.begin(), node.Children.begin() + last);
+				copy->Children.push_back(kept == (static_cast<size_t>(Width) << (shift - Bits)) ?
+					node.Children[last] : TakeIn(*node.Children[last], shift - Bits, kept));
+			}
+			return copy;
+		}
+
+		// The first at elements, with those after them in moved. Cut along the path to the
+		// last element kept, in O(log n) new nodes.
+		ReaPersistentVector Truncate(size_t at, std::vector<T>& moved) const {
+			moved.clear();
+			for (size_t i = at; i < m_size; i++)
+				moved.push_back((*this)[i]);
+			if (at == 0)
+				return ReaPersistentVector();
+			if (at == m_size)
+				return *this;
+
+			ReaPersistentVector result(*this);
+			result.m_root = TakeIn(*m_root, m_shift, at);
+			result.m_size = at;
+			while (result.m_shift > 0 && result.m_root->Children.size() == 1) {
+				std::shared_ptr<const Node> child = result.m_root->Children[0];
+				result.m_root = std::move(child);
+				result.m_shift -= Bits;
+			}
+			return result;
+		}
+	};
+
+	// A media item of a snapshot with its own takes, its FirstTake being 0
+	struct ReaSnapshotItem {
+		ReaMediaItem Item;
+		ReaTakes Takes;
+	};
+
+	class ReaSnapshotTrack {
+	public:
+		friend class ReaSnapshot;
+
+		// The track's own fields, with MediaItems and FXChain empty
+		const ReaTrack& Track() const { return *m_track; }
+
+		size_t ItemCount() const { return m_items.size(); }
+		const ReaSnapshotItem& Item(size_t index) const { return *m_items[index]; }
+
+		size_t FXCount() const { return m_fx.size(); }
+		const ReaFX& FX(size_t index) const { return *m_fx[index]; }
+	private:
+		std::shared_ptr<const ReaTrack> m_track;
+		ReaPersistentVector<std::shared_ptr<const ReaSnapshotItem>> m_items;
+		ReaPersistentVector<std::shared_ptr<const ReaFX>> m_fx;
+	};
+
+	class ReaSnapshot {
+	public:
+		// An empty, invalid project
+		ReaSnapshot();
+
+		// Takes project apart into shared pieces. Pass it with std::move to take its strings
+		// rather than copy them.
+		explicit ReaSnapshot(ReaProject project);
+
+		// The project's own fields, with Tracks and Takes empty
+		const ReaProject& Project() const { return *m_root->Project; }
+
+		size_t TrackCount() const { return m_root->Tracks.size(); }
+		const ReaSnapshotTrack& Track(size_t index) const { return *m_root->Tracks[index]; }
+
+		// A whole project again, each item's takes back in ReaProject::Takes
+		ReaProject ToProject() const;
+
+		// Edits, each returning a new snapshot and leaving this one as it was. Indices out of
+		// range throw an Exception. Tracks, items and FX are edited on a copy, without
+		// their MediaItems, FXChain or the project's Tracks and Takes, which are ignored.
+		ReaSnapshot EditProject(const std::function<void(ReaProject&)>& edit) const;
+		ReaSnapshot EditTrack(size_t track, const std::function<void(ReaTrack&)>& edit) const;
+		ReaSnapshot EditItem(size_t track, size_t item, const std::function<void(ReaMediaItem&, ReaTakes&)>& edit) const;
+		ReaSnapshot EditFX(size_t track, size_t fx, const std::function<void(ReaFX&)>& edit) const;
+
+		ReaSnapshot InsertTrack(size_t at, const ReaTrack& track) const;
+		ReaSnapshot InsertItem(size_t track, size_t at, const ReaMediaItem& item, const ReaTakes& takes = ReaTakes()) const;
+		ReaSnapshot InsertFX(size_t track, size_t at, const ReaFX& fx) const;
+
+		ReaSnapshot RemoveTrack(size_t track) const;
+		ReaSnapshot RemoveItem(size_t track, size_t item) const;
+		ReaSnapshot RemoveFX(size_t track, size_t fx) const;
+	private:
+		struct Root {
+			std::shared_ptr<const ReaProject> Project;
+			ReaPersistentVector<std::shared_ptr<const ReaSnapshotTrack>> Tracks;
+		};
+		std::shared_ptr<const Root> m_root;
+
+		explicit ReaSnapshot(std::shared_ptr<const Root> root) : m_root(std::move(root)) {}
+
+		// Copy of a track to edit, and the snapshot with it in place of the original
+		std::shared_ptr<ReaSnapshotTrack> CopyTrack(size_t track) const;
+		ReaSnapshot WithTrack(size_t track, std::shared_ptr<const ReaSnapshotTrack> node) const;
+	};
+
+	// Undo history of snapshots. Each step keeps the snapshot it made, which shares all but
+	// what the step changed with the one before, so thousands of steps cost little more than
+	// the edits themselves. Undo and redo only move between them.
+	class ReaHistory {
+	public:
+		// Starts from initial. Past maxSteps steps the oldest are forgotten, 0 for no limit.
+		explicit ReaHistory(ReaSnapshot initial = ReaSnapshot(), size_t maxSteps = 0);
+
+		const ReaSnapshot& Current() const { return m_steps[m_current]; }
+
+		// Makes snapshot the current one as a new step, forgetting the steps that could be redone
+		const ReaSnapshot& Commit(ReaSnapshot snapshot);
+
+		// Commits edit applied to the current snapshot
+		const ReaSnapshot& Apply(const std::function<ReaSnapshot(const ReaSnapshot&)>& edit);
+
+		// Steps back or forward, false if there's no step to go to
+		bool Undo();
+		bool Redo();
+
+		size_t UndoSteps() const { return m_current; }
+		size_t RedoSteps() const { return m_steps.size() - m_current - 1; }
+	private:
+		std::deque<ReaSnapshot> m_steps;
+		size_t m_current = 0;
+		size_t m_maxSteps = 0;
+	};
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	namespace Snapshot {
+		// Throws unless index is below size, or at most size to insert at
+		inline void Check(size_t index, size_t size, const char* what, bool inserting = false) {
+			if (index > size || (index == size && !inserting))
+				throw Exception(std::string("Snapshot ") + what + " index " + std::to_string(index) +
+					" out of range, there are " + std::to_string(size));
+		}
+
+		// Copy of track without its items and FX
+		inline std::shared_ptr<const ReaTrack> TrackFields(const ReaTrack& track) {
+			std::shared_ptr<ReaTrack> fields = std::make_shared<ReaTrack>(track);
+			fields->MediaItems = ReaMediaItems();
+			fields->FXChain = ReaFXChain();
+			return fields;
+		}
+	}
+
+	REAPARSER_API ReaSnapshot::ReaSnapshot() {
+		std::shared_ptr<Root> root = std::make_shared<Root>();
+		root->Project = std::make_shared<ReaProject>();
+		m_root = std::move(root);
+	}
+
+	REAPARSER_API ReaSnapshot::ReaSnapshot(ReaProject project) {
+		std::shared_ptr<Root> root = std::make_shared<Root>();
+		ReaTracks tracks = std::move(project.Tracks);
+		ReaTakes takes = std::move(project.Takes);
+		project.Tracks.clear();
+		project.Takes.clear();
+
+		std::vector<std::shared_ptr<const ReaSnapshotTrack>> trackNodes;
+		trackNodes.reserve(tracks.size());
+		for (ReaTrack& track : tracks) {
+			std::vector<std::shared_ptr<const ReaSnapshotItem>> items;
+			items.reserve(track.MediaItems.size());
+			for (ReaMediaItem& item : track.MediaItems) {
+				std::shared_ptr<ReaSnapshotItem> itemNode = std::make_shared<ReaSnapshotItem>();
+				if (item.TakeCount && item.FirstTake + item.TakeCount <= takes.size())
+					itemNode->Takes.assign(std::make_move_iterator(takes.begin() + item.FirstTake),
+						std::make_move_iterator(takes.begin() + item.FirstTake + item.TakeCount));
+				item.FirstTake = 0;
+				item.TakeCount = static_cast<uint32_t>(itemNode->Takes.size());
+				itemNode->Item = std::move(item);
+				items.push_back(std::move(itemNode));
+			}
+
+			std::vector<std::shared_ptr<const ReaFX>> fxChain;
+			fxChain.reserve(track.FXChain.size());
+			for (ReaFX& fx : track.FXChain)
+				fxChain.push_back(std::make_shared<ReaFX>(std::move(fx)));
+
+			std::shared_ptr<ReaSnapshotTrack> node = std::make_shared<ReaSnapshotTrack>();
+			track.MediaItems = ReaMediaItems();
+			track.FXChain = ReaFXChain();
+			node->m_track = std::make_shared<ReaTrack>(std::move(track));
+			node->m_items = ReaPersistentVector<std::shared_ptr<const ReaSnapshotItem>>(std::move(items));
+			node->m_fx = ReaPersistentVector<std::shared_ptr<const ReaFX>>(std::move(fxChain));
+			trackNodes.push_back(std::move(node));
+		}
+
+		root->Project = std::make_shared<ReaProject>(std::move(project));
+		root->Tracks = ReaPersistentVector<std::shared_ptr<const ReaSnapshotTrack>>(std::move(trackNodes));
+		m_root = std::move(root);
+	}
+
+	REAPARSER_API ReaProject ReaSnapshot::ToProject() const {
+		ReaProject project = Project();
+		project.Tracks.reserve(TrackCount());
+		for (size_t t = 0; t < TrackCount(); t++) {
+			const ReaSnapshotTrack& node = Track(t);
+			project.Tracks.push_back(node.Track());
+			ReaTrack& track = project.Tracks.back();
+
+			track.MediaItems.reserve(node.ItemCount());
+			for (size_t i = 0; i < node.ItemCount(); i++) {
+				const ReaSnapshotItem& item = node.Item(i);
+				track.MediaItems.push_back(item.Item);
+				track.MediaItems.back().FirstTake = static_cast<uint32_t>(project.Takes.size());
+				track.MediaItems.back().TakeCount = static_cast<uint32_t>(item.Takes.size());
+				project.Takes.insert(project.Takes.end(), item.Takes.begin(), item.Takes.end());
+			}
+
+			track.FXChain.reserve(node.FXCount());
+			for (size_t i = 0; i < node.FXCount(); i++)
+				track.FXChain.push_back(node.FX(i));
+		}
+		return project;
+	}
+
+	REAPARSER_API std::shared_ptr<ReaSnapshotTrack> ReaSnapshot::CopyTrack(size_t track) const {
+		Snapshot::Check(track, TrackCount(), "track");
+		return std::make_shared<ReaSnapshotTrack>(Track(track));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::WithTrack(size_t track, std::shared_ptr<const ReaSnapshotTrack> node) const {
+		std::shared_ptr<Root> root = std::make_shared<Root>(*m_root);
+		root->Tracks = root->Tracks.Set(track, std::move(node));
+		return ReaSnapshot(std::move(root));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::EditProject(const std::function<void(ReaProject&)>& edit) const {
+		std::shared_ptr<ReaProject> project = std::make_shared<ReaProject>(Project());
+		edit(*project);
+		project->Tracks = ReaTracks();
+		project->Takes = ReaTakes();
+
+		std::shared_ptr<Root> root = std::make_shared<Root>(*m_root);
+		root->Project = std::move(project);
+		return ReaSnapshot(std::move(root));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::EditTrack(size_t track, const std::function<void(ReaTrack&)>& edit) const {
+		std::shared_ptr<ReaSnapshotTrack> node = CopyTrack(track);
+		ReaTrack fields = *node->m_track;
+		edit(fields);
+		node->m_track = Snapshot::TrackFields(fields);
+		return WithTrack(track, std::move(node));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::EditItem(size_t track, size_t item,
+		const std::function<void(ReaMediaItem&, ReaTakes&)>& edit) const {
+		std::shared_ptr<ReaSnapshotTrack> node = CopyTrack(track);
+		Snapshot::Check(item, node->m_items.size(), "item");
+		std::shared_ptr<ReaSnapshotItem> itemNode = std::make_shared<ReaSnapshotItem>(*node->m_items[item]);
+		edit(itemNode->Item, itemNode->Takes);
+		itemNode->Item.FirstTake = 0;
+		itemNode->Item.TakeCount = static_cast<uint32_t>(itemNode->Takes.size());
+		node->m_items = node->m_items.Set(item, std::move(itemNode));
+		return WithTrack(track, std::move(node));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::EditFX(size_t track, size_t fx, const std::function<void(ReaFX&)>& edit) const {
+		std::shared_ptr<ReaSnapshotTrack> node = CopyTrack(track);
+		Snapshot::Check(fx, node->m_fx.size(), "FX");
+		std::shared_ptr<ReaFX> fxNode = std::make_shared<ReaFX>(*node->m_fx[fx]);
+		edit(*fxNode);
+		node->m_fx = node->m_fx.Set(fx, std::move(fxNode));
+		return WithTrack(track, std::move(node));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::InsertTrack(size_t at, const ReaTrack& track) const {
+		Snapshot::Check(at, TrackCount(), "track", true);
+		std::shared_ptr<ReaSnapshotTrack> node = std::make_shared<ReaSnapshotTrack>();
+		node->m_track = Snapshot::TrackFields(track);
+
+		std::shared_ptr<Root> root = std::make_shared<Root>(*m_root);
+		root->Tracks = root->Tracks.Insert(at, std::move(node));
+		return ReaSnapshot(std::move(root));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::InsertItem(size_t track, size_t at, const ReaMediaItem& item, const ReaTakes& takes) const {
+		std::shared_ptr<ReaSnapshotTrack> node = CopyTrack(track);
+		Snapshot::Check(at, node->m_items.size(), "item", true);
+		std::shared_ptr<ReaSnapshotItem> itemNode = std::make_shared<ReaSnapshotItem>();
+		itemNode->Item = item;
+		itemNode->Takes = takes;
+		itemNode->Item.FirstTake = 0;
+		itemNode->Item.TakeCount = static_cast<uint32_t>(takes.size());
+		node->m_items = node->m_items.Insert(at, std::move(itemNode));
+		return WithTrack(track, std::move(node));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::InsertFX(size_t track, size_t at, const ReaFX& fx) const {
+		std::shared_ptr<ReaSnapshotTrack> node = CopyTrack(track);
+		Snapshot::Check(at, node->m_fx.size(), "FX", true);
+		node->m_fx = node->m_fx.Insert(at, std::make_shared<ReaFX>(fx));
+		return WithTrack(track, std::move(node));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::RemoveTrack(size_t track) const {
+		Snapshot::Check(track, TrackCount(), "track");
+		std::shared_ptr<Root> root = std::make_shared<Root>(*m_root);
+		root->Tracks = root->Tracks.Erase(track);
+		return ReaSnapshot(std::move(root));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::RemoveItem(size_t track, size_t item) const {
+		std::shared_ptr<ReaSnapshotTrack> node = CopyTrack(track);
+		Snapshot::Check(item, node->m_items.size(), "item");
+		node->m_items = node->m_items.Erase(item);
+		return WithTrack(track, std::move(node));
+	}
+
+	REAPARSER_API ReaSnapshot ReaSnapshot::RemoveFX(size_t track, size_t fx) const {
+		std::shared_ptr<ReaSnapshotTrack> node = CopyTrack(track);
+		Snapshot::Check(fx, node->m_fx.size(), "FX");
+		node->m_fx = node->m_fx.Erase(fx);
+		return WithTrack(track, std::move(node));
+	}
+
+	REAPARSER_API ReaHistory::ReaHistory(ReaSnapshot initial, size_t maxSteps) : m_maxSteps(maxSteps) {
+		m_steps.push_back(std::move(initial));
+	}
+
+	REAPARSER_API const ReaSnapshot& ReaHistory::Commit(ReaSnapshot snapshot) {
+		m_steps.resize(m_current + 1);
+		m_steps.push_back(std::move(snapshot));
+		m_current++;
+
+		if (m_maxSteps && m_current > m_maxSteps) {
+			m_steps.pop_front();
+			m_current--;
+		}
+		return Current();
+	}
+
+	REAPARSER_API const ReaSnapshot& ReaHistory::Apply(const std::function<ReaSnapshot(const ReaSnapshot&)>& edit) {
+		return Commit(edit(Current()));
+	}
+
+	REAPARSER_API bool ReaHistory::Undo() {
+		if (m_current == 0)
+			return false;
+		m_current--;
+		return true;
+	}
+
+	REAPARSER_API bool ReaHistory::Redo() {
+		if (m_current + 1 >= m_steps.size())
+			return false;
+		m_current++;
+		return true;
+	}
+#endif
+}
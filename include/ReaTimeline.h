@@ -0,0 +1,211 @@
+#pragma once
+
+#include "ReaParser.h"
+
+#include <functional>
+
+// Timeline checks: finds media items overlapping each other and gaps between items on
+// each track, by sorting item starts and ends and sweeping over them once per track.
+
+namespace ReaParser {
+
+	enum class ReaTimelineIssueType {
+		Overlap, Gap
+	};
+
+	struct ReaTimelineIssue {
+		ReaTimelineIssueType Type = ReaTimelineIssueType::Overlap;
+
+		// Index in ReaProject::Tracks
+		size_t Track = 0;
+
+		// Indices in ReaTrack::MediaItems: the overlapping items, the earlier one first,
+		// or the items before and after a gap
+		size_t First = 0, Second = 0;
+
+		// Span of the overlap or gap in seconds
+		double Start = 0.0, End = 0.0;
+	};
+
+	struct ReaTimelineOptions {
+		// Overlaps no longer than MinOverlap seconds, such as crossfades, aren't reported
+		bool Overlaps = true;
+		double MinOverlap = 0.0;
+
+		// Gaps no longer than MinGap seconds aren't reported
+		bool Gaps = true;
+		double MinGap = 0.0;
+
+		// Tracks gaps are looked for on, every track if not set
+		std::function<bool(const ReaTrack&)> GapTracks;
+
+		// Leave muted items out
+		bool SkipMuted = false;
+
+		// Tracks checked at once, 0 for one per hardware thread
+		unsigned int Threads = 0;
+	};
+
+	// Overlaps and gaps on every track of project, by track then time
+	REAPARSER_API std::vector<ReaTimelineIssue> CheckTimeline(const ReaProject& project,
+		const ReaTimelineOptions& options = ReaTimelineOptions());
+
+	// Checks many projects at once, spreading all of their tracks over one pool of threads
+	REAPARSER_API std::vector<std::vector<ReaTimelineIssue>> CheckTimelines(const std::vector<ReaProject>& projects,
+		const ReaTimelineOptions& options = ReaTimelineOptions());
+
+	// -------------- //
+	// Implementation //
+	// -------------- //
+
+#if !defined(REAPARSER_STATIC) || defined(REAPARSER_IMPLEMENTATION)
+	namespace Timeline {
+		// An item's start or end, keyed by its position
+		struct Event {
+			uint32_t Key;
+			uint32_t Item; // Top bit set for starts
+		};
+
+		static constexpr uint32_t StartFlag = 0x80000000u;
+
+		// Position bits that order like the positions themselves
+		inline uint32_t SortKey(float position) {
+			uint32_t bits;
+			memcpy(&bits, &position, sizeof(bits));
+			return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+		}
+
+		// Stable LSD radix sort by key, a byte per pass, skipping bytes every key shares
+		inline void SortEvents(std::vector<Event>& events, std::vector<Event>& scratch) {
+			if (events.size() < 64) {
+				std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.Key < b.Key; });
+				return;
+			}
+
+			scratch.resize(events.size());
+			for (int shift = 0; shift < 32; shift += 8) {
+				size_t counts[256] = {};
+				for (auto& event : events)
+					counts[(event.Key >> shift) & 0xff]++;
+				if (counts[(events[0].Key >> shift) & 0xff] == events.size())
+					continue;
+
+				size_t offset = 0;
+				for (size_t& count : counts) {
+					size_t next = offset + count;
+					count = offset;
+					offset = next;
+				}
+				for (auto& event : events)
+					scratch[counts[(event.Key >> shift) & 0xff]++] = event;
+				events.swap(scratch);
+			}
+		}
+
+		inline void CheckTrack(const ReaTrack& track, size_t index, const ReaTimelineOptions& options,
+			std::vector<ReaTimelineIssue>& issues) {
+			const std::vector<ReaMediaItem>& items = track.MediaItems;
+			bool gaps = options.Gaps && (!options.GapTracks || options.GapTracks(track));
+			if ((!gaps && !options.Overlaps) || items.empty())
+				return;
+
+			// Ends go in before starts, so the stable sort puts an item ending where another
+			// starts first and the two neither overlap nor leave a gap. Empty items are left out.
+			std::vector<Event> events, scratch;
+			events.reserve(items.size() * 2);
+			for (uint32_t i = 0; i < items.size(); i++) {
+				if ((!options.SkipMuted || !items[i].Muted) && items[i].End > items[i].Start)
+					events.push_back({ SortKey(items[i].End), i });
+			}
+			size_t ends = events.size();
+			for (size_t i = 0; i < ends; i++)
+				events.push_back({ SortKey(items[events[i].Item].Start), events[i].Item | StartFlag });
+			SortEvents(events, scratch);
+
+			// Items playing at the sweep position, and where each sits among them
+			std::vector<uint32_t> active;
+			std::vector<size_t> slots(items.size());
+			bool ended = false;
+			size_t lastEnded = 0;
+
+			for (auto& event : events) {
+				uint32_t item = event.Item & ~StartFlag;
+				if (!(event.Item & StartFlag)) {
+					size_t slot = slots[item];
+					active[slot] = active.back();
+					slots[active[slot]] = slot;
+					active.pop_back();
+					if (active.empty()) {
+						ended = true;
+						lastEnded = item;
+					}
+					continue;
+				}
+
+				double start = items[item].Start;
+				if (gaps && active.empty() && ended && start - items[lastEnded].End > options.MinGap) {
+					ReaTimelineIssue gap;
+					gap.Type = ReaTimelineIssueType::Gap;
+					gap.Track = index;
+					gap.First = lastEnded;
+					gap.Second = item;
+					gap.Start = items[lastEnded].End;
+					gap.End = start;
+					issues.push_back(gap);
+				}
+
+				if (options.Overlaps) {
+					for (uint32_t other : active) {
+						double end = std::min(items[other].End, items[item].End);
+						if (end - start > options.MinOverlap) {
+							ReaTimelineIssue overlap;
+							overlap.Track = index;
+							overlap.First = other;
+							overlap.Second = item;
+							overlap.Start = start;
+							overlap.End = end;
+							issues.push_back(overlap);
+						}
+					}
+				}
+
+				slots[item] = active.size();
+				active.push_back(item);
+			}
+		}
+
+		// Checks every track of count projects on one pool of threads
+		inline std::vector<std::vector<ReaTimelineIssue>> Check(const ReaProject* const* projects, size_t count,
+			const ReaTimelineOptions& options) {
+			std::vector<std::pair<size_t, size_t>> tracks;
+			for (size_t i = 0; i < count; i++) {
+				for (size_t j = 0; j < projects[i]->Tracks.size(); j++)
+					tracks.emplace_back(i, j);
+			}
+			std::vector<std::vector<ReaTimelineIssue>> found(tracks.size());
+
+			ReaThreadPool::For(tracks.size(), options.Threads, [&](size_t i, unsigned int) {
+				CheckTrack(projects[tracks[i].first]->Tracks[tracks[i].second], tracks[i].second, options, found[i]);
+			});
+
+			std::vector<std::vector<ReaTimelineIssue>> issues(count);
+			for (size_t i = 0; i < tracks.size(); i++)
+				issues[tracks[i].first].insert(issues[tracks[i].first].end(), found[i].begin(), found[i].end());
+			return issues;
+		}
+	}
+
+	REAPARSER_API std::vector<ReaTimelineIssue> CheckTimeline(const ReaProject& project, const ReaTimelineOptions& options) {
+		const ReaProject* projects[] = { &project };
+		return Timeline::Check(projects, 1, options)[0];
+	}
+
+	REAPARSER_API std::vector<std::vector<ReaTimelineIssue>> CheckTimelines(const std::vector<ReaProject>& projects,
+		const ReaTimelineOptions& options) {
+		std::vector<const ReaProject*> pointers;
+		for (auto& project : projects)
+			pointers.push_back(&project);
+		return Timeline::Check(pointers.data(), pointers.size(), options);
+	}
+#endif
+}
@@ -0,0 +1,20 @@
+// Compiles the parser once for the ReaParser::static library target.
+// Translation units linking it define REAPARSER_STATIC and only see declarations.
+
+#define REAPARSER_IMPLEMENTATION
+#include "../include/ReaParser.h"
+#include "../include/ReaMedia.h"
+#include "../include/ReaRender.h"
+#include "../include/ReaPeaks.h"
+#include "../include/ReaTimeline.h"
+#include "../include/ReaCorpus.h"
+#include "../include/ReaJson.h"
+#include "../include/ReaArrow.h"
+#include "../include/ReaSnapshot.h"
+
+namespace ReaParser {
+	template ReaProject LoadProjectFile<ReaVolumeDB, ReaPanNormalized>(const char*, ReaOptions, ReaParseStats*);
+	template ReaProject LoadProjectFile<ReaVolumeDB, ReaPanPercent>(const char*, ReaOptions, ReaParseStats*);
+	template ReaProject LoadProjectFile<ReaVolumeAmplitude, ReaPanNormalized>(const char*, ReaOptions, ReaParseStats*);
+	template ReaProject LoadProjectFile<ReaVolumeAmplitude, ReaPanPercent>(const char*, ReaOptions, ReaParseStats*);
+}
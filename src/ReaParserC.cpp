@@ -0,0 +1,257 @@
+// C API over the compiled parser (see include/ReaParserC.h). No exception leaves a function
+// here: failures are kept per thread for rea_last_error.
+
+#include "../include/ReaParser.h"
+#include "../include/ReaParserC.h"
+
+using namespace ReaParser;
+
+struct rea_project {
+	ReaProject Project;
+
+	// Index of each track's first item and FX among those of the whole project, with the
+	// totals last, to find where a project-wide index falls
+	std::vector<size_t> ItemStarts, FXStarts;
+};
+
+namespace {
+	thread_local std::string s_error;
+
+	bool Check(const rea_project* project) {
+		s_error.clear();
+		if (!project)
+			s_error = "project is NULL";
+		return project != nullptr;
+	}
+
+	// Checks project and the pointer results are written through, named name
+	bool Check(const rea_project* project, const void* out, const char* name) {
+		if (!Check(project))
+			return false;
+		if (!out)
+			s_error = std::string(name) + " is NULL";
+		return out != nullptr;
+	}
+
+	rea_string View(const std::string& value) {
+		rea_string view = { value.c_str(), value.size() };
+		return view;
+	}
+
+	void Fill(const ReaTrack& track, uint32_t, rea_track& out) {
+		out.name = View(track.Name);
+		out.guid = View(track.GUID);
+		out.id = track.NumericID;
+		out.channels = track.Channels;
+		out.volume = track.Volume;
+		out.pan = track.Pan;
+		out.raw_volume = track.RawVolume;
+		out.raw_pan = track.RawPan;
+		out.folder_depth = track.FolderDepth;
+		out.muted = track.Muted;
+		out.phase_inverted = track.PhaseInverted;
+		out.item_count = track.MediaItems.size();
+		out.fx_count = track.FXChain.size();
+	}
+
+	void Fill(const ReaMediaItem& item, uint32_t track, rea_item& out) {
+		out.name = View(item.Name);
+		out.filepath = View(item.Filepath);
+		out.type = static_cast<int32_t>(item.Type);
+		out.start = item.Start;
+		out.end = item.End;
+		out.length = item.Length;
+		out.start_offset = item.StartOffset;
+		out.volume = item.Volume;
+		out.pan = item.Pan;
+		out.raw_volume = item.RawVolume;
+		out.raw_pan = item.RawPan;
+		out.track = track;
+		out.muted = item.Muted;
+	}
+
+	void Fill(const ReaFX& fx, uint32_t track, rea_fx& out) {
+		out.name = View(fx.Name);
+		out.filepath = View(fx.Filepath);
+		out.data = View(fx.Data);
+		out.type = static_cast<int32_t>(fx.Type);
+		out.track = track;
+	}
+
+	void Fill(const ReaMediaItem& item, uint32_t, float ReaMediaItem::* field, float& out) {
+		out = item.*field;
+	}
+
+	// Fills out from the entries of list on tracks track, track + 1... starting at first of
+	// track's, as many as fit in capacity
+	template <class Entry, class Out, class... Args>
+	size_t Gather(const ReaProject& project, std::vector<Entry> ReaTrack::* list, size_t track, size_t first,
+		Out* out, size_t capacity, bool allTracks, Args... args) {
+		size_t filled = 0;
+		for (; track < project.Tracks.size() && filled < capacity; track++, first = 0) {
+			const std::vector<Entry>& entries = project.Tracks[track].*list;
+			for (size_t i = first; i < entries.size() && filled < capacity; i++)
+				Fill(entries[i], static_cast<uint32_t>(track), args..., out[filled++]);
+			if (!allTracks)
+				break;
+		}
+		return filled;
+	}
+
+	// Track holding the entry at a project-wide index, with the index within the track
+	size_t Locate(const std::vector<size_t>& starts, size_t& index) {
+		size_t track = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), index) - starts.begin()) - 1;
+		index -= starts[track];
+		return track;
+	}
+}
+
+extern "C" {
+	REAPARSER_C_API int rea_abi_version(void) {
+		return REAPARSER_C_ABI_VERSION;
+	}
+
+	REAPARSER_C_API const char* rea_last_error(void) {
+		return s_error.c_str();
+	}
+
+	REAPARSER_C_API void rea_options_default(rea_options* options) {
+		if (!options)
+			return;
+		ReaOptions defaults;
+		options->convert_volume_to_db = defaults.ConvertVolumeToDB;
+		options->normalize_pan = defaults.NormalizePan;
+		options->exact_decibels = defaults.ExactDecibels;
+		options->max_line_length = defaults.MaxLineLength;
+		options->max_depth = defaults.MaxDepth;
+	}
+
+	REAPARSER_C_API rea_project* rea_project_load(const char* filepath, const rea_options* options) {
+		s_error.clear();
+		if (!filepath) {
+			s_error = "filepath is NULL";
+			return nullptr;
+		}
+
+		ReaOptions parseOptions;
+		if (options) {
+			parseOptions.ConvertVolumeToDB = options->convert_volume_to_db != 0;
+			parseOptions.NormalizePan = options->normalize_pan != 0;
+			parseOptions.ExactDecibels = options->exact_decibels != 0;
+			parseOptions.MaxLineLength = options->max_line_length;
+			parseOptions.MaxDepth = options->max_depth;
+		}
+
+		try {
+			std::unique_ptr<rea_project> project(new rea_project());
+			project->Project = LoadProjectFile(filepath, parseOptions);
+			if (!project->Project.IsValid()) {
+				s_error = "Unable to load Reaper project: " + std::string(filepath);
+				return nullptr;
+			}
+
+			const ReaTracks& tracks = project->Project.Tracks;
+			project->ItemStarts.resize(tracks.size() + 1, 0);
+			project->FXStarts.resize(tracks.size() + 1, 0);
+			for (size_t i = 0; i < tracks.size(); i++) {
+				project->ItemStarts[i + 1] = project->ItemStarts[i] + tracks[i].MediaItems.size();
+				project->FXStarts[i + 1] = project->FXStarts[i] + tracks[i].FXChain.size();
+			}
+			return project.release();
+		}
+		catch (Exception& e) {
+			s_error = e.What();
+		}
+		catch (std::exception& e) {
+			s_error = e.what();
+		}
+		catch (...) {
+			s_error = "Unable to load Reaper project: " + std::string(filepath);
+		}
+		return nullptr;
+	}
+
+	REAPARSER_C_API void rea_project_free(rea_project* project) {
+		delete project;
+	}
+
+	REAPARSER_C_API int rea_project_info_get(const rea_project* project, rea_project_info* info) {
+		if (!Check(project, info, "info"))
+			return -1;
+		const ReaProject& p = project->Project;
+		info->name = View(p.Name);
+		info->filepath = View(p.Filepath);
+		info->record_path = View(p.RecordPath);
+		info->secondary_record_path = View(p.SecondaryRecordPath);
+		info->version_major = p.Version.Major;
+		info->version_minor = p.Version.Minor;
+		info->sample_rate = p.SampleRate;
+		info->beats = p.Tempo.Beats;
+		info->bars = p.Tempo.Bars;
+		info->bpm = p.Tempo.BPM;
+		info->track_count = p.Tracks.size();
+		info->item_count = project->ItemStarts.back();
+		info->fx_count = project->FXStarts.back();
+		return 0;
+	}
+
+	REAPARSER_C_API size_t rea_project_tracks(const rea_project* project, size_t first, rea_track* out, size_t capacity) {
+		if (!Check(project, out, "out"))
+			return 0;
+		const ReaTracks& tracks = project->Project.Tracks;
+		size_t filled = 0;
+		for (size_t i = first; i < tracks.size() && filled < capacity; i++)
+			Fill(tracks[i], static_cast<uint32_t>(i), out[filled++]);
+		return filled;
+	}
+
+	REAPARSER_C_API size_t rea_track_items(const rea_project* project, size_t track, size_t first, rea_item* out, size_t capacity) {
+		if (!Check(project, out, "out"))
+			return 0;
+		return Gather(project->Project, &ReaTrack::MediaItems, track, first, out, capacity, false);
+	}
+
+	REAPARSER_C_API size_t rea_track_fx(const rea_project* project, size_t track, size_t first, rea_fx* out, size_t capacity) {
+		if (!Check(project, out, "out"))
+			return 0;
+		return Gather(project->Project, &ReaTrack::FXChain, track, first, out, capacity, false);
+	}
+
+	REAPARSER_C_API size_t rea_project_items(const rea_project* project, size_t first, rea_item* out, size_t capacity) {
+		if (!Check(project, out, "out") || first >= project->ItemStarts.back())
+			return 0;
+		size_t track = Locate(project->ItemStarts, first);
+		return Gather(project->Project, &ReaTrack::MediaItems, track, first, out, capacity, true);
+	}
+
+	REAPARSER_C_API size_t rea_project_fx(const rea_project* project, size_t first, rea_fx* out, size_t capacity) {
+		if (!Check(project, out, "out") || first >= project->FXStarts.back())
+			return 0;
+		size_t track = Locate(project->FXStarts, first);
+		return Gather(project->Project, &ReaTrack::FXChain, track, first, out, capacity, true);
+	}
+
+	REAPARSER_C_API size_t rea_project_item_column(const rea_project* project, rea_item_field field, size_t first,
+		float* out, size_t capacity) {
+		if (!Check(project, out, "out") || first >= project->ItemStarts.back())
+			return 0;
+
+		float ReaMediaItem::* member;
+		switch (field) {
+		case REA_ITEM_START: member = &ReaMediaItem::Start; break;
+		case REA_ITEM_END: member = &ReaMediaItem::End; break;
+		case REA_ITEM_LENGTH: member = &ReaMediaItem::Length; break;
+		case REA_ITEM_START_OFFSET: member = &ReaMediaItem::StartOffset; break;
+		case REA_ITEM_VOLUME: member = &ReaMediaItem::Volume; break;
+		case REA_ITEM_PAN: member = &ReaMediaItem::Pan; break;
+		case REA_ITEM_RAW_VOLUME: member = &ReaMediaItem::RawVolume; break;
+		case REA_ITEM_RAW_PAN: member = &ReaMediaItem::RawPan; break;
+		default:
+			s_error = "Unknown item field " + std::to_string(static_cast<int>(field));
+			return 0;
+		}
+
+		size_t track = Locate(project->ItemStarts, first);
+		return Gather(project->Project, &ReaTrack::MediaItems, track, first, out, capacity, true, member);
+	}
+}
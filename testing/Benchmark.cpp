@@ -0,0 +1,495 @@
+// ReaParser benchmark suite
+//
+// Measures per-phase throughput of LoadProjectFile on small, medium and huge
+// corpora. The small corpus is the test project, the larger ones are synthesized
+// by ProjectGenerator up to the requested size.
+//
+// With --perf, hardware counters (cycles, instructions, branch and LLC misses)
+// are read around each phase as well, where the platform exposes them.
+//
+// Usage: Benchmark [--corpus small|medium|huge|all] [--file path.rpp]
+//                  [--iterations N] [--medium-mb N] [--huge-mb N] [--seed N]
+//                  [--source path.rpp] [--workdir dir] [--perf] [--json] [--out file]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+// Phase hooks must be visible before the parser is included
+void BenchPhaseBegin(int phase, FILE* fp);
+void BenchPhaseEnd(int phase, FILE* fp);
+
+#define REAPARSER_PHASE_BEGIN(phase, fp) ::BenchPhaseBegin(static_cast<int>(phase), fp)
+#define REAPARSER_PHASE_END(phase, fp) ::BenchPhaseEnd(static_cast<int>(phase), fp)
+
+// Per-phase allocations are read from the parser's ReaAllocCounters
+#define REAPARSER_STATS_ALLOCATOR
+
+#include "../include/ReaParser.h"
+#include "ProjectGenerator.h"
+#include "PerfCounters.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+// ------------ //
+// Phase timing //
+// ------------ //
+
+constexpr int PhaseCount = static_cast<int>(ReaParser::ReaPhase::Count);
+
+static const char* PhaseName(int phase) {
+	static const char* names[PhaseCount] = {
+		"metadata", "properties", "master", "tracks", "items", "fx"
+	};
+	return names[phase];
+}
+
+// Exclusive totals per phase: time spent in a nested phase is not
+// counted towards its parent.
+struct PhaseTotals {
+	double Seconds = 0.0;
+	uint64_t Bytes = 0, Calls = 0, Allocations = 0, AllocatedBytes = 0;
+	PerfSample Counters;
+};
+
+struct PhaseFrame {
+	int Phase;
+	Clock::time_point Since;
+	long Offset;
+	uint64_t AllocCount, AllocBytes;
+	PerfSample Counters;
+};
+
+static PhaseTotals g_phases[PhaseCount];
+static PhaseFrame g_stack[16];
+static int g_depth = 0;
+
+// Set when hardware counters were requested and at least one is available
+static PerfCounters* g_perf = nullptr;
+
+static void AddCounters(PerfSample& totals, const PerfSample& from, const PerfSample& to) {
+	for (int i = 0; i < PerfCounterCount; i++)
+		totals.Values[i] += to.Values[i] - from.Values[i];
+}
+
+// Charge everything since the frame was last resumed to its phase
+static void ChargeTop(FILE* fp, Clock::time_point now) {
+	PhaseFrame& top = g_stack[g_depth - 1];
+	PhaseTotals& totals = g_phases[top.Phase];
+	long offset = ftell(fp);
+	const ReaParser::ReaAllocCounters& allocs = ReaParser::ReaAllocCounters::Current();
+
+	totals.Seconds += std::chrono::duration<double>(now - top.Since).count();
+	if (offset > top.Offset)
+		totals.Bytes += offset - top.Offset;
+	totals.Allocations += allocs.Count - top.AllocCount;
+	totals.AllocatedBytes += allocs.Bytes - top.AllocBytes;
+
+	PerfSample counters;
+	if (g_perf && g_perf->Read(counters))
+		AddCounters(totals.Counters, top.Counters, counters);
+}
+
+static void ResumeTop(FILE* fp) {
+	PhaseFrame& top = g_stack[g_depth - 1];
+	top.Offset = ftell(fp);
+	top.AllocCount = ReaParser::ReaAllocCounters::Current().Count;
+	top.AllocBytes = ReaParser::ReaAllocCounters::Current().Bytes;
+	if (g_perf)
+		g_perf->Read(top.Counters);
+	top.Since = Clock::now();
+}
+
+void BenchPhaseBegin(int phase, FILE* fp) {
+	if (g_depth > 0)
+		ChargeTop(fp, Clock::now());
+
+	g_stack[g_depth].Phase = phase;
+	g_depth++;
+	g_phases[phase].Calls++;
+	ResumeTop(fp);
+}
+
+void BenchPhaseEnd(int, FILE* fp) {
+	ChargeTop(fp, Clock::now());
+	g_depth--;
+
+	if (g_depth > 0)
+		ResumeTop(fp);
+}
+
+// ------- //
+// Corpora //
+// ------- //
+
+struct Corpus {
+	std::string Name, Filepath;
+	uint64_t Size = 0;
+};
+
+struct Result {
+	Corpus Input;
+	double Seconds = 0.0;
+	uint64_t Tracks = 0, Items = 0, FX = 0;
+	uint64_t Allocations = 0, AllocatedBytes = 0;
+	PerfSample Counters;
+	PhaseTotals Phases[PhaseCount];
+};
+
+static uint64_t FileSize(const std::string& filepath) {
+	std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+	return file ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+// ------- //
+// Running //
+// ------- //
+
+static Result RunOnce(const Corpus& corpus) {
+	Result result;
+	result.Input = corpus;
+
+	for (int i = 0; i < PhaseCount; i++)
+		g_phases[i] = PhaseTotals();
+	g_depth = 0;
+
+	ReaParser::ReaOptions options;
+	const ReaParser::ReaAllocCounters& allocs = ReaParser::ReaAllocCounters::Current();
+	uint64_t allocCount = allocs.Count, allocBytes = allocs.Bytes;
+	PerfSample countersBefore, countersAfter;
+	if (g_perf)
+		g_perf->Read(countersBefore);
+	Clock::time_point start = Clock::now();
+
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(corpus.Filepath.c_str(), options);
+
+	result.Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	if (g_perf && g_perf->Read(countersAfter))
+		AddCounters(result.Counters, countersBefore, countersAfter);
+	result.Allocations = allocs.Count - allocCount;
+	result.AllocatedBytes = allocs.Bytes - allocBytes;
+
+	for (auto& track : project.Tracks) {
+		result.Items += track.MediaItems.size();
+		result.FX += track.FXChain.size();
+	}
+	result.Tracks = project.Tracks.size();
+
+	for (int i = 0; i < PhaseCount; i++)
+		result.Phases[i] = g_phases[i];
+
+	return result;
+}
+
+// Best of n runs by total wall time
+static Result Run(const Corpus& corpus, int iterations) {
+	Result best = RunOnce(corpus);
+	for (int i = 1; i < iterations; i++) {
+		Result result = RunOnce(corpus);
+		if (result.Seconds < best.Seconds)
+			best = result;
+	}
+	return best;
+}
+
+// --------- //
+// Reporting //
+// --------- //
+
+static double PerSecond(double count, double seconds) {
+	return seconds > 0.0 ? count / seconds : 0.0;
+}
+
+// What a phase loads and how many of them, for its per second rate. Phases loading
+// nothing countable have no rate.
+static const char* PhaseUnit(int phase, const Result& r, uint64_t& count) {
+	switch (static_cast<ReaParser::ReaPhase>(phase)) {
+	case ReaParser::ReaPhase::Tracks:
+		count = r.Tracks ? r.Tracks - 1 : 0; // Not the master
+		return "tracks";
+	case ReaParser::ReaPhase::Items:
+		count = r.Items;
+		return "items";
+	case ReaParser::ReaPhase::FX:
+		count = r.FX;
+		return "fx";
+	default:
+		count = 0;
+		return nullptr;
+	}
+}
+
+static double MB(double bytes) {
+	return bytes / (1024.0 * 1024.0);
+}
+
+static double Ratio(double a, double b) {
+	return b > 0.0 ? a / b : 0.0;
+}
+
+static void PrintCountersText(std::ostream& os, const PerfSample& counters, uint64_t bytes) {
+	const uint64_t* v = counters.Values;
+	double mb = MB(bytes);
+	char line[256];
+
+	snprintf(line, sizeof(line), "  %-10s %9.2f IPC %12.0f cycles/MB %12.0f instr/MB %10.0f br-miss/MB %10.0f llc-miss/MB\n", "",
+		Ratio(v[(int)PerfCounter::Instructions], v[(int)PerfCounter::Cycles]),
+		Ratio(v[(int)PerfCounter::Cycles], mb), Ratio(v[(int)PerfCounter::Instructions], mb),
+		Ratio(v[(int)PerfCounter::BranchMisses], mb), Ratio(v[(int)PerfCounter::LLCMisses], mb));
+	os << line;
+}
+
+static void PrintText(std::ostream& os, const std::vector<Result>& results) {
+	char line[256];
+
+	if (g_perf) {
+		os << "Hardware counters:";
+		for (int i = 0; i < PerfCounterCount; i++)
+			os << " " << PerfCounters::Name(i) << (g_perf->Available(i) ? "" : " (unavailable)");
+		os << std::endl << std::endl;
+	}
+
+	for (auto& r : results) {
+		os << r.Input.Name << " (" << r.Input.Filepath << ", " << MB(r.Input.Size) << " MB)" << std::endl;
+		snprintf(line, sizeof(line), "  total      %9.4fs %9.2f MB/s %12.0f items/s %10llu allocs %10.2f MB allocated\n",
+			r.Seconds, PerSecond(MB(r.Input.Size), r.Seconds), PerSecond(r.Items, r.Seconds),
+			(unsigned long long)r.Allocations, MB(r.AllocatedBytes));
+		os << line;
+		if (g_perf)
+			PrintCountersText(os, r.Counters, r.Input.Size);
+
+		for (int i = 0; i < PhaseCount; i++) {
+			const PhaseTotals& p = r.Phases[i];
+			uint64_t count;
+			const char* unit = PhaseUnit(i, r, count);
+			char rate[64] = "";
+			if (unit)
+				snprintf(rate, sizeof(rate), "%12.0f %s/s", PerSecond(count, p.Seconds), unit);
+			snprintf(line, sizeof(line), "  %-10s %9.4fs %9.2f MB/s %-21s %10llu allocs %10.2f MB allocated\n",
+				PhaseName(i), p.Seconds, PerSecond(MB(p.Bytes), p.Seconds), rate,
+				(unsigned long long)p.Allocations, MB(p.AllocatedBytes));
+			os << line;
+			if (g_perf)
+				PrintCountersText(os, p.Counters, p.Bytes);
+		}
+		os << "  " << r.Tracks << " tracks, " << r.Items << " items, " << r.FX << " fx" << std::endl << std::endl;
+	}
+}
+
+static std::string JsonString(const std::string& str) {
+	std::string out = "\"";
+	for (char c : str) {
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+
+// Counters and the rates derived from them, null where unavailable
+static void PrintCountersJson(std::ostream& os, const PerfSample& counters, uint64_t bytes) {
+	if (!g_perf) {
+		os << "null";
+		return;
+	}
+
+	const uint64_t* v = counters.Values;
+	double mb = MB(bytes);
+	bool ipc = g_perf->Available((int)PerfCounter::Cycles) && g_perf->Available((int)PerfCounter::Instructions);
+
+	os << "{";
+	for (int i = 0; i < PerfCounterCount; i++) {
+		os << JsonString(PerfCounters::Name(i)) << ": ";
+		if (g_perf->Available(i))
+			os << v[i] << ", " << JsonString(std::string(PerfCounters::Name(i)) + "_per_mb") << ": " << Ratio(v[i], mb);
+		else
+			os << "null";
+		os << ", ";
+	}
+	os << "\"ipc\": ";
+	if (ipc)
+		os << Ratio(v[(int)PerfCounter::Instructions], v[(int)PerfCounter::Cycles]);
+	else
+		os << "null";
+	os << "}";
+}
+
+static void PrintJson(std::ostream& os, const std::vector<Result>& results, const std::string& perfError) {
+	os << "{\n  \"perf\": ";
+	if (!perfError.empty())
+		os << "{\"available\": false, \"error\": " << JsonString(perfError) << "}";
+	else if (!g_perf)
+		os << "null";
+	else
+		os << "{\"available\": true}";
+	os << ",\n  \"corpora\": [";
+	for (size_t n = 0; n < results.size(); n++) {
+		const Result& r = results[n];
+		os << (n ? "," : "") << "\n    {\n";
+		os << "      \"name\": " << JsonString(r.Input.Name) << ",\n";
+		os << "      \"file\": " << JsonString(r.Input.Filepath) << ",\n";
+		os << "      \"bytes\": " << r.Input.Size << ",\n";
+		os << "      \"tracks\": " << r.Tracks << ",\n";
+		os << "      \"items\": " << r.Items << ",\n";
+		os << "      \"fx\": " << r.FX << ",\n";
+		os << "      \"seconds\": " << r.Seconds << ",\n";
+		os << "      \"mb_per_s\": " << PerSecond(MB(r.Input.Size), r.Seconds) << ",\n";
+		os << "      \"items_per_s\": " << PerSecond(r.Items, r.Seconds) << ",\n";
+		os << "      \"allocations\": " << r.Allocations << ",\n";
+		os << "      \"allocated_bytes\": " << r.AllocatedBytes << ",\n";
+		os << "      \"counters\": ";
+		PrintCountersJson(os, r.Counters, r.Input.Size);
+		os << ",\n";
+		os << "      \"phases\": {";
+		for (int i = 0; i < PhaseCount; i++) {
+			const PhaseTotals& p = r.Phases[i];
+			os << (i ? "," : "") << "\n        " << JsonString(PhaseName(i)) << ": {";
+			os << "\"seconds\": " << p.Seconds;
+			os << ", \"bytes\": " << p.Bytes;
+			os << ", \"mb_per_s\": " << PerSecond(MB(p.Bytes), p.Seconds);
+			os << ", \"calls\": " << p.Calls;
+			uint64_t count;
+			if (const char* unit = PhaseUnit(i, r, count)) {
+				os << ", " << JsonString(unit) << ": " << count;
+				os << ", " << JsonString(std::string(unit) + "_per_s") << ": " << PerSecond(count, p.Seconds);
+			}
+			os << ", \"allocations\": " << p.Allocations;
+			os << ", \"allocated_bytes\": " << p.AllocatedBytes;
+			os << ", \"counters\": ";
+			PrintCountersJson(os, p.Counters, p.Bytes);
+			os << "}";
+		}
+		os << "\n      }\n    }";
+	}
+	os << "\n  ]\n}" << std::endl;
+}
+
+int main(int argc, const char* argv[]) {
+	std::string corpusName = "all", file, out;
+	std::string source = "testing/TestProject/TestProject.rpp";
+#ifdef _WIN32
+	const char* tmp = getenv("TEMP");
+#else
+	const char* tmp = getenv("TMPDIR");
+	if (!tmp)
+		tmp = "/tmp";
+#endif
+	std::string workdir = tmp ? tmp : ".";
+	int iterations = 3;
+	uint64_t mediumMB = 8, hugeMB = 128, seed = 1;
+	bool json = false, perf = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--json")
+			json = true;
+		else if (arg == "--perf")
+			perf = true;
+		else if (arg == "--corpus" && hasValue)
+			corpusName = argv[++i];
+		else if (arg == "--file" && hasValue)
+			file = argv[++i];
+		else if (arg == "--iterations" && hasValue)
+			iterations = std::max(1, atoi(argv[++i]));
+		else if (arg == "--medium-mb" && hasValue)
+			mediumMB = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--huge-mb" && hasValue)
+			hugeMB = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--seed" && hasValue)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--source" && hasValue)
+			source = argv[++i];
+		else if (arg == "--workdir" && hasValue)
+			workdir = argv[++i];
+		else if (arg == "--out" && hasValue)
+			out = argv[++i];
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			return -1;
+		}
+	}
+
+	std::vector<Corpus> corpora;
+	if (!file.empty()) {
+		Corpus corpus;
+		corpus.Name = "file";
+		corpus.Filepath = file;
+		corpora.push_back(corpus);
+	}
+	else {
+		if (corpusName == "small" || corpusName == "all") {
+			Corpus corpus;
+			corpus.Name = "small";
+			corpus.Filepath = source;
+			corpora.push_back(corpus);
+		}
+
+		const struct { const char* Name; uint64_t MB; } scaled[] = {
+			{ "medium", mediumMB }, { "huge", hugeMB }
+		};
+		for (auto& s : scaled) {
+			if (corpusName != s.Name && corpusName != "all")
+				continue;
+
+			Corpus corpus;
+			corpus.Name = s.Name;
+			corpus.Filepath = workdir + "/reaparser_bench_" + s.Name + ".rpp";
+
+			GeneratorOptions generatorOptions;
+			generatorOptions.Seed = seed;
+			generatorOptions.TargetBytes = s.MB * 1024 * 1024;
+			if (!ProjectGenerator(generatorOptions).Generate(corpus.Filepath.c_str())) {
+				std::cerr << "Unable to generate " << s.Name << " corpus in " << workdir << std::endl;
+				return -1;
+			}
+			corpora.push_back(corpus);
+		}
+	}
+
+	if (corpora.empty()) {
+		std::cerr << "Unknown corpus: " << corpusName << std::endl;
+		return -1;
+	}
+
+	// Carry on without counters when none can be opened
+	PerfCounters counters;
+	std::string perfError;
+	if (perf) {
+		if (counters.Open())
+			g_perf = &counters;
+		else {
+			perfError = counters.Error();
+			std::cerr << "Hardware counters unavailable (" << perfError << "), continuing without them" << std::endl;
+		}
+	}
+
+	std::vector<Result> results;
+	try {
+		for (auto& corpus : corpora) {
+			corpus.Size = FileSize(corpus.Filepath);
+			results.push_back(Run(corpus, iterations));
+		}
+	}
+	catch (ReaParser::Exception& e) {
+		std::cerr << e.What() << std::endl;
+		return -1;
+	}
+
+	std::ofstream outFile;
+	if (!out.empty())
+		outFile.open(out);
+	std::ostream& os = out.empty() ? std::cout : outFile;
+
+	if (json)
+		PrintJson(os, results, perfError);
+	else
+		PrintText(os, results);
+
+	return 0;
+}
@@ -0,0 +1,54 @@
+// ReaParser C API test
+//
+// Compiled as C, so the header is checked the way bindings see it. Loads the test project
+// through the C API and reads it back. Run from the repository root, exits non-zero if any
+// check fails.
+
+#include "../include/ReaParserC.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			s_failures++; \
+		} \
+	} while (0)
+
+int main(void) {
+	rea_options options;
+	rea_project* project;
+	rea_project_info info;
+	rea_track tracks[16];
+	float lengths[16];
+	size_t count;
+
+	CHECK(rea_abi_version() == REAPARSER_C_ABI_VERSION);
+	rea_options_default(&options);
+	project = rea_project_load("testing/TestProject/TestProject.rpp", &options);
+	CHECK(project != NULL && strcmp(rea_last_error(), "") == 0);
+	if (!project) {
+		fprintf(stderr, "%s\n", rea_last_error());
+		return 1;
+	}
+
+	CHECK(rea_project_info_get(project, &info) == 0 && info.track_count == 8 && info.item_count == 7);
+	count = rea_project_tracks(project, 0, tracks, 16);
+	CHECK(count == 8 && tracks[3].name.size == 8 && memcmp(tracks[3].name.data, "Guitar R", 8) == 0);
+	CHECK(rea_project_item_column(project, REA_ITEM_LENGTH, 0, lengths, 16) == 7 && lengths[0] > 0.0f);
+
+	CHECK(rea_project_info_get(project, NULL) == -1 && strcmp(rea_last_error(), "info is NULL") == 0);
+	CHECK(rea_project_tracks(NULL, 0, tracks, 16) == 0 && strcmp(rea_last_error(), "project is NULL") == 0);
+	rea_project_free(project);
+
+	if (s_failures) {
+		fprintf(stderr, "%d checks failed\n", s_failures);
+		return 1;
+	}
+	printf("All tests passed\n");
+	return 0;
+}
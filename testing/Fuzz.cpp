@@ -0,0 +1,383 @@
+// ReaParser worst-case complexity fuzz harness
+//
+// Looks for inputs that make the parser slow down super-linearly. Every input
+// family below is generated at doubling sizes and loaded with parse statistics
+// enabled, so for each size we get the time and the bytes scanned per input
+// byte. Fitting time against size on a log-log scale gives the growth exponent,
+// which should stay close to 1. Afterwards random mutations of valid projects
+// are loaded with hard limits set, and any input that is much slower per byte
+// than the valid baseline is saved for inspection.
+//
+// Usage: Fuzz [--base-kb N] [--steps N] [--threshold X] [--mutations N]
+//             [--seed N] [--source path.rpp] [--workdir dir] [--crash-dir dir]
+//
+// Built with -fsanitize=fuzzer and REAPARSER_LIBFUZZER defined, it is a
+// libFuzzer target instead.
+
+#define REAPARSER_STATS
+#include "../include/ReaParser.h"
+#include "ProjectGenerator.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <functional>
+
+using Clock = std::chrono::steady_clock;
+
+// Limits the harness applies to mutated input, as an ingest service would
+static ReaParser::ReaOptions HardenedOptions() {
+	ReaParser::ReaOptions options;
+	options.MaxDepth = 64;
+	options.MaxLineLength = 1 << 20;
+	return options;
+}
+
+static bool WriteFile(const std::string& filepath, const std::string& data) {
+	FILE* fp = fopen(filepath.c_str(), "wb");
+	if (!fp)
+		return false;
+	size_t written = fwrite(data.data(), 1, data.size(), fp);
+	return fclose(fp) == 0 && written == data.size();
+}
+
+static std::string ReadFile(const std::string& filepath) {
+	std::ifstream file(filepath, std::ios::binary);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+struct Measurement {
+	double Seconds = 0.0;
+	uint64_t Scanned = 0;
+	bool Rejected = false;
+};
+
+// Best of three loads
+static Measurement Measure(const std::string& filepath, const ReaParser::ReaOptions& options) {
+	Measurement best;
+	best.Seconds = 1e30;
+
+	for (int i = 0; i < 3; i++) {
+		ReaParser::ReaParseStats stats;
+		Clock::time_point start = Clock::now();
+		bool rejected = false;
+
+		try {
+			ReaParser::LoadProjectFile(filepath.c_str(), options, &stats);
+		}
+		catch (ReaParser::Exception&) {
+			rejected = true;
+		}
+
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (seconds < best.Seconds) {
+			best.Seconds = seconds;
+			best.Scanned = stats.BytesScanned;
+			best.Rejected = rejected;
+		}
+	}
+	return best;
+}
+
+// -------------- //
+// Input families //
+// -------------- //
+
+static const std::string ProjectHeader = "<REAPER_PROJECT 0.1 \"6.53/win64\" 1692151186\n  SAMPLERATE 44100 0 0\n";
+
+static std::string Repeat(const std::string& unit, size_t bytes) {
+	std::string out;
+	out.reserve(bytes + unit.size());
+	while (out.size() < bytes)
+		out += unit;
+	return out;
+}
+
+static std::string GeneratedProject(size_t bytes, uint64_t seed) {
+	GeneratorOptions options;
+	options.Seed = seed;
+	options.TargetBytes = bytes;
+	options.Tracks = 0;
+
+	FILE* fp = tmpfile();
+	if (!fp)
+		return std::string();
+
+	std::string data(ProjectGenerator(options).Generate(fp), '\0');
+	rewind(fp);
+	data.resize(fread(&data[0], 1, data.size(), fp));
+	fclose(fp);
+	return data;
+}
+
+// Drops every line that closes a chunk
+static std::string WithoutFooters(const std::string& project) {
+	std::string out;
+	std::istringstream in(project);
+	std::string line;
+
+	while (std::getline(in, line)) {
+		size_t indent = line.find_first_not_of(' ');
+		if (indent != std::string::npos && line[indent] == '>' && indent > 0)
+			continue;
+		out += line + "\n";
+	}
+	return out;
+}
+
+struct Family {
+	const char* Name;
+	std::function<std::string(size_t)> Make;
+};
+
+static std::vector<Family> Families(uint64_t seed) {
+	return {
+		{ "valid", [=](size_t n) { return GeneratedProject(n, seed); } },
+		{ "missing_footers", [=](size_t n) { return WithoutFooters(GeneratedProject(n, seed)); } },
+		{ "deep_nesting", [](size_t n) { return ProjectHeader + Repeat("<A\n", n); } },
+		{ "unbalanced_footers", [](size_t n) { return ProjectHeader + Repeat(">\n", n); } },
+		{ "track_headers", [](size_t n) {
+			return ProjectHeader + Repeat("  <TRACK {871FE1F8-4B10-46D3-B06A-0B38602090DE}\n", n); } },
+		{ "item_headers", [](size_t n) {
+			return ProjectHeader + "  <TRACK {871FE1F8-4B10-46D3-B06A-0B38602090DE}\n" + Repeat("    <ITEM\n", n); } },
+		{ "fx_blob_no_footer", [](size_t n) {
+			return ProjectHeader + "  <TRACK {871FE1F8-4B10-46D3-B06A-0B38602090DE}\n    <FXCHAIN\n"
+				"      <VST \"VST: ReaEQ (Cockos)\" reaeq.dll 0 \"\" 1919247729<56535472656571726561657100000000> \"\"\n" +
+				Repeat("        cWVlcu5e7f4CAAAAAQAAAAAAAAACAAAAAAAAAAIAAAABAAAAAAAAAAIAAAAAAAAArAAAAAEAAAAAABAA\n", n); } },
+		{ "long_line", [](size_t n) {
+			return ProjectHeader + "  <TRACK {871FE1F8-4B10-46D3-B06A-0B38602090DE}\n    NAME \"" +
+				std::string(n, 'x') + "\"\n  >\n>\n"; } },
+		{ "no_newlines", [](size_t n) { return ProjectHeader + Repeat("<ITEM ", n); } }
+	};
+}
+
+// Slope of log(seconds) against log(bytes), by least squares
+static double GrowthExponent(const std::vector<double>& sizes, const std::vector<double>& seconds) {
+	double n = static_cast<double>(sizes.size()), sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (size_t i = 0; i < sizes.size(); i++) {
+		double x = log(sizes[i]), y = log(std::max(seconds[i], 1e-9));
+		sx += x; sy += y; sxx += x * x; sxy += x * y;
+	}
+	double d = n * sxx - sx * sx;
+	return d != 0.0 ? (n * sxy - sx * sy) / d : 0.0;
+}
+
+// Returns the number of families flagged as super-linear
+static int RunScaling(size_t baseBytes, int steps, double threshold, uint64_t seed, const std::string& workdir) {
+	int flagged = 0;
+	std::string filepath = workdir + "/reaparser_fuzz_scaling.rpp";
+	ReaParser::ReaOptions options;
+
+	printf("%-20s %12s %10s %12s %12s %9s\n", "family", "bytes", "ms", "ns/byte", "scanned/byte", "exponent");
+
+	for (auto& family : Families(seed)) {
+		std::vector<double> sizes, seconds;
+		double scannedPerByte = 0.0;
+
+		for (int step = 0; step < steps; step++) {
+			std::string input = family.Make(baseBytes << step);
+			if (!WriteFile(filepath, input)) {
+				std::cerr << "Unable to write " << filepath << std::endl;
+				return -1;
+			}
+
+			Measurement m = Measure(filepath, options);
+			sizes.push_back(static_cast<double>(input.size()));
+			seconds.push_back(m.Seconds);
+			scannedPerByte = static_cast<double>(m.Scanned) / input.size();
+
+			printf("%-20s %12zu %10.2f %12.2f %12.2f %9s%s\n", family.Name, input.size(), m.Seconds * 1e3,
+				m.Seconds * 1e9 / input.size(), scannedPerByte, "", m.Rejected ? " (rejected)" : "");
+		}
+
+		double exponent = GrowthExponent(sizes, seconds);
+		bool superLinear = exponent > threshold;
+		flagged += superLinear;
+
+		printf("%-20s %12s %10s %12s %12s %9.2f%s\n\n", family.Name, "", "", "", "", exponent,
+			superLinear ? "  SUPER-LINEAR" : "");
+	}
+
+	remove(filepath.c_str());
+	return flagged;
+}
+
+// --------- //
+// Mutations //
+// --------- //
+
+class Mutator {
+public:
+	Mutator(uint64_t seed) : m_state(seed) {}
+
+	std::string Mutate(std::string input) {
+		int rounds = 1 + Range(8);
+		for (int i = 0; i < rounds && !input.empty(); i++) {
+			size_t at = Range(input.size());
+			switch (Range(6)) {
+			case 0: // Flip a byte
+				input[at] = static_cast<char>(Next());
+				break;
+			case 1: // Delete a line
+				input.erase(at, input.find('\n', at) - at);
+				break;
+			case 2: { // Duplicate a run of lines
+				size_t end = std::min(input.size(), at + Range(4096));
+				input.insert(at, input.substr(at, end - at));
+				break;
+			}
+			case 3: // Insert a chunk delimiter
+				input.insert(at, Range(2) ? "\n<" : "\n>");
+				break;
+			case 4: { // Drop every newline in a span
+				size_t end = std::min(input.size(), at + Range(8192));
+				for (size_t j = at; j < end; j++) {
+					if (input[j] == '\n')
+						input[j] = ' ';
+				}
+				break;
+			}
+			default: // Truncate
+				input.resize(at);
+				break;
+			}
+		}
+		return input;
+	}
+
+private:
+	uint64_t m_state;
+
+	uint64_t Next() {
+		uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	size_t Range(size_t n) { return n ? static_cast<size_t>(Next() % n) : 0; }
+};
+
+// Returns the number of mutated inputs that were disproportionately slow, or -1 if
+// a seed project can't be read
+static int RunMutations(int count, uint64_t seed, const std::string& source, const std::string& workdir, const std::string& crashDir) {
+	std::vector<std::string> seeds = {
+		ReadFile(source),
+		GeneratedProject(256 * 1024, seed)
+	};
+	std::string filepath = workdir + "/reaparser_fuzz_mutation.rpp";
+	ReaParser::ReaOptions options = HardenedOptions();
+
+	// Baseline cost per byte of valid input
+	double baseline = 0.0;
+	for (auto& input : seeds) {
+		if (input.empty()) {
+			std::cerr << "Unable to read seed project " << source << std::endl;
+			return -1;
+		}
+		WriteFile(filepath, input);
+		baseline = std::max(baseline, Measure(filepath, options).Seconds / input.size());
+	}
+
+	Mutator mutator(seed);
+	int slow = 0, rejected = 0;
+	double worst = 0.0;
+
+	for (int i = 0; i < count; i++) {
+		std::string input = mutator.Mutate(seeds[i % seeds.size()]);
+		WriteFile(filepath, input);
+
+		Measurement m = Measure(filepath, options);
+		double perByte = m.Seconds / std::max<size_t>(input.size(), 1);
+		worst = std::max(worst, perByte / baseline);
+		rejected += m.Rejected;
+
+		// Small inputs are dominated by fixed costs, so only judge those over 4KB
+		if (input.size() > 4096 && perByte > baseline * 10.0) {
+			slow++;
+			std::string saved = crashDir + "/slow_" + std::to_string(i) + ".rpp";
+			WriteFile(saved, input);
+			printf("slow input %d: %zu bytes, %.1fx baseline per byte, saved to %s\n",
+				i, input.size(), perByte / baseline, saved.c_str());
+		}
+	}
+
+	printf("%d mutations: %d rejected by limits, %d slow, worst %.2fx baseline per byte\n",
+		count, rejected, slow, worst);
+
+	remove(filepath.c_str());
+	return slow;
+}
+
+#ifdef REAPARSER_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	const char* tmp = getenv("TMPDIR");
+	static std::string filepath = std::string(tmp ? tmp : "/tmp") + "/reaparser_fuzz_input.rpp";
+	WriteFile(filepath, std::string(reinterpret_cast<const char*>(data), size));
+
+	try {
+		ReaParser::ReaParseStats stats;
+		ReaParser::LoadProjectFile(filepath.c_str(), HardenedOptions(), &stats);
+	}
+	catch (ReaParser::Exception&) {}
+	return 0;
+}
+
+#else
+
+int main(int argc, const char* argv[]) {
+	size_t baseKB = 256;
+	int steps = 4, mutations = 500;
+	double threshold = 1.25;
+	uint64_t seed = 1;
+	std::string source = "testing/TestProject/TestProject.rpp";
+#ifdef _WIN32
+	const char* tmp = getenv("TEMP");
+#else
+	const char* tmp = getenv("TMPDIR");
+	if (!tmp)
+		tmp = "/tmp";
+#endif
+	std::string workdir = tmp ? tmp : ".", crashDir = ".";
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--base-kb" && hasValue)
+			baseKB = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--steps" && hasValue)
+			steps = std::max(2, atoi(argv[++i]));
+		else if (arg == "--threshold" && hasValue)
+			threshold = atof(argv[++i]);
+		else if (arg == "--mutations" && hasValue)
+			mutations = atoi(argv[++i]);
+		else if (arg == "--seed" && hasValue)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--source" && hasValue)
+			source = argv[++i];
+		else if (arg == "--workdir" && hasValue)
+			workdir = argv[++i];
+		else if (arg == "--crash-dir" && hasValue)
+			crashDir = argv[++i];
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			return -1;
+		}
+	}
+
+	int superLinear = RunScaling(baseKB * 1024, steps, threshold, seed, workdir);
+	if (superLinear < 0)
+		return -1;
+	int slow = mutations > 0 ? RunMutations(mutations, seed, source, workdir, crashDir) : 0;
+	if (slow < 0)
+		return -1;
+
+	printf("%d super-linear families, %d slow mutations\n", superLinear, slow);
+	return superLinear || slow ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,64 @@
+// Synthetic Reaper project generator
+//
+// Usage: Generator -o out.rpp [--seed N] [--tracks N] [--size-mb N] [--items N]
+//                  [--takes N] [--fx N] [--fx-bytes N] [--midi-ratio R] [--midi-events N]
+//                  [--envelope-points N] [--folder-depth N]
+
+#include "ProjectGenerator.h"
+
+#include <iostream>
+#include <cstdlib>
+
+int main(int argc, const char* argv[]) {
+	GeneratorOptions options;
+	std::string out;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if ((arg == "-o" || arg == "--out") && hasValue)
+			out = argv[++i];
+		else if (arg == "--seed" && hasValue)
+			options.Seed = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--tracks" && hasValue)
+			options.Tracks = atoi(argv[++i]);
+		else if (arg == "--size-mb" && hasValue)
+			options.TargetBytes = strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		else if (arg == "--items" && hasValue)
+			options.ItemsPerTrack = atoi(argv[++i]);
+		else if (arg == "--takes" && hasValue)
+			options.TakesPerItem = atoi(argv[++i]);
+		else if (arg == "--fx" && hasValue)
+			options.FXPerTrack = atoi(argv[++i]);
+		else if (arg == "--fx-bytes" && hasValue)
+			options.FXBlobBytes = atoi(argv[++i]);
+		else if (arg == "--midi-ratio" && hasValue)
+			options.MidiRatio = static_cast<float>(atof(argv[++i]));
+		else if (arg == "--midi-events" && hasValue)
+			options.MidiEventsPerItem = atoi(argv[++i]);
+		else if (arg == "--envelope-points" && hasValue)
+			options.EnvelopePoints = atoi(argv[++i]);
+		else if (arg == "--folder-depth" && hasValue)
+			options.FolderDepth = atoi(argv[++i]);
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			return -1;
+		}
+	}
+
+	if (out.empty()) {
+		std::cerr << "Usage: Generator -o out.rpp [options]" << std::endl;
+		return -1;
+	}
+
+	ProjectGenerator generator(options);
+	uint64_t written = generator.Generate(out.c_str());
+	if (!written) {
+		std::cerr << "Unable to write " << out << std::endl;
+		return -1;
+	}
+
+	std::cout << out << ": " << written << " bytes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+// Hardware performance counters for the benchmark harness
+//
+// Reads cycles, instructions, branch misses and last level cache misses for the
+// calling thread through perf_event_open on Linux. Counters the CPU, kernel or
+// container doesn't expose are reported as unavailable, and on other platforms
+// all of them are.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+enum class PerfCounter {
+	Cycles = 0, Instructions, BranchMisses, LLCMisses,
+	Count
+};
+
+constexpr int PerfCounterCount = static_cast<int>(PerfCounter::Count);
+
+struct PerfSample {
+	uint64_t Values[PerfCounterCount] = {};
+};
+
+class PerfCounters {
+public:
+	PerfCounters() = default;
+	PerfCounters(const PerfCounters&) = delete;
+	~PerfCounters() { Close(); }
+
+	static const char* Name(int counter) {
+		static const char* names[PerfCounterCount] = {
+			"cycles", "instructions", "branch_misses", "llc_misses"
+		};
+		return names[counter];
+	}
+
+	// Opens every counter it can, returns false if none are available (see Error())
+	bool Open() {
+#ifdef __linux__
+		const struct { uint32_t Type; uint64_t Config; } configs[PerfCounterCount] = {
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+		};
+
+		for (int i = 0; i < PerfCounterCount; i++) {
+			int fd = OpenCounter(configs[i].Type, configs[i].Config);
+
+			// Not every CPU exposes LLC read misses, the generic cache miss event is close enough
+			if (fd < 0 && i == static_cast<int>(PerfCounter::LLCMisses))
+				fd = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+			if (fd < 0) {
+				if (m_error.empty())
+					m_error = std::string(Name(i)) + ": " + strerror(errno);
+				continue;
+			}
+
+			if (m_leader < 0)
+				m_leader = fd;
+			m_slots[i] = m_count++;
+			m_fds[i] = fd;
+		}
+
+		if (m_leader < 0)
+			return false;
+
+		ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		return true;
+#else
+		m_error = "perf_event_open is only available on Linux";
+		return false;
+#endif
+	}
+
+	bool Available(int counter) const { return m_slots[counter] >= 0; }
+	bool AnyAvailable() const { return m_leader >= 0; }
+
+	// Reason the first unavailable counter couldn't be opened
+	const std::string& Error() const { return m_error; }
+
+	// Reads the running totals, scaled up if the kernel had to multiplex the counters
+	bool Read(PerfSample& sample) const {
+#ifdef __linux__
+		if (m_leader < 0)
+			return false;
+
+		// Layout of PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING
+		uint64_t data[3 + PerfCounterCount];
+		if (read(m_leader, data, sizeof(data)) < static_cast<ssize_t>((3 + m_count) * sizeof(uint64_t)))
+			return false;
+
+		double scale = data[2] ? static_cast<double>(data[1]) / data[2] : 1.0;
+		for (int i = 0; i < PerfCounterCount; i++)
+			sample.Values[i] = m_slots[i] >= 0 ? static_cast<uint64_t>(data[3 + m_slots[i]] * scale) : 0;
+		return true;
+#else
+		(void)sample;
+		return false;
+#endif
+	}
+
+private:
+	int m_fds[PerfCounterCount] = { -1, -1, -1, -1 };
+	int m_slots[PerfCounterCount] = { -1, -1, -1, -1 };
+	int m_leader = -1;
+	int m_count = 0;
+	std::string m_error;
+
+#ifdef __linux__
+	int OpenCounter(uint32_t type, uint64_t config) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = m_leader < 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0));
+	}
+#endif
+
+	void Close() {
+#ifdef __linux__
+		for (int i = 0; i < PerfCounterCount; i++) {
+			if (m_fds[i] >= 0)
+				close(m_fds[i]);
+			m_fds[i] = m_slots[i] = -1;
+		}
+#endif
+		m_leader = -1;
+		m_count = 0;
+	}
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+// Synthetic Reaper project generator
+//
+// Emits valid .rpp projects of arbitrary size for benchmarking and scaling tests.
+// Output only depends on the options (including the seed), so a given set of
+// options always reproduces the same file on every platform.
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstdarg>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+struct GeneratorOptions {
+	uint64_t Seed = 1;
+
+	// Number of tracks, ignored when TargetBytes is set
+	unsigned int Tracks = 64;
+
+	// Keep adding tracks until the file reaches this size (0 to disable)
+	uint64_t TargetBytes = 0;
+
+	unsigned int ItemsPerTrack = 8;
+
+	// Takes per audio item, as comped recordings have, one of them active
+	unsigned int TakesPerItem = 1;
+	unsigned int FXPerTrack = 2;
+
+	// Size of each FX's base64 state blob
+	unsigned int FXBlobBytes = 2048;
+
+	// Share of items (0 to 1) that are MIDI, and note events per MIDI item
+	float MidiRatio = 0.25f;
+	unsigned int MidiEventsPerItem = 64;
+
+	// Volume envelope points per track (0 for no envelope)
+	unsigned int EnvelopePoints = 16;
+
+	// Maximum folder nesting (0 for a flat project)
+	unsigned int FolderDepth = 2;
+
+	unsigned int SampleRate = 48000;
+	float BPM = 120.0f;
+};
+
+class ProjectGenerator {
+public:
+	ProjectGenerator(const GeneratorOptions& options) : m_options(options), m_state(options.Seed) {}
+
+	// Writes a project to filepath, returns the number of bytes written or 0 on failure
+	uint64_t Generate(const char* filepath) {
+		FILE* fp = fopen(filepath, "wb");
+		if (!fp)
+			return 0;
+
+		std::vector<char> ioBuffer(1 << 20);
+		setvbuf(fp, ioBuffer.data(), _IOFBF, ioBuffer.size());
+
+		uint64_t written = Generate(fp);
+		if (fclose(fp) != 0)
+			return 0;
+		return written;
+	}
+
+	uint64_t Generate(FILE* fp) {
+		m_fp = fp;
+		m_written = 0;
+		m_depth = 0;
+
+		WriteHeader();
+
+		for (unsigned int i = 0; m_options.TargetBytes || i < m_options.Tracks; i++) {
+			bool last = m_options.TargetBytes
+				? m_written >= m_options.TargetBytes
+				: i + 1 >= m_options.Tracks;
+
+			if (m_options.TargetBytes && last && m_depth == 0)
+				break;
+
+			WriteTrack(i, last);
+
+			if (!m_options.TargetBytes && last)
+				break;
+		}
+
+		Write(">\n");
+		return m_written;
+	}
+
+private:
+	GeneratorOptions m_options;
+	uint64_t m_state;
+	FILE* m_fp = nullptr;
+	uint64_t m_written = 0;
+	unsigned int m_depth = 0;
+
+	// splitmix64, stable across platforms unlike std distributions
+	uint64_t Next() {
+		uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	unsigned int Range(unsigned int n) { return n ? static_cast<unsigned int>(Next() % n) : 0; }
+	double Unit() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+	void Write(const char* str) { Write(str, strlen(str)); }
+	void Write(const char* data, size_t size) { m_written += fwrite(data, 1, size, m_fp); }
+
+	void Printf(const char* format, ...) {
+		char line[1024];
+		va_list args;
+		va_start(args, format);
+		int size = vsnprintf(line, sizeof(line), format, args);
+		va_end(args);
+		if (size > 0)
+			Write(line, std::min<size_t>(size, sizeof(line) - 1));
+	}
+
+	std::string GUID() {
+		uint64_t a = Next(), b = Next();
+		char guid[40];
+		snprintf(guid, sizeof(guid), "{%08X-%04X-%04X-%04X-%012llX}",
+			static_cast<unsigned int>(a >> 32), static_cast<unsigned int>(a >> 16) & 0xFFFF,
+			static_cast<unsigned int>(a) & 0xFFFF, static_cast<unsigned int>(b >> 48),
+			static_cast<unsigned long long>(b & 0xFFFFFFFFFFFFull));
+		return guid;
+	}
+
+	void WriteHeader() {
+		Printf("<REAPER_PROJECT 0.1 \"6.53/win64\" %u\n", 1600000000u + Range(100000000));
+		Write("  <NOTES 0 2\n  >\n");
+		Write("  RIPPLE 0\n  GROUPOVERRIDE 0 0 0\n  AUTOXFADE 1\n  ENVATTACH 3\n  PANLAW 1\n");
+		Write("  PROJOFFS 0 0 0\n  MAXPROJLEN 0 600\n  GRID 3199 8 1 8 1 0 0 0\n  PANMODE 3\n");
+		Write("  RECORD_PATH \"\" \"\"\n  <RECORD_CFG\n    ZXZhdxgAAA==\n  >\n");
+		Printf("  SAMPLERATE %u 0 0\n", m_options.SampleRate);
+		Write("  LOCK 1\n  GLOBAL_AUTO -1\n");
+		Printf("  TEMPO %g 4 4\n", m_options.BPM);
+		Write("  PLAYRATE 1 0 0.25 4\n  MASTERAUTOMODE 0\n  MASTERMUTESOLO 0\n");
+		Write("  MASTER_NCH 2 2\n");
+		Printf("  MASTER_VOLUME %.14g 0 -1 -1 1\n", 0.25 + Unit());
+		Write("  MASTER_PANMODE 3\n  MASTER_FX 1\n  MASTER_SEL 0\n");
+		Printf("  MARKER 1 %.14g \"Marker 1\" 0 0 1 R %s\n", Unit() * 10.0, GUID().c_str());
+		Write("  <PROJBAY\n  >\n");
+	}
+
+	void WriteTrack(unsigned int index, bool last) {
+		std::string guid = GUID();
+
+		// Folder state: 1 opens a folder, 2 closes the given number of levels
+		int busState = 0, busDelta = 0;
+		if (last && m_depth > 0) {
+			busState = 2;
+			busDelta = -static_cast<int>(m_depth);
+		}
+		else if (!last && m_depth < m_options.FolderDepth && Range(4) == 0) {
+			busState = 1;
+			busDelta = 1;
+		}
+		else if (!last && m_depth > 0 && Range(3) == 0) {
+			busState = 2;
+			busDelta = -static_cast<int>(1 + Range(m_depth));
+		}
+		m_depth += busDelta;
+
+		Printf("  <TRACK %s\n", guid.c_str());
+		Printf("    NAME \"Track %u\"\n", index + 1);
+		Write("    PEAKCOL 16576\n    BEAT -1\n    AUTOMODE 0\n");
+		Printf("    VOLPAN %.14g %.14g -1 -1 1\n", 0.1 + Unit() * 1.9, Unit() * 2.0 - 1.0);
+		Printf("    MUTESOLO %u 0 0\n", Range(10) == 0 ? 1u : 0u);
+		Printf("    IPHASE %u\n", Range(20) == 0 ? 1u : 0u);
+		Write("    PLAYOFFS 0 1\n");
+		Printf("    ISBUS %d %d\n", busState, busDelta);
+		Write("    BUSCOMP 0 0 0 0 0\n    SHOWINMIX 1 0.6667 0.5 1 0.5 -1 -1 -1\n    FREEMODE 0\n    SEL 0\n");
+		Write("    REC 0 0 1 0 0 0 0\n    VU 2\n    TRACKHEIGHT 0 0 0 0 -1 0\n    INQ 0 0 0 0.5 100 0 0 100\n");
+		Write("    NCHAN 2\n    FX 1\n");
+		Printf("    TRACKID %s\n", guid.c_str());
+		Write("    PERF 0\n    MIDIOUT -1\n    MAINSEND 1 0\n");
+
+		if (m_options.EnvelopePoints)
+			WriteEnvelope();
+		if (m_options.FXPerTrack)
+			WriteFXChain();
+
+		double position = Unit() * 4.0;
+		for (unsigned int i = 0; i < m_options.ItemsPerTrack; i++) {
+			double length = 0.25 + Unit() * 8.0;
+			WriteItem(position, length);
+			position += length + Unit() * 2.0;
+		}
+
+		Write("  >\n");
+	}
+
+	void WriteEnvelope() {
+		Write("    <VOLENV2\n");
+		Printf("      EGUID %s\n", GUID().c_str());
+		Write("      ACT 1 -1\n      VIS 1 1 1\n      LANEHEIGHT 0 0\n      ARM 0\n      DEFSHAPE 0 -1 -1\n");
+
+		double time = 0.0;
+		for (unsigned int i = 0; i < m_options.EnvelopePoints; i++) {
+			Printf("      PT %.14g %.14g 0\n", time, Unit() * 2.0);
+			time += 0.05 + Unit() * 2.0;
+		}
+		Write("    >\n");
+	}
+
+	void WriteFXChain() {
+		static const char* plugins[][2] = {
+			{ "VST: ReaEQ (Cockos)", "reaeq.dll" },
+			{ "VST: ReaComp (Cockos)", "reacomp.dll" },
+			{ "VST: ReaVerbate (Cockos)", "reaverbate.dll" },
+			{ "VST3: ReaDelay (Cockos)", "readelay.vst3" },
+			{ "VSTi: ReaSynth (Cockos)", "reasynth.dll" }
+		};
+
+		Write("    <FXCHAIN\n      WNDRECT 985 60 716 328\n      SHOW 0\n      LASTSEL 0\n      DOCKED 0\n");
+
+		for (unsigned int i = 0; i < m_options.FXPerTrack; i++) {
+			Write("      BYPASS 0 0 0\n");
+
+			if (Range(8) == 0) {
+				Write("      <JS loopsamplers/autoloop \"\"\n");
+				Write("        0 0 -30 100 60 100 0 1 0 - - - - - - - -\n");
+				Write("      >\n");
+			}
+			else {
+				const char** plugin = plugins[Range(sizeof(plugins) / sizeof(plugins[0]))];
+				Printf("      <VST \"%s\" %s 0 \"\" %u<56535472656571726561657100000000> \"\"\n",
+					plugin[0], plugin[1], 1919247729u + Range(1000));
+				WriteBase64(m_options.FXBlobBytes);
+				Write("      >\n");
+			}
+
+			Write("      FLOATPOS 0 0 0 0\n");
+			Printf("      FXID %s\n", GUID().c_str());
+			Write("      WAK 0 0\n");
+		}
+		Write("    >\n");
+	}
+
+	// Base64 blob in lines of up to 128 characters, as Reaper serializes plugin state
+	void WriteBase64(unsigned int bytes) {
+		static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		char line[160];
+		unsigned int chars = (bytes + 2) / 3 * 4;
+
+		while (chars > 0) {
+			unsigned int n = std::min(chars, 128u);
+			memcpy(line, "        ", 8);
+			for (unsigned int i = 0; i < n; i++)
+				line[8 + i] = alphabet[Next() & 63];
+			if (n == chars && bytes % 3)
+				line[8 + n - 1] = '=';
+			line[8 + n] = '\n';
+			Write(line, 9 + n);
+			chars -= n;
+		}
+	}
+
+	void WriteItem(double position, double length) {
+		bool midi = Unit() < m_options.MidiRatio;
+		unsigned int id = Range(1000000);
+
+		Write("    <ITEM\n");
+		Printf("      POSITION %.14g\n", position);
+		Write("      SNAPOFFS 0\n");
+		Printf("      LENGTH %.14g\n", length);
+		Write("      LOOP 1\n      ALLTAKES 0\n      FADEIN 1 0.01 0 1 0 0 0\n      FADEOUT 1 0.01 0 1 0 0 0\n");
+		Printf("      MUTE %u 0\n", Range(16) == 0 ? 1u : 0u);
+		Write("      SEL 0\n");
+		Printf("      IGUID %s\n", GUID().c_str());
+		Printf("      IID %u\n", id);
+
+		if (midi)
+			Printf("      NAME \"MIDI item %u\"\n", id);
+		else
+			Printf("      NAME take_%u.wav\n", id % 512);
+
+		Printf("      VOLPAN %.14g %.14g 1 -1\n", 0.25 + Unit() * 1.5, Unit() * 2.0 - 1.0);
+		Write("      SOFFS 0\n      PLAYRATE 1 1 0 -1 0 0.0025\n      CHANMODE 0\n");
+		Printf("      GUID %s\n", GUID().c_str());
+
+		if (midi) {
+			Write("      <SOURCE MIDI\n        HASDATA 1 960 QN\n        CCINTERP 32\n");
+			for (unsigned int i = 0; i < m_options.MidiEventsPerItem; i++) {
+				unsigned int note = 36 + Range(48);
+				Printf("        E %u 90 %02x %02x\n", Range(960), note, 1 + Range(127));
+				Printf("        E %u 80 %02x 00\n", 120 + Range(960), note);
+			}
+			Printf("        GUID %s\n", GUID().c_str());
+			Write("        IGNTEMPO 0 120 4 4\n      >\n");
+		}
+		else {
+			Write("      <SOURCE WAVE\n");
+			Printf("        FILE \"Media/take_%u.wav\"\n", id % 512);
+			Write("      >\n");
+
+			// The first take stays active unless a later one is marked SEL
+			unsigned int active = m_options.TakesPerItem > 1 ? Range(m_options.TakesPerItem) : 0;
+			for (unsigned int take = 1; take < m_options.TakesPerItem; take++) {
+				Write(take == active ? "      TAKE SEL\n" : "      TAKE\n");
+				Printf("      NAME take_%u_%u.wav\n", id % 512, take);
+				Printf("      TAKEVOLPAN %.14g %.14g -1\n", Unit() * 2.0 - 1.0, 0.25 + Unit() * 1.5);
+				Write("      SOFFS 0\n      PLAYRATE 1 1 0 -1 0 0.0025\n      CHANMODE 0\n");
+				Printf("      GUID %s\n", GUID().c_str());
+				Write("      <SOURCE WAVE\n");
+				Printf("        FILE \"Media/take_%u_%u.wav\"\n", id % 512, take);
+				Write("      >\n");
+			}
+		}
+
+		Write("    >\n");
+	}
+};
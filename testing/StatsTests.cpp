@@ -0,0 +1,172 @@
+// ReaParser statistics tests
+//
+// Checks the ReaParseStats a REAPARSER_STATS build fills in, over the test project
+// and copies of it with lines added. Run from the repository root, exits non-zero if
+// any check fails. The unit tests link the library built without statistics, so
+// these build on their own with the header-only parser.
+
+#define REAPARSER_STATS
+#define REAPARSER_STATS_ALLOCATOR
+#include "../include/ReaParser.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+static int s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+			s_failures++; \
+		} \
+	} while (0)
+
+static const char* TestProjectPath = "testing/TestProject/TestProject.rpp";
+
+static std::string TempPath(const std::string& name) {
+	const char* tmp = getenv("TMPDIR");
+	return std::string(tmp ? tmp : "/tmp") + "/reaparser_stats_" + name + ".rpp";
+}
+
+static std::string ReadFile(const std::string& filepath) {
+	std::ifstream file(filepath, std::ios::binary);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+static void WriteFile(const std::string& filepath, const std::string& data) {
+	std::ofstream file(filepath, std::ios::binary);
+	file << data;
+}
+
+// Insert lines after the first line containing after
+static void InsertAfter(std::string& text, const std::string& after, const std::vector<std::string>& lines) {
+	size_t at = text.find('\n', text.find(after)) + 1;
+	for (const std::string& line : lines) {
+		text.insert(at, line + "\r\n");
+		at += line.size() + 2;
+	}
+}
+
+static ReaParser::ReaParseStats LoadStats(const std::string& filepath) {
+	ReaParser::ReaParseStats stats;
+	ReaParser::LoadProjectFile(filepath.c_str(), ReaParser::ReaOptions(), &stats);
+	return stats;
+}
+
+static ReaParser::ReaParseStats LoadStatsOf(const std::string& name, const std::string& text) {
+	std::string filepath = TempPath(name);
+	WriteFile(filepath, text);
+	ReaParser::ReaParseStats stats = LoadStats(filepath);
+	remove(filepath.c_str());
+	return stats;
+}
+
+// Phase times add up to no more than the load, of which reads are a part
+static void TestPhaseTimes() {
+	ReaParser::ReaParseStats stats = LoadStats(TestProjectPath);
+
+	double phases = 0.0;
+	for (double seconds : stats.PhaseSeconds) {
+		CHECK(seconds >= 0.0);
+		phases += seconds;
+	}
+	CHECK(phases > 0.0);
+	CHECK(stats.TotalSeconds > 0.0 && phases <= stats.TotalSeconds);
+	CHECK(stats.ReadSeconds > 0.0 && stats.ReadSeconds <= stats.TotalSeconds);
+}
+
+// Every pass reads the whole file, so the scanned totals are the same multiple of its size
+static void TestScanned() {
+	std::string text = ReadFile(TestProjectPath);
+	uint64_t bytes = text.size();
+	uint64_t lines = std::count(text.begin(), text.end(), '\n');
+	ReaParser::ReaParseStats stats = LoadStats(TestProjectPath);
+
+	CHECK(stats.BytesScanned >= bytes && stats.BytesScanned % bytes == 0);
+	CHECK(stats.LinesScanned >= lines && stats.LinesScanned % lines == 0);
+	CHECK(stats.BytesScanned / bytes == stats.LinesScanned / lines);
+}
+
+// Each chunk is counted once, however many passes read it
+static void TestChunks() {
+	std::map<std::string, uint64_t> expected;
+	std::istringstream in(ReadFile(TestProjectPath));
+	std::string line;
+	while (std::getline(in, line)) {
+		size_t at = line.find_first_not_of(" \t");
+		if (at != std::string::npos && line[at] == '<')
+			expected[line.substr(at + 1, line.find_first_of(" \t\r", at) - at - 1)]++;
+	}
+
+	ReaParser::ReaParseStats stats = LoadStats(TestProjectPath);
+	CHECK(stats.Chunks == expected);
+	CHECK(stats.Chunks["TRACK"] == 7 && stats.Chunks["ITEM"] == 7 && stats.Chunks["FXCHAIN"] == 2);
+}
+
+// A field no handler knows is unknown, lines within chunks the loader doesn't descend
+// into and lines between tracks are skipped
+static void TestUnknownAndSkipped() {
+	std::string text = ReadFile(TestProjectPath);
+	ReaParser::ReaParseStats base = LoadStats(TestProjectPath);
+	CHECK(base.UnknownLines > 0 && base.SkippedLines > 0);
+
+	std::string unknown = text;
+	InsertAfter(unknown, "  <TRACK {871FE1F8", { "    MYSTERY 1 2" });
+	ReaParser::ReaParseStats stats = LoadStatsOf("unknown", unknown);
+	CHECK(stats.UnknownLines == base.UnknownLines + 1 && stats.SkippedLines == base.SkippedLines);
+
+	std::string nested = text;
+	InsertAfter(nested, "  <TRACK {871FE1F8", { "    <EXT", "      a 1", "      b 2", "    >" });
+	stats = LoadStatsOf("nested", nested);
+	CHECK(stats.UnknownLines == base.UnknownLines + 1 && stats.SkippedLines == base.SkippedLines + 3);
+	CHECK(stats.Chunks["EXT"] == 1);
+
+	std::string stray = text;
+	stray.insert(stray.find("  <TRACK"), "  STRAY 1\r\n");
+	stats = LoadStatsOf("stray", stray);
+	CHECK(stats.UnknownLines == base.UnknownLines && stats.SkippedLines == base.SkippedLines + 1);
+}
+
+// The load's allocations are part of the thread's running totals
+static void TestAllocations() {
+	ReaParser::ReaAllocCounters before = ReaParser::ReaAllocCounters::Current();
+	ReaParser::ReaParseStats stats = LoadStats(TestProjectPath);
+	const ReaParser::ReaAllocCounters& after = ReaParser::ReaAllocCounters::Current();
+
+	CHECK(stats.Allocations > 0 && stats.AllocatedBytes >= stats.Allocations);
+	CHECK(stats.Allocations <= after.Count - before.Count);
+	CHECK(stats.AllocatedBytes <= after.Bytes - before.Bytes);
+}
+
+// Loading again starts from fresh statistics, and loading without any is left alone
+static void TestReload() {
+	ReaParser::ReaParseStats stats = LoadStats(TestProjectPath);
+	uint64_t lines = stats.LinesScanned;
+	ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions(), &stats);
+	CHECK(stats.LinesScanned == lines && stats.Chunks["TRACK"] == 7);
+
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	CHECK(project.IsValid() && project.Tracks.size() == 8);
+}
+
+int main() {
+	TestPhaseTimes();
+	TestScanned();
+	TestChunks();
+	TestUnknownAndSkipped();
+	TestAllocations();
+	TestReload();
+
+	if (s_failures) {
+		std::cerr << s_failures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All tests passed" << std::endl;
+	return 0;
+}
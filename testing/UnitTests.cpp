@@ -0,0 +1,1662 @@
+// ReaParser unit tests
+//
+// Plain assertions over the test project and small hand-written projects, run
+// from the repository root. Exits non-zero if any check fails.
+
+#include "../include/ReaParser.h"
+#include "../include/ReaMedia.h"
+#include "../include/ReaRender.h"
+#include "../include/ReaPeaks.h"
+#include "../include/ReaTimeline.h"
+#include "../include/ReaCorpus.h"
+#include "../include/ReaJson.h"
+#include "../include/ReaArrow.h"
+#include "../include/ReaSnapshot.h"
+#include "../include/ReaParserC.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <cstdlib>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MakeDirectory(path) _mkdir(path)
+#define RemoveEmptyDirectory(path) _rmdir(path)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define MakeDirectory(path) mkdir(path, 0755)
+#define RemoveEmptyDirectory(path) rmdir(path)
+#endif
+
+static int s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+			s_failures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, epsilon) CHECK(fabs((a) - (b)) <= (epsilon))
+
+static const char* TestProjectPath = "testing/TestProject/TestProject.rpp";
+
+static std::string TempPath(const std::string& name) {
+	const char* tmp = getenv("TMPDIR");
+	return std::string(tmp ? tmp : "/tmp") + "/reaparser_test_" + name + ".rpp";
+}
+
+static std::string ReadFile(const std::string& filepath) {
+	std::ifstream file(filepath, std::ios::binary);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+static void WriteFile(const std::string& filepath, const std::string& data) {
+	std::ofstream file(filepath, std::ios::binary);
+	file << data;
+}
+
+// Copy of project without the lines for which drop returns true
+static std::string Filter(const std::string& project, std::function<bool(const std::string&)> drop) {
+	std::istringstream in(project);
+	std::string line, out;
+	while (std::getline(in, line)) {
+		if (!drop(line))
+			out += line + "\n";
+	}
+	return out;
+}
+
+static void Put(std::string& out, uint32_t value, int bytes, bool bigEndian = false) {
+	for (int i = 0; i < bytes; i++)
+		out += static_cast<char>(value >> (8 * (bigEndian ? bytes - 1 - i : i)));
+}
+
+// 16-bit PCM WAV of frames frames, repeating the samples in frame or silent
+static std::string MakeWAV(unsigned int sampleRate, unsigned int channels, uint32_t frames,
+	const std::vector<int16_t>& frame = {}) {
+	std::string wav = "RIFF";
+	Put(wav, 36 + frames * channels * 2, 4);
+	wav += "WAVEfmt ";
+	Put(wav, 16, 4);
+	Put(wav, 1, 2);
+	Put(wav, channels, 2);
+	Put(wav, sampleRate, 4);
+	Put(wav, sampleRate * channels * 2, 4);
+	Put(wav, channels * 2, 2);
+	Put(wav, 16, 2);
+	wav += "data";
+	Put(wav, frames * channels * 2, 4);
+	if (frame.empty())
+		return wav + std::string(frames * channels * 2, '\0');
+	for (uint32_t i = 0; i < frames; i++) {
+		for (unsigned int channel = 0; channel < channels; channel++)
+			Put(wav, static_cast<uint16_t>(frame[channel]), 2);
+	}
+	return wav;
+}
+
+// 24-bit AIFF at 44.1 kHz, with an empty sample data chunk
+static std::string MakeAIFF(unsigned int channels, uint32_t frames) {
+	std::string aiff = "FORM";
+	Put(aiff, 4 + 26 + 16, 4, true);
+	aiff += "AIFFCOMM";
+	Put(aiff, 18, 4, true);
+	Put(aiff, channels, 2, true);
+	Put(aiff, frames, 4, true);
+	Put(aiff, 24, 2, true);
+	aiff += std::string("\x40\x0e\xac\x44\0\0\0\0\0\0", 10); // 44100 as an 80-bit float
+	aiff += "SSND";
+	Put(aiff, 8, 4, true);
+	return aiff + std::string(8, '\0');
+}
+
+// Project with one track holding an item per source, as written in FILE lines
+static std::string MakeProject(const std::string& recordPath, const std::vector<std::string>& sources) {
+	std::string project = "<REAPER_PROJECT 0.1 \"6.53/win64\" 1692151186\n  RECORD_PATH " + recordPath + "\n"
+		"  <TRACK {871FE1F8-4B10-46D3-B06A-0B38602090DE}\n    NAME Track\n";
+	for (auto& source : sources)
+		project += "    <ITEM\n      POSITION 0\n      LENGTH 1\n      <SOURCE WAVE\n        FILE " + source + "\n      >\n    >\n";
+	return project + "  >\n>\n";
+}
+
+static bool Throws(const std::string& filepath, const ReaParser::ReaOptions& options) {
+	try {
+		ReaParser::LoadProjectFile(filepath.c_str(), options);
+	}
+	catch (ReaParser::BadFile&) {
+		return true;
+	}
+	return false;
+}
+
+static bool ThrowsException(std::function<void()> function) {
+	try {
+		function();
+	}
+	catch (ReaParser::Exception&) {
+		return true;
+	}
+	return false;
+}
+
+// ----- //
+// Tests //
+// ----- //
+
+static void TestLoadProject() {
+	ReaParser::ReaOptions options;
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, options);
+
+	CHECK(project.IsValid());
+	CHECK(project.Name == "TestProject");
+	CHECK(project.Version.Platform == ReaParser::ReaVersion::ReaPlatform::Windows);
+	CHECK(project.Version.Major == 6 && project.Version.Minor == 53);
+	CHECK(project.SampleRate == 44100);
+	CHECK_NEAR(project.Tempo.BPM, 99.0f, 1e-4f);
+
+	CHECK(project.Tracks.size() == 8);
+	if (project.Tracks.size() != 8)
+		return;
+
+	CHECK(project.Tracks[0].Name == "MASTER");
+	CHECK_NEAR(project.Tracks[0].Volume, -2.55654f, 1e-3f);
+	CHECK_NEAR(project.Tracks[0].Pan, -0.504f, 1e-4f);
+
+	const ReaParser::ReaTrack& guitarR = project.Tracks[3];
+	CHECK(guitarR.Name == "Guitar R");
+	CHECK(guitarR.GUID == "6BC04FCC-6754-4442-82B9-2F50CF4A1BD1");
+	CHECK(guitarR.MediaItems.size() == 5);
+	if (!guitarR.MediaItems.empty()) {
+		CHECK(guitarR.MediaItems[0].Filepath == "guitar.mp3");
+		CHECK(guitarR.MediaItems[0].Type == ReaParser::ReaMediaType::Sample);
+		CHECK_NEAR(guitarR.MediaItems[0].End, 0.966531f, 1e-5f);
+	}
+
+	const ReaParser::ReaTrack& guitarL = project.Tracks[4];
+	CHECK(guitarL.MediaItems.size() == 1);
+	CHECK(guitarL.FXChain.size() == 3);
+	if (guitarL.FXChain.size() == 3) {
+		CHECK(guitarL.FXChain[0].Name == "ReaEQ (Cockos)");
+		CHECK(guitarL.FXChain[2].Type == ReaParser::ReaFXType::JS);
+	}
+
+	CHECK(project.Tracks[5].Muted);
+	CHECK(project.Tracks[7].Name == "Child Track");
+}
+
+static void TestOptions() {
+	ReaParser::ReaOptions options;
+	options.ConvertVolumeToDB = false;
+	options.NormalizePan = false;
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, options);
+
+	CHECK(!project.Tracks.empty());
+	if (project.Tracks.empty())
+		return;
+	CHECK_NEAR(project.Tracks[0].Volume, powf(10.0f, -2.55654f / 20.0f), 1e-4f);
+	CHECK_NEAR(project.Tracks[0].Pan, -50.4f, 1e-3f);
+}
+
+// The runtime options dispatch to the matching compile-time policies
+static void TestPolicies() {
+	ReaParser::ReaOptions options;
+	options.ConvertVolumeToDB = false;
+	options.NormalizePan = false;
+	ReaParser::ReaProject runtime = ReaParser::LoadProjectFile(TestProjectPath, options);
+	ReaParser::ReaProject policy = ReaParser::LoadProjectFile<ReaParser::ReaVolumeAmplitude, ReaParser::ReaPanPercent>(
+		TestProjectPath, ReaParser::ReaOptions());
+
+	CHECK(runtime.Tracks.size() == policy.Tracks.size());
+	for (size_t i = 0; i < std::min(runtime.Tracks.size(), policy.Tracks.size()); i++) {
+		CHECK(runtime.Tracks[i].Volume == policy.Tracks[i].Volume);
+		CHECK(runtime.Tracks[i].Pan == policy.Tracks[i].Pan);
+		for (size_t j = 0; j < std::min(runtime.Tracks[i].MediaItems.size(), policy.Tracks[i].MediaItems.size()); j++)
+			CHECK(runtime.Tracks[i].MediaItems[j].Volume == policy.Tracks[i].MediaItems[j].Volume);
+	}
+
+	ReaParser::ReaProject db = ReaParser::LoadProjectFile<ReaParser::ReaVolumeDB, ReaParser::ReaPanNormalized>(
+		TestProjectPath, ReaParser::ReaOptions());
+	CHECK(!db.Tracks.empty() && !runtime.Tracks.empty());
+	if (!db.Tracks.empty() && !runtime.Tracks.empty()) {
+		CHECK_NEAR(db.Tracks[0].Volume, ReaParser::Util::ToDecibel(runtime.Tracks[0].Volume), 1e-4f);
+		CHECK_NEAR(db.Tracks[0].Pan * 100.0f, runtime.Tracks[0].Pan, 1e-4f);
+	}
+}
+
+static void TestDecibels() {
+	// Gains from -200 dB to +80 dB, plus the special values
+	std::vector<float> amplitudes;
+	for (float x = 1e-10f; x < 1e4f; x *= 1.001f)
+		amplitudes.push_back(x);
+	size_t normal = amplitudes.size();
+	amplitudes.push_back(0.0f);
+	amplitudes.push_back(-1.0f);
+	amplitudes.push_back(1e-40f);
+	amplitudes.push_back(INFINITY);
+
+	std::vector<float> approx = amplitudes, exact = amplitudes;
+	ReaParser::Util::ToDecibel(approx.data(), approx.size());
+	ReaParser::Util::ToDecibel(exact.data(), exact.size(), true);
+
+	double worst = 0.0;
+	for (size_t i = 0; i < normal; i++) {
+		worst = std::max(worst, fabs(approx[i] - 20.0 * log10(static_cast<double>(amplitudes[i]))));
+		CHECK(exact[i] == ReaParser::Util::ToDecibel(amplitudes[i]));
+	}
+	CHECK(worst < 1e-4);
+
+	CHECK(std::isinf(approx[normal]) && approx[normal] < 0);
+	CHECK(std::isnan(approx[normal + 1]));
+	CHECK(approx[normal + 2] == ReaParser::Util::ToDecibel(1e-40f));
+	CHECK(std::isinf(approx[normal + 3]) && approx[normal + 3] > 0);
+
+	ReaParser::ReaOptions options;
+	options.ExactDecibels = true;
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, options);
+	options.ConvertVolumeToDB = false;
+	ReaParser::ReaProject raw = ReaParser::LoadProjectFile(TestProjectPath, options);
+	for (size_t i = 0; i < std::min(project.Tracks.size(), raw.Tracks.size()); i++)
+		CHECK(project.Tracks[i].Volume == ReaParser::Util::ToDecibel(raw.Tracks[i].Volume));
+}
+
+// Serialized values are kept whatever the options, and converted on access
+static void TestRawValues() {
+	ReaParser::ReaOptions options;
+	options.ConvertVolumeToDB = true;
+	options.NormalizePan = false;
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, options);
+
+	CHECK(project.Tracks.size() == 8);
+	if (project.Tracks.size() != 8)
+		return;
+
+	const ReaParser::ReaTrack& master = project.Tracks[0];
+	CHECK_NEAR(master.RawVolume, powf(10.0f, -2.55654f / 20.0f), 1e-5f);
+	CHECK(master.RawPan == -0.504f);
+	CHECK(master.VolumeAmplitude() == master.RawVolume);
+	CHECK(master.VolumeDB() == ReaParser::Util::ToDecibel(master.RawVolume));
+	CHECK_NEAR(master.Volume, master.VolumeDB(), 1e-4f);
+	CHECK(master.PanPercent() == master.Pan);
+	CHECK(master.PanNormalized() == master.RawPan);
+
+	std::vector<float> volumes = ReaParser::Util::VolumesDB(project.Tracks, true);
+	std::vector<float> pans = ReaParser::Util::PansNormalized(project.Tracks);
+	CHECK(volumes.size() == project.Tracks.size() && pans.size() == project.Tracks.size());
+	for (size_t i = 0; i < std::min(volumes.size(), project.Tracks.size()); i++) {
+		CHECK(volumes[i] == project.Tracks[i].VolumeDB());
+		CHECK(pans[i] == project.Tracks[i].RawPan);
+	}
+
+	const ReaParser::ReaMediaItems& items = project.Tracks[3].MediaItems;
+	std::vector<float> amplitudes = ReaParser::Util::VolumesAmplitude(items);
+	std::vector<float> percent = ReaParser::Util::PansPercent(items);
+	CHECK(amplitudes.size() == items.size() && percent.size() == items.size());
+	for (size_t i = 0; i < std::min(amplitudes.size(), items.size()); i++) {
+		CHECK(amplitudes[i] == items[i].RawVolume);
+		CHECK(percent[i] == items[i].Pan);
+	}
+}
+
+// Every take of an item is kept, the item showing the one marked SEL
+static void TestTakes() {
+	std::string text = ReadFile(TestProjectPath);
+	size_t source = text.find("FILE \"guitar.mp3\" 1");
+	size_t end = text.find('\n', text.find('>', source)) + 1;
+	std::string newline = text[end - 2] == '\r' ? "\r\n" : "\n";
+	const char* takes[] = {
+		"      TAKE", "      NAME alt.wav", "      TAKEVOLPAN 0.5 0.25 -1", "      SOFFS 1.5",
+		"      <SOURCE WAVE", "        FILE \"alt.wav\"", "      >",
+		"      TAKE SEL", "      NAME comp.wav", "      TAKEVOLPAN -0.25 2 -1", "      SOFFS 2",
+		"      <SOURCE WAVE", "        FILE \"comp.wav\"", "      >"
+	};
+	for (const char* line : takes) {
+		text.insert(end, line + newline);
+		end += strlen(line) + newline.size();
+	}
+	std::string filepath = TempPath("takes");
+	WriteFile(filepath, text);
+
+	ReaParser::ReaProject expected = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(filepath.c_str(), ReaParser::ReaOptions());
+	CHECK(project.Takes.size() == expected.Takes.size() + 2 && project.Tracks.size() == expected.Tracks.size());
+
+	const ReaParser::ReaMediaItem& item = project.Tracks[3].MediaItems[0];
+	CHECK(item.TakeCount == 3 && item.ActiveTake == 2);
+	CHECK(item.Name == "comp.wav" && item.Filepath == "comp.wav" && item.StartOffset == 2.0f);
+	if (item.TakeCount == 3) {
+		const ReaParser::ReaTake* take = &project.Takes[item.FirstTake];
+		CHECK(take[0].Name == "guitar.mp3" && take[0].RawVolume == 1.0f && take[0].StartOffset == 0.0f);
+		CHECK(take[1].Filepath == "alt.wav" && take[1].RawPan == 0.5f && take[1].RawVolume == 0.25f);
+		CHECK(take[2].Type == ReaParser::ReaMediaType::Sample && take[2].RawVolume == 2.0f);
+	}
+
+	// Items after it still refer to their own takes
+	for (size_t t = 0; t < project.Tracks.size(); t++) {
+		for (size_t i = 0; i < project.Tracks[t].MediaItems.size(); i++) {
+			const ReaParser::ReaMediaItem& other = project.Tracks[t].MediaItems[i];
+			CHECK(other.Name == (t == 3 && i == 0 ? "comp.wav" : expected.Tracks[t].MediaItems[i].Name));
+			CHECK(other.TakeCount == 0 || project.Takes[other.FirstTake + other.ActiveTake].Name == other.Name);
+		}
+	}
+
+	// Only the active take kept
+	ReaParser::ReaOptions options;
+	options.ActiveTakesOnly = true;
+	project = ReaParser::LoadProjectFile(filepath.c_str(), options);
+	remove(filepath.c_str());
+	CHECK(project.Takes.size() == expected.Takes.size());
+	const ReaParser::ReaMediaItem& active = project.Tracks[3].MediaItems[0];
+	CHECK(active.TakeCount == 1 && active.ActiveTake == 0 && active.Name == "comp.wav");
+	CHECK(project.Takes[active.FirstTake].RawPan == -0.25f);
+}
+
+struct FieldTarget {
+	float Rate = 0.0f;
+	int Depth = 0;
+	unsigned int Channels = 0;
+	bool Selected = false;
+	std::string Name;
+};
+
+static void TestFieldTable() {
+	static const ReaParser::ReaFieldTable<FieldTarget> fields = {
+		{ "ISBUS", 1, &FieldTarget::Depth },
+		{ "NAME", 0, &FieldTarget::Name },
+		{ "PLAYRATE", 0, &FieldTarget::Rate },
+		{ "NCHAN", 0, &FieldTarget::Channels },
+		{ "SEL", 0, &FieldTarget::Selected },
+	};
+	FieldTarget target;
+	CHECK(fields.Read("ISBUS 1 -1\r\n", target) == 1 && target.Depth == -1);
+	CHECK(fields.Read("NAME \"Drum Bus\" 1\n", target) == 1 && target.Name == "Drum Bus");
+	CHECK(fields.Read("PLAYRATE 0.5 1 0 -1 0 0.0025\n", target) == 1 && target.Rate == 0.5f);
+	CHECK(fields.Read("NCHAN 8", target) == 1 && target.Channels == 8);
+	CHECK(fields.Read("SEL 1\n", target) == 1 && target.Selected);
+
+	// Other keywords, including ones starting like a field's, and unreadable values store nothing
+	CHECK(fields.Read("SELECTED 0\n", target) == 0 && target.Selected);
+	CHECK(fields.Read("NCHANS 2\n", target) == 0 && fields.Read("NCHAN x\n", target) == 0 && target.Channels == 8);
+	CHECK(fields.Read("ISBUS 0\n", target) == 0 && fields.Read("\n", target) == 0 && target.Depth == -1);
+
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	CHECK(project.Tracks[1].Channels == 8 && project.Tracks[3].Channels == 2);
+	CHECK(project.Tracks[2].Selected && !project.Tracks[1].Selected);
+	const ReaParser::ReaMediaItem& item = project.Tracks[3].MediaItems[0];
+	CHECK(item.FadeIn == 0.01f && item.PlayRate == 1.0f && !item.Selected);
+}
+
+// Inserts lines before the first occurrence of before
+static void InsertLines(std::string& text, const std::string& before, const std::vector<std::string>& lines) {
+	size_t at = text.find(before);
+	for (const std::string& line : lines) {
+		text.insert(at, line + "\r\n");
+		at += line.size() + 2;
+	}
+}
+
+static void TestHandlers() {
+	std::string text = ReadFile(TestProjectPath);
+	InsertLines(text, "  <TRACK {871FE1F8", { "  <EXT", "    proj 1", "  >" });
+	InsertLines(text, "    <ITEM", {
+		"    <EXT", "      studio_tag \"drums\" 1", "      <NESTED", "        x", "      >", "    >",
+		"    <VOLENV2", "      ACT 1", "      <EXT", "        env 2", "      >", "    >"
+	});
+	InsertLines(text, "      IID 4", { "      <EXT", "        item 3", "      >" });
+	std::string filepath = TempPath("handlers");
+	WriteFile(filepath, text);
+
+	std::string chunks;
+	int nchan = 0, tagged = 0;
+	std::shared_ptr<ReaParser::ReaHandlers> handlers = std::make_shared<ReaParser::ReaHandlers>();
+	handlers->OnChunk("EXT", [&](const ReaParser::ReaLine& line) {
+		chunks += std::string(line.Text, strcspn(line.Text, "\r\n"));
+		chunks += line.Item ? " (item)|" : line.Track ? " (" + line.Track->Name + ")|" : "|";
+	}).OnLine("NCHAN", [&](const ReaParser::ReaLine& line) {
+		CHECK(line.Track && line.Track->Name.size() && line.Depth == 2);
+		nchan++;
+	}).OnLine("studio_tag", [&](const ReaParser::ReaLine&) {
+		tagged++;
+	});
+
+	ReaParser::ReaOptions options;
+	options.Handlers = handlers;
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(filepath.c_str(), options);
+	remove(filepath.c_str());
+	CHECK(chunks == "<EXT|proj 1|>|"
+		"<EXT (Drum Bus)|studio_tag \"drums\" 1 (Drum Bus)|<NESTED (Drum Bus)|x (Drum Bus)|> (Drum Bus)|> (Drum Bus)|"
+		"<EXT (Drum Bus)|env 2 (Drum Bus)|> (Drum Bus)|"
+		"<EXT (item)|item 3 (item)|> (item)|");
+	CHECK(nchan == 7 && tagged == 0);
+
+	// The chunks don't change what's loaded
+	ReaParser::ReaProject expected = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	CHECK(project.Tracks.size() == expected.Tracks.size() && project.Tracks[1].MediaItems.size() == 1);
+	CHECK(project.Tracks[1].Channels == 8 && project.Tracks[1].MediaItems[0].Length == expected.Tracks[1].MediaItems[0].Length);
+
+	// A handler's exception leaves LoadProjectFile, and is each file's error on a pool
+	std::shared_ptr<ReaParser::ReaHandlers> throwing = std::make_shared<ReaParser::ReaHandlers>();
+	throwing->OnLine("NCHAN", [](const ReaParser::ReaLine&) { throw std::runtime_error("no channels"); });
+	options.Handlers = throwing;
+	bool thrown = false;
+	try {
+		ReaParser::LoadProjectFile(TestProjectPath, options);
+	}
+	catch (std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+
+	std::vector<std::string> errors;
+	std::vector<ReaParser::ReaProject> projects =
+		ReaParser::LoadProjectFiles(std::vector<std::string>(4, TestProjectPath), options, 2, &errors);
+	CHECK(projects.size() == 4 && errors == std::vector<std::string>(4, "no channels"));
+	CHECK(std::none_of(projects.begin(), projects.end(), [](const ReaParser::ReaProject& p) { return p.IsValid(); }));
+}
+
+static void TestSnapshot() {
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	ReaParser::ReaSnapshot snapshot(project);
+	CHECK(snapshot.Project().IsValid() && snapshot.Project().Tracks.empty() && snapshot.TrackCount() == project.Tracks.size());
+
+	// Back to the project it was made from
+	ReaParser::ReaProject copy = snapshot.ToProject();
+	CHECK(copy.IsValid() && copy.Name == project.Name && copy.Takes.size() == project.Takes.size());
+	for (size_t t = 0; t < project.Tracks.size(); t++) {
+		const ReaParser::ReaTrack& track = project.Tracks[t];
+		CHECK(copy.Tracks[t].GUID == track.GUID && copy.Tracks[t].FXChain.size() == track.FXChain.size());
+		CHECK(copy.Tracks[t].MediaItems.size() == track.MediaItems.size());
+		for (size_t i = 0; i < track.MediaItems.size() && i < copy.Tracks[t].MediaItems.size(); i++) {
+			const ReaParser::ReaMediaItem& item = copy.Tracks[t].MediaItems[i];
+			CHECK(item.Name == track.MediaItems[i].Name && item.TakeCount == track.MediaItems[i].TakeCount);
+			CHECK(!item.TakeCount || copy.Takes[item.FirstTake].Name == project.Takes[track.MediaItems[i].FirstTake].Name);
+		}
+	}
+
+	// An edit shares everything it leaves alone, and the original is unchanged
+	ReaParser::ReaSnapshot edited = snapshot.EditItem(3, 1, [](ReaParser::ReaMediaItem& item, ReaParser::ReaTakes& takes) {
+		item.Start = 100.0f;
+		takes[0].Name = "edited.mp3";
+	});
+	CHECK(edited.Track(3).Item(1).Item.Start == 100.0f && edited.Track(3).Item(1).Takes[0].Name == "edited.mp3");
+	CHECK(snapshot.Track(3).Item(1).Item.Start != 100.0f && snapshot.Track(3).Item(1).Takes[0].Name == "guitar.mp3");
+	CHECK(&edited.Track(3).Item(0) == &snapshot.Track(3).Item(0) && &edited.Track(3).Item(2) == &snapshot.Track(3).Item(2));
+	CHECK(&edited.Track(1) == &snapshot.Track(1) && &edited.Project() == &snapshot.Project());
+	CHECK(&edited.Track(3) != &snapshot.Track(3));
+
+	ReaParser::ReaFX fx;
+	fx.Name = "ReaEQ";
+	edited = edited.InsertFX(2, 0, fx).RemoveItem(3, 0).EditTrack(1, [](ReaParser::ReaTrack& track) { track.Name = "Drums"; });
+	CHECK(edited.Track(2).FXCount() == snapshot.Track(2).FXCount() + 1 && edited.Track(2).FX(0).Name == "ReaEQ");
+	CHECK(edited.Track(3).ItemCount() == snapshot.Track(3).ItemCount() - 1 && edited.Track(3).Item(0).Item.Start == 100.0f);
+	CHECK(edited.Track(1).Track().Name == "Drums" && snapshot.Track(1).Track().Name == "Drum Bus");
+	CHECK(&edited.Track(1).Item(0) == &snapshot.Track(1).Item(0));
+
+	bool thrown = false;
+	try {
+		snapshot.RemoveFX(0, 100);
+	}
+	catch (ReaParser::Exception&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+static void TestHistory() {
+	// Persistent vectors against std::vector, across the sizes that deepen the trie
+	std::vector<int> values;
+	ReaParser::ReaPersistentVector<int> vector;
+	std::vector<ReaParser::ReaPersistentVector<int>> versions;
+	for (int i = 0; i < 1100; i++) {
+		versions.push_back(vector);
+		vector = vector.PushBack(i);
+		values.push_back(i);
+	}
+	CHECK(vector.size() == 1100 && vector[1099] == 1099 && versions[32].size() == 32 && versions[32][31] == 31);
+	CHECK(ReaParser::ReaPersistentVector<int>(values)[1056] == 1056);
+
+	ReaParser::ReaPersistentVector<int> edited = vector.Set(1024, -1).Insert(5, -2).Erase(0);
+	values[1024] = -1;
+	values.insert(values.begin() + 5, -2);
+	values.erase(values.begin());
+	bool same = edited.size() == values.size();
+	for (size_t i = 0; same && i < values.size(); i++)
+		same = edited[i] == values[i];
+	CHECK(same && vector[1024] == 1024 && vector[5] == 5);
+
+	// Insert and Erase anywhere, on either side of the trie's leaf and branch boundaries. The
+	// full leaves before the position are shared, only what follows it is pushed again.
+	for (size_t size : { 1, 31, 32, 33, 1024, 1025, 1100 }) {
+		std::vector<int> model(values.begin(), values.begin() + std::min(size, values.size()));
+		ReaParser::ReaPersistentVector<int> base(model);
+		for (size_t at : { size_t(0), size_t(1), size_t(31), size_t(32), size_t(33), size_t(1023), size_t(1024), size - 1, size }) {
+			if (at > size)
+				continue;
+			std::vector<int> inserted(model);
+			inserted.insert(inserted.begin() + at, -3);
+			ReaParser::ReaPersistentVector<int> insert = base.Insert(at, -3);
+			same = insert.size() == inserted.size();
+			for (size_t i = 0; same && i < inserted.size(); i++)
+				same = insert[i] == inserted[i];
+			CHECK(same);
+
+			size_t shared = at / 32 * 32;
+			for (size_t i = 0; i < shared; i++)
+				same = same && &insert[i] == &base[i];
+			CHECK(same);
+
+			if (at == size)
+				continue;
+			std::vector<int> erased(model);
+			erased.erase(erased.begin() + at);
+			ReaParser::ReaPersistentVector<int> erase = base.Erase(at);
+			same = erase.size() == erased.size();
+			for (size_t i = 0; same && i < erased.size(); i++)
+				same = erase[i] == erased[i] && (i >= shared || &erase[i] == &base[i]);
+			CHECK(same);
+		}
+		CHECK(base.size() == model.size() && base[size - 1] == model[size - 1]);
+	}
+
+	for (int i = 0; i < 1100; i++)
+		vector = vector.PopBack();
+	CHECK(vector.empty() && versions[1000].size() == 1000 && versions[1000][999] == 999);
+
+	// Undo and redo move between snapshots
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	ReaParser::ReaHistory history(ReaParser::ReaSnapshot(std::move(project)));
+	float start = history.Current().Track(3).Item(0).Item.Start;
+	size_t tracks = history.Current().TrackCount();
+	for (int i = 1; i <= 1000; i++) {
+		history.Apply([](const ReaParser::ReaSnapshot& snapshot) {
+			return snapshot.EditItem(3, 0, [](ReaParser::ReaMediaItem& item, ReaParser::ReaTakes&) { item.Start += 1.0f; });
+		});
+	}
+	CHECK(history.UndoSteps() == 1000 && history.Current().Track(3).Item(0).Item.Start == start + 1000.0f);
+	CHECK(history.Undo() && history.Undo() && history.Current().Track(3).Item(0).Item.Start == start + 998.0f);
+	CHECK(history.Redo() && history.RedoSteps() == 1);
+
+	// A new step drops what could be redone
+	history.Commit(history.Current().RemoveTrack(1));
+	CHECK(!history.Redo() && history.Current().TrackCount() == tracks - 1);
+	while (history.Undo()) {}
+	CHECK(history.Current().TrackCount() == tracks && history.Current().Track(3).Item(0).Item.Start == start);
+
+	ReaParser::ReaHistory limited(history.Current(), 10);
+	for (int i = 0; i < 20; i++)
+		limited.Commit(limited.Current().EditProject([](ReaParser::ReaProject& p) { p.SampleRate++; }));
+	CHECK(limited.UndoSteps() == 10 && limited.Current().Project().SampleRate == history.Current().Project().SampleRate + 20);
+}
+
+static void TestMediaProbe() {
+	std::string wavPath = TempPath("probe_wav"), aiffPath = TempPath("probe_aiff");
+	WriteFile(wavPath, MakeWAV(48000, 2, 24000));
+	WriteFile(aiffPath, MakeAIFF(1, 88200));
+
+	ReaParser::ReaMediaInfo wav = ReaParser::ProbeMediaFile(wavPath);
+	CHECK(wav.IsValid() && wav.Format == ReaParser::ReaMediaFormat::WAV);
+	CHECK(wav.SampleRate == 48000 && wav.Channels == 2 && wav.BitsPerSample == 16);
+	CHECK(wav.Frames == 24000 && wav.DataOffset == 44);
+	CHECK_NEAR(wav.Duration, 0.5, 1e-9);
+
+	ReaParser::ReaMediaInfo aiff = ReaParser::ProbeMediaFile(aiffPath);
+	CHECK(aiff.IsValid() && aiff.Format == ReaParser::ReaMediaFormat::AIFF);
+	CHECK(aiff.SampleRate == 44100 && aiff.Channels == 1 && aiff.BitsPerSample == 24);
+	CHECK_NEAR(aiff.Duration, 2.0, 1e-9);
+
+	// An SSND offset past the end of its chunk
+	std::string corruptPath = TempPath("probe_aiff_ssnd"), corrupt = MakeAIFF(1, 88200);
+	corrupt.replace(corrupt.size() - 8, 4, std::string("\0\0\0\x09", 4));
+	WriteFile(corruptPath, corrupt);
+	ReaParser::ReaMediaInfo malformed = ReaParser::ProbeMediaFile(corruptPath);
+	CHECK(!malformed.IsValid() && malformed.Error == "Malformed AIFF file" && malformed.DataSize == 0);
+	remove(corruptPath.c_str());
+
+	// 20 VBR frames of 1152 samples, counted by its Xing header
+	ReaParser::ReaMediaInfo mp3 = ReaParser::ProbeMediaFile("testing/TestProject/guitar.mp3");
+	CHECK(mp3.IsValid() && mp3.Format == ReaParser::ReaMediaFormat::MP3);
+	CHECK(mp3.SampleRate == 44100 && mp3.Channels == 1 && mp3.Frames == 20 * 1152);
+
+	CHECK(!ReaParser::ProbeMediaFile(TestProjectPath).IsValid());
+	CHECK(!ReaParser::ProbeMediaFile(TempPath("does_not_exist")).IsValid());
+
+	// A lone MPEG 1 layer III frame header (128 kbps, 44.1 kHz, 417 bytes) only counts as a
+	// file of one frame when the file ends with the frame, and never near the end of the
+	// probed 64 KB of a longer file
+	std::string mp3Path = TempPath("probe_mp3");
+	std::string header("\xff\xfb\x90\x64", 4);
+	WriteFile(mp3Path, header + std::string(413, '\0'));
+	CHECK(ReaParser::ProbeMediaFile(mp3Path).Format == ReaParser::ReaMediaFormat::MP3);
+	WriteFile(mp3Path, header + std::string(415, '\0'));
+	CHECK(!ReaParser::ProbeMediaFile(mp3Path).IsValid());
+	WriteFile(mp3Path, std::string(64 * 1024 - 200, '\0') + header + std::string(100 * 1024, '\0'));
+	CHECK(!ReaParser::ProbeMediaFile(mp3Path).IsValid());
+	remove(mp3Path.c_str());
+
+	// Repeated paths are probed once, and a saved cache answers without probing
+	std::vector<std::string> paths = { wavPath, aiffPath, wavPath, wavPath };
+	ReaParser::ReaMediaCache cache;
+	std::vector<ReaParser::ReaMediaInfo> infos = ReaParser::ProbeMediaFiles(paths, &cache, 2);
+	CHECK(infos.size() == 4 && cache.Size() == 2 && cache.Misses() == 2);
+	CHECK(infos.size() == 4 && infos[3].Frames == 24000 && infos[1].Format == ReaParser::ReaMediaFormat::AIFF);
+
+	std::string cachePath = TempPath("probe_cache");
+	CHECK(cache.Save(cachePath));
+	ReaParser::ReaMediaCache loaded;
+	CHECK(loaded.Load(cachePath));
+	infos = ReaParser::ProbeMediaFiles(paths, &loaded);
+	CHECK(loaded.Hits() == 2 && loaded.Misses() == 0);
+	CHECK(infos.size() == 4 && infos[0].Frames == 24000 && infos[0].DataOffset == 44);
+	CHECK(infos.size() == 4 && infos[1].SampleRate == 44100 && infos[1].Duration == aiff.Duration);
+
+	// A changed file misses the cache
+	WriteFile(wavPath, MakeWAV(48000, 2, 48000));
+	infos = ReaParser::ProbeMediaFiles(paths, &loaded);
+	CHECK(loaded.Misses() == 1 && infos.size() == 4 && infos[2].Frames == 48000);
+
+	remove(wavPath.c_str());
+	remove(aiffPath.c_str());
+	remove(cachePath.c_str());
+
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	std::map<std::string, ReaParser::ReaMediaInfo> media = ReaParser::ProbeProjectMedia(project);
+	CHECK(media.size() == 1 && media["guitar.mp3"].IsValid());
+}
+
+static void TestPathResolver() {
+	typedef ReaParser::ReaPathResolver Resolver;
+	CHECK(Resolver::Normalize("Audio\\Take 1\\..\\kick.wav") == "Audio/kick.wav");
+	CHECK(Resolver::Normalize("./a//b/./c.wav") == "a/b/c.wav");
+	CHECK(Resolver::Normalize("../media/x.wav") == "../media/x.wav");
+	CHECK(Resolver::Normalize("/../x.wav") == "/x.wav");
+	CHECK(Resolver::Normalize("C:\\Users\\me\\x.wav") == "C:/Users/me/x.wav");
+	CHECK(Resolver::Normalize("\\\\server\\share\\x.wav") == "//server/share/x.wav");
+	CHECK(Resolver::Normalize("a/..") == ".");
+	CHECK(Resolver::IsAbsolute("C:\\x.wav") && Resolver::IsAbsolute("/x.wav") && !Resolver::IsAbsolute("x.wav"));
+
+	// project/Session.rpp, project/Audio/{take.wav, Kick.wav, moved.wav}, library/loop.wav
+	std::string root = TempPath("resolver");
+	root.resize(root.size() - 4);
+	std::string projectDirectory = root + "/project", audio = projectDirectory + "/Audio", library = root + "/library";
+	for (auto& directory : { root, projectDirectory, audio, library })
+		MakeDirectory(directory.c_str());
+
+	std::string wav = MakeWAV(44100, 1, 100);
+	WriteFile(audio + "/take.wav", wav);
+	WriteFile(audio + "/Kick.wav", wav);
+	WriteFile(audio + "/moved.wav", wav);
+	WriteFile(library + "/loop.wav", wav);
+
+	std::string projectPath = projectDirectory + "/Session.rpp";
+	WriteFile(projectPath, MakeProject("Audio \"\"", {
+		"take.wav",                                 // In the record path
+		"\"Audio\\take.wav\"",                      // Relative with backslashes
+		"loop.wav",                                 // In a search path
+		"\"C:\\Users\\me\\Session\\moved.wav\"",     // Absolute on another machine
+		"kick.wav",                                 // Only differs in case
+		"missing.wav"
+	}));
+
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(projectPath.c_str(), ReaParser::ReaOptions());
+	CHECK(project.RecordPath == "Audio" && project.SecondaryRecordPath.empty());
+
+	Resolver resolver;
+	resolver.SearchPaths.push_back(library);
+	std::map<std::string, std::string> resolved = resolver.ResolveProject(project);
+	CHECK(resolved.size() == 6);
+	CHECK(resolved["take.wav"] == audio + "/take.wav");
+	CHECK(resolved["Audio\\take.wav"] == audio + "/take.wav");
+	CHECK(resolved["loop.wav"] == library + "/loop.wav");
+	CHECK(resolved["C:\\Users\\me\\Session\\moved.wav"] == audio + "/moved.wav");
+	CHECK(resolved["kick.wav"].empty());
+	CHECK(resolved.count("missing.wav") && resolved["missing.wav"].empty());
+
+	// Each directory is listed once however many sources it's searched for: the project's,
+	// Audio, library and the missing C:/Users/me/Session
+	CHECK(resolver.Listings() == 4);
+
+	resolver.IgnoreCase = true;
+	CHECK(resolver.ResolveProject(project)["kick.wav"] == audio + "/Kick.wav");
+
+	std::map<std::string, ReaParser::ReaMediaInfo> media = ReaParser::ProbeProjectMedia(project, nullptr, 0, &resolver);
+	CHECK(media.size() == 6 && media["loop.wav"].IsValid() && media["kick.wav"].Frames == 100);
+	CHECK(!media["missing.wav"].IsValid());
+
+	for (auto& file : { audio + "/take.wav", audio + "/Kick.wav", audio + "/moved.wav", library + "/loop.wav", projectPath })
+		remove(file.c_str());
+	for (auto& directory : { audio, library, projectDirectory, root })
+		RemoveEmptyDirectory(directory.c_str());
+}
+
+// Folder track at half volume holding a mono item panned right and a muted track,
+// then a track at double volume playing the second half of a stereo source
+static void TestRender() {
+	std::string mono = TempPath("render_mono"), stereo = TempPath("render_stereo"), other = TempPath("render_rate");
+	std::string projectPath = TempPath("render"), output = TempPath("render_out");
+	WriteFile(mono, MakeWAV(1000, 1, 1000, { 16384 }));
+	WriteFile(stereo, MakeWAV(1000, 2, 1000, { 8192, -8192 }));
+	WriteFile(other, MakeWAV(44100, 1, 100, { 16384 }));
+
+	auto item = [](const std::string& position, const std::string& offset, const std::string& lines, const std::string& file) {
+		return "    <ITEM\n      POSITION " + position + "\n      LENGTH 1\n      SOFFS " + offset + "\n" + lines +
+			"      <SOURCE WAVE\n        FILE \"" + file + "\"\n      >\n    >\n";
+	};
+	WriteFile(projectPath, "<REAPER_PROJECT 0.1 \"6.53/win64\" 1692151186\n  SAMPLERATE 1000 0 0\n"
+		"  MASTER_VOLUME 0.5 0 -1 -1 1\n"
+		"  <TRACK {A}\n    NAME Folder\n    VOLPAN 0.5 0 -1 -1 1\n    ISBUS 1 1\n  >\n"
+		"  <TRACK {B}\n    NAME Child\n    VOLPAN 1 0.5 -1 -1 1\n    ISBUS 0 0\n" +
+		item("0", "0.25", "      LENGTH 0.5\n", mono) + "  >\n"
+		"  <TRACK {C}\n    NAME Muted\n    MUTESOLO 1 0 0\n    ISBUS 2 -1\n" + item("0", "0", "", mono) + "  >\n"
+		"  <TRACK {D}\n    NAME Loud\n    VOLPAN 2 0 -1 -1 1\n" + item("0.25", "0.5", "", stereo) +
+		item("0", "0", "      MUTE 1 0\n", mono) + item("0", "0", "", other) + "  >\n>\n");
+
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(projectPath.c_str(), ReaParser::ReaOptions());
+	CHECK(project.Tracks.size() == 5 && project.Tracks[1].FolderDepth == 1 && project.Tracks[3].FolderDepth == -1);
+
+	ReaParser::ReaRenderOptions options;
+	options.BitsPerSample = 32;
+	options.BlockFrames = 100;
+	options.Threads = 2;
+	ReaParser::ReaRenderResult result = ReaParser::RenderProject(project, output, options);
+	CHECK(result.Frames == 1250 && result.SampleRate == 1000);
+	CHECK(result.RenderedItems == 3 && result.SkippedItems == 1 && result.Warnings.size() == 1);
+	CHECK_NEAR(result.Peak, 0.3125f, 1e-6f);
+
+	ReaParser::ReaMediaInfo info = ReaParser::ProbeMediaFile(output);
+	CHECK(info.Format == ReaParser::ReaMediaFormat::WAV && info.Float && info.Channels == 2 && info.Frames == 1250);
+
+	std::string data = ReadFile(output);
+	auto sample = [&](size_t frame, int channel) {
+		float value = 0.0f;
+		if (info.DataOffset + (frame * 2 + channel + 1) * 4 <= data.size())
+			memcpy(&value, &data[info.DataOffset + (frame * 2 + channel) * 4], 4);
+		return value;
+	};
+	CHECK_NEAR(sample(100, 0), 0.0625f, 1e-6f);  // 0.5 (source) * 0.5 (pan) * 0.5 (folder) * 0.5 (master)
+	CHECK_NEAR(sample(100, 1), 0.125f, 1e-6f);
+	CHECK_NEAR(sample(300, 0), 0.3125f, 1e-6f);  // Plus 0.25 * 2 * 0.5 from the stereo item
+	CHECK_NEAR(sample(300, 1), -0.125f, 1e-6f);
+	CHECK_NEAR(sample(740, 0), 0.25f, 1e-6f);    // The stereo source runs out 500 frames in
+	CHECK(sample(760, 0) == 0.0f && sample(1249, 1) == 0.0f);
+
+	// Integer output and a range
+	options.BitsPerSample = 16;
+	options.Start = 0.5;
+	options.End = 1.0;
+	result = ReaParser::RenderProject(project, output, options);
+	info = ReaParser::ProbeMediaFile(output);
+	CHECK(result.Frames == 500 && info.Frames == 500 && info.BitsPerSample == 16 && !info.Float);
+	data = ReadFile(output);
+	int16_t first = 0;
+	if (data.size() >= info.DataOffset + 2)
+		memcpy(&first, &data[info.DataOffset], 2);
+	CHECK(first == 8192);  // 0.25 from the stereo item
+
+	for (auto& file : { mono, stereo, other, projectPath, output })
+		remove(file.c_str());
+
+	// Tracks[0] is the master everything is summed into, a project without one isn't rendered
+	CHECK(ThrowsException([&]() { ReaParser::RenderProject(ReaParser::ReaProject(), output, options); }));
+	CHECK(ReadFile(output).empty());
+}
+
+static void TestPeaks() {
+	// Stereo ramp, the left channel rising by 16 each frame and the right falling
+	std::string wav = MakeWAV(1000, 2, 1000), wavPath = TempPath("peaks_source");
+	for (uint32_t i = 0; i < 1000; i++) {
+		std::string frame;
+		Put(frame, static_cast<uint16_t>(i * 16), 2);
+		Put(frame, static_cast<uint16_t>(-static_cast<int>(i * 16)), 2);
+		wav.replace(44 + i * 4, 4, frame);
+	}
+	WriteFile(wavPath, wav);
+
+	ReaParser::ReaPeakOptions options;
+	options.SamplesPerPeak = 100;
+	options.Factor = 2;
+	options.BlockFrames = 300;
+	ReaParser::ReaPeaks peaks = ReaParser::BuildPeaks(wavPath, options);
+	CHECK(peaks.IsValid() && !peaks.Mapped() && peaks.Channels() == 2 && peaks.Frames() == 1000);
+	CHECK(peaks.Levels() == 5 && peaks.Level(0).Count == 10 && peaks.Level(2).SamplesPerPeak == 400 && peaks.Level(4).Count == 1);
+	if (peaks.Levels() != 5)
+		return;
+
+	const float* peak = peaks.Level(0).Data + 3 * 4;
+	CHECK(peak[0] == 300 * 16 / 32768.0f && peak[1] == 399 * 16 / 32768.0f);
+	CHECK(peak[2] == -399 * 16 / 32768.0f && peak[3] == -300 * 16 / 32768.0f);
+	CHECK(peaks.Level(4).Data[1] == 999 * 16 / 32768.0f && peaks.Level(4).Data[2] == -999 * 16 / 32768.0f);
+
+	std::vector<float> columns = peaks.Query(0, 1000, 10);
+	CHECK(columns.size() == 40 && std::equal(peak, peak + 4, &columns[3 * 4]));
+	CHECK(peaks.Query(0, 1000, 1)[1] == peaks.Level(4).Data[1]);
+
+	// Cached peaks are mapped back until the source changes
+	std::string directory = TempPath("peaks");
+	directory.resize(directory.size() - 4);
+	MakeDirectory(directory.c_str());
+	ReaParser::ReaPeakCache cache(directory);
+	CHECK(cache.Get(wavPath, options).IsValid() && cache.Misses() == 1);
+
+	ReaParser::ReaPeaks cached = cache.Get(wavPath, options);
+	CHECK(cache.Hits() == 1 && cached.Mapped() && cached.Source() == wavPath && cached.Levels() == 5);
+	CHECK(cached.IsValid() && memcmp(cached.Level(0).Data, peaks.Level(0).Data, 10 * 4 * sizeof(float)) == 0);
+
+	options.Factor = 4;
+	CHECK(cache.Get(wavPath, options).Levels() == 3 && cache.Misses() == 2);
+	WriteFile(wavPath, MakeWAV(1000, 1, 50));
+	CHECK(cache.Get(wavPath, options).Channels() == 1 && cache.Misses() == 3);
+
+	WriteFile(cache.PeakPath(wavPath), "REAPEAKS truncated");
+	CHECK(!ReaParser::ReaPeaks::Open(cache.PeakPath(wavPath)).IsValid());
+
+	std::string projectPath = TempPath("peaks_project");
+	WriteFile(projectPath, MakeProject("\"\"", { "\"" + wavPath + "\"", "missing.wav" }));
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(projectPath.c_str(), ReaParser::ReaOptions());
+	std::map<std::string, ReaParser::ReaPeaks> sources = ReaParser::BuildProjectPeaks(project, &cache, options);
+	CHECK(sources.size() == 2 && sources[wavPath].IsValid() && cache.Misses() == 4);
+	CHECK(!sources["missing.wav"].IsValid() && !sources["missing.wav"].Error().empty());
+
+	for (auto& file : { wavPath, projectPath, cache.PeakPath(wavPath) })
+		remove(file.c_str());
+	RemoveEmptyDirectory(directory.c_str());
+}
+
+static void TestTimeline() {
+	auto items = [](const std::vector<std::pair<float, float>>& spans) {
+		ReaParser::ReaTrack track;
+		for (auto& span : spans) {
+			ReaParser::ReaMediaItem item;
+			item.Start = span.first;
+			item.End = span.second;
+			item.Length = span.second - span.first;
+			track.MediaItems.push_back(item);
+		}
+		return track;
+	};
+
+	// Listed out of order: B overlaps A and contains C, E starts where D ends
+	ReaParser::ReaProject project;
+	project.Tracks.push_back(items({ { 10, 11 }, { 1, 3 }, { 0, 2 }, { 5, 6 }, { 2.5f, 2.75f }, { 6, 7 } }));
+	project.Tracks.back().Name = "Dialogue";
+	project.Tracks.push_back(items({ { 0, 1 }, { 4, 5 } }));
+
+	ReaParser::ReaTimelineOptions options;
+	options.GapTracks = [](const ReaParser::ReaTrack& track) { return track.Name == "Dialogue"; };
+	std::vector<ReaParser::ReaTimelineIssue> issues = ReaParser::CheckTimeline(project, options);
+	CHECK(issues.size() == 4);
+	if (issues.size() == 4) {
+		typedef ReaParser::ReaTimelineIssueType Type;
+		CHECK(issues[0].Type == Type::Overlap && issues[0].First == 2 && issues[0].Second == 1 && issues[0].Start == 1 && issues[0].End == 2);
+		CHECK(issues[1].Type == Type::Overlap && issues[1].First == 1 && issues[1].Second == 4 && issues[1].End == 2.75);
+		CHECK(issues[2].Type == Type::Gap && issues[2].First == 1 && issues[2].Second == 3 && issues[2].Start == 3 && issues[2].End == 5);
+		CHECK(issues[3].Type == Type::Gap && issues[3].First == 5 && issues[3].Second == 0 && issues[3].End - issues[3].Start == 3);
+	}
+
+	options.MinGap = 2.5;
+	options.MinOverlap = 0.5;
+	issues = ReaParser::CheckTimeline(project, options);
+	CHECK(issues.size() == 2 && issues[0].Second == 1 && issues[1].First == 5);
+
+	// Enough items for the radix sort, against every pair compared directly
+	std::vector<std::pair<float, float>> spans;
+	srand(7);
+	for (int i = 0; i < 500; i++) {
+		float start = static_cast<float>(rand() % 20000) / 8;
+		spans.emplace_back(start, start + static_cast<float>(rand() % 40) / 8);
+	}
+	size_t expected = 0;
+	for (size_t i = 0; i < spans.size(); i++) {
+		for (size_t j = i + 1; j < spans.size(); j++)
+			expected += std::min(spans[i].second, spans[j].second) > std::max(spans[i].first, spans[j].first);
+	}
+	std::vector<ReaParser::ReaProject> projects(2, project);
+	projects[1].Tracks.assign(1, items(spans));
+	options = ReaParser::ReaTimelineOptions();
+	options.Gaps = false;
+	options.Threads = 2;
+	std::vector<std::vector<ReaParser::ReaTimelineIssue>> found = ReaParser::CheckTimelines(projects, options);
+	CHECK(found.size() == 2 && found[0].size() == 2 && found[1].size() == expected);
+}
+
+static void TestCorpusStats() {
+	// Halves sketched apart and merged match one sketch of everything
+	ReaParser::ReaQuantileSketch all, low, high;
+	for (int i = 1; i <= 10000; i++) {
+		all.Add(i);
+		(i <= 5000 ? low : high).Add(i);
+	}
+	low.Merge(high);
+	CHECK(low.Count() == 10000 && low.Min() == 1 && low.Max() == 10000 && low.Sum() == all.Sum());
+	for (double q : { 0.0, 0.01, 0.5, 0.99, 1.0 }) {
+		double exact = 1 + q * 9999;
+		CHECK(fabs(all.Quantile(q) - exact) <= exact * 0.01 + 1e-9);
+		CHECK(low.Quantile(q) == all.Quantile(q));
+	}
+	CHECK(all.Buckets() < 500);
+
+	ReaParser::ReaQuantileSketch mixed;
+	for (double value : { -100.0, -1.0, 0.0, 0.0, 2.0 })
+		mixed.Add(value);
+	CHECK(mixed.Quantile(0) == -100 && mixed.Quantile(0.5) == 0 && fabs(mixed.Quantile(0.25) + 1) <= 0.01);
+
+	ReaParser::ReaHistogram histogram = ReaParser::ReaHistogram::Linear(0, 10, 5);
+	for (double value : { -1.0, 0.0, 1.9, 2.0, 10.0 })
+		histogram.Add(value);
+	CHECK(histogram.Counts() == std::vector<uint64_t>({ 1, 2, 1, 0, 0, 0, 1 }) && histogram.Total() == 5);
+	CHECK(ThrowsException([&]() { histogram.Merge(ReaParser::ReaHistogram::Linear(0, 10, 4)); }));
+
+	ReaParser::ReaProject expected = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	size_t plugins = 0;
+	for (auto& track : expected.Tracks)
+		plugins += track.FXChain.size();
+
+	std::vector<std::string> filepaths = { TestProjectPath, TempPath("does_not_exist"), TestProjectPath };
+	ReaParser::ReaCorpusStats stats = ReaParser::CollectCorpusStats(filepaths, ReaParser::ReaOptions(), 2);
+	CHECK(stats.Projects == 2 && stats.Failures == 1 && stats.Tracks == 2 * expected.Tracks.size());
+	CHECK(stats.Plugins == 2 * plugins && stats.PluginNames.Total() == 2 * plugins && stats.PluginTypes.Total() == 2 * plugins);
+	CHECK(stats.SampleRates.Count(std::to_string(expected.SampleRate)) == 2);
+	CHECK(stats.TracksPerProject.Quantile(0.5) == expected.Tracks.size() && stats.ItemLengths.Count() == stats.Items);
+	CHECK(stats.ItemLengthHistogram.Total() == stats.Items && stats.Items > 0);
+	if (stats.PluginNames.Size() > 0)
+		CHECK(stats.PluginNames.Top(1)[0].second >= 2);
+
+	// Loads that throw anything at all are failures too
+	ReaParser::ReaOptions throwing;
+	throwing.Handlers = std::make_shared<ReaParser::ReaHandlers>();
+	std::const_pointer_cast<ReaParser::ReaHandlers>(throwing.Handlers)->OnLine("NCHAN", [](const ReaParser::ReaLine&) { throw 1; });
+	ReaParser::ReaCorpusStats failed = ReaParser::CollectCorpusStats(filepaths, throwing, 2);
+	CHECK(failed.Projects == 0 && failed.Failures == 3);
+
+	// Saved summaries load back, merging into what's already there
+	std::string filepath = TempPath("corpus");
+	CHECK(stats.Save(filepath));
+	ReaParser::ReaCorpusStats loaded;
+	CHECK(loaded.Load(filepath) && loaded.Projects == 2 && loaded.Failures == 1);
+	CHECK(loaded.PluginNames.Counts() == stats.PluginNames.Counts() && loaded.Versions.Counts() == stats.Versions.Counts());
+	CHECK(loaded.ItemLengths.Quantile(0.9) == stats.ItemLengths.Quantile(0.9) && loaded.ProjectLengths.Max() == stats.ProjectLengths.Max());
+	CHECK(loaded.ItemLengthHistogram.Counts() == stats.ItemLengthHistogram.Counts());
+	CHECK(loaded.Load(filepath) && loaded.Projects == 4 && loaded.TracksPerProject.Count() == 4);
+
+	WriteFile(filepath, "totals\t1\tx\n");
+	CHECK(!loaded.Load(filepath) && loaded.Projects == 4);
+	remove(filepath.c_str());
+}
+
+static void TestJson() {
+	std::string out;
+	{
+		ReaParser::ReaJsonWriter writer(out, 64);
+		writer.BeginArray();
+		for (float value : { 0.0f, 0.1f, -2.5f, 120.0f, 1e-7f, 16777216.0f })
+			writer.Number(value);
+		writer.Number(std::nanf(""));
+		writer.Integer(-42);
+		writer.String(std::string("a\"b\\c\n\x01 long enough to cross the sixteen byte runs \t"));
+		writer.BeginObject();
+		writer.Key("empty");
+		writer.BeginArray();
+		writer.EndArray();
+		writer.Key("yes");
+		writer.Bool(true);
+		writer.EndObject();
+		writer.EndArray();
+	}
+	CHECK(out == "[0,0.1,-2.5,120,1e-07,16777216,null,-42,"
+		"\"a\\\"b\\\\c\\n\\u0001 long enough to cross the sixteen byte runs \\t\",{\"empty\":[],\"yes\":true}]");
+
+	// Outside plain notation too, the fewest digits that read back as the same float
+	for (float value : { 1e-7f, -3.3e-9f, 1e-45f, 4e15f, 2.5e20f, FLT_MAX, 123456789e9f }) {
+		std::string text;
+		{
+			ReaParser::ReaJsonWriter writer(text, 64);
+			writer.Number(value);
+		}
+		char longest[32];
+		CHECK(strtof(text.c_str(), nullptr) == value);
+		CHECK(text.size() <= static_cast<size_t>(snprintf(longest, sizeof(longest), "%.9g", value)));
+		if (text.find('e') != std::string::npos && text.find('.') != std::string::npos) {
+			std::string shorter = text;
+			shorter.erase(shorter.find('e') - 1, 1);
+			if (shorter[shorter.find('e') - 1] == '.')
+				shorter.erase(shorter.find('e') - 1, 1);
+			CHECK(strtof(shorter.c_str(), nullptr) != value);
+		}
+	}
+
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	std::string json = ReaParser::ProjectToJson(project);
+	CHECK(json.compare(0, 9, "{\"name\":\"") == 0 && json.back() == '}');
+	CHECK(json.find("\"sampleRate\":" + std::to_string(project.SampleRate)) != std::string::npos);
+	CHECK(json.find("\"" + project.Tracks[1].Name + "\"") != std::string::npos);
+
+	// Written to a file in blocks smaller than the project, without FX state
+	ReaParser::ReaJsonOptions options;
+	options.BufferSize = 256;
+	std::string filepath = TempPath("json");
+	ReaParser::ExportProjectJson(project, filepath, options);
+	CHECK(ReadFile(filepath) == json);
+
+	options.FXData = false;
+	ReaParser::ExportProjectJson(project, filepath, options);
+	std::string lean = ReadFile(filepath);
+	CHECK(lean.size() < json.size() && lean.find("\"data\":") == std::string::npos);
+	remove(filepath.c_str());
+}
+
+static void TestNdjson() {
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	size_t items = 0, fx = 0;
+	for (auto& track : project.Tracks) {
+		items += track.MediaItems.size();
+		fx += track.FXChain.size();
+	}
+
+	std::string directory = TempPath("ndjson");
+	directory.resize(directory.size() - 4);
+	MakeDirectory(directory.c_str());
+
+	ReaParser::ReaNdjsonOptions options;
+	options.Directory = directory;
+	options.MaxShardBytes = 2048;
+	options.Threads = 2;
+	options.Json.BufferSize = 512;
+	std::vector<std::string> filepaths = { TestProjectPath, TempPath("does_not_exist"), TestProjectPath, TestProjectPath };
+	ReaParser::ReaNdjsonResult result = ReaParser::ExportNdjson(filepaths, options);
+	CHECK(result.Projects == 3 && result.Errors.size() == 1 && result.Errors[0].find(filepaths[1]) == 0);
+	CHECK(result.Records == 3 * (project.Tracks.size() + items + fx));
+	CHECK(result.Shards.size() > 2);
+
+	// Every line a whole record, shards only going past the limit by their last one
+	uint64_t records = 0, bytes = 0, tracks = 0;
+	for (auto& shard : result.Shards) {
+		std::string data = ReadFile(shard);
+		bytes += data.size();
+		std::istringstream lines(data);
+		std::string line, last;
+		while (std::getline(lines, line)) {
+			records++;
+			tracks += line.compare(0, 16, "{\"kind\":\"track\",") == 0;
+			CHECK(line.front() == '{' && line.back() == '}');
+			last = line;
+		}
+		CHECK(data.back() == '\n' && data.size() - last.size() - 1 < options.MaxShardBytes);
+		remove(shard.c_str());
+	}
+	CHECK(records == result.Records && bytes == result.Bytes && tracks == 3 * project.Tracks.size());
+	RemoveEmptyDirectory(directory.c_str());
+}
+
+// Reads the flatbuffers of an Arrow file. A table starts with the signed offset back to its
+// vtable, which after its own and the table's size holds each field's offset in the table.
+struct FlatReader {
+	const std::string& Data;
+	size_t Base;
+
+	template <class T>
+	T Get(size_t at) const {
+		T value;
+		memcpy(&value, &Data[Base + at], sizeof(T));
+		return value;
+	}
+
+	// Where the value of field is in table, 0 if it isn't set
+	size_t Field(size_t table, int field) const {
+		size_t vtable = table - Get<int32_t>(table);
+		if (4 + 2 * static_cast<size_t>(field) >= Get<uint16_t>(vtable))
+			return 0;
+		uint16_t offset = Get<uint16_t>(vtable + 4 + 2 * field);
+		return offset ? table + offset : 0;
+	}
+
+	// What the offset stored at at points to: a table, a vector's length or a string's
+	size_t Follow(size_t at) const { return at + Get<uint32_t>(at); }
+
+	std::string String(size_t at) const { return Data.substr(Base + at + 4, Get<uint32_t>(at)); }
+};
+
+// The Arrow file's footer and record batches give back table
+static void CheckArrowFile(const std::string& data, const ReaParser::ReaTable& table, size_t batchRows) {
+	int32_t footerLength = 0;
+	memcpy(&footerLength, &data[data.size() - 10], 4);
+	FlatReader footer = { data, data.size() - 10 - footerLength };
+	size_t root = footer.Follow(0);
+
+	// The schema's fields are the table's columns
+	size_t schema = footer.Follow(footer.Field(root, 1));
+	size_t fields = footer.Follow(footer.Field(schema, 1));
+	CHECK(footer.Get<uint32_t>(fields) == table.Columns().size());
+	for (size_t i = 0; i < std::min<size_t>(footer.Get<uint32_t>(fields), table.Columns().size()); i++) {
+		size_t field = footer.Follow(fields + 4 + 4 * i);
+		CHECK(footer.String(footer.Follow(footer.Field(field, 0))) == table.Columns()[i].Name);
+	}
+
+	size_t blocks = footer.Follow(footer.Field(root, 3));
+	size_t count = footer.Get<uint32_t>(blocks);
+	CHECK(count == (table.Rows() + batchRows - 1) / batchRows);
+
+	size_t row = 0;
+	for (size_t b = 0; b < count; b++) {
+		int64_t offset = footer.Get<int64_t>(blocks + 4 + 24 * b);
+		int32_t metadataLength = footer.Get<int32_t>(blocks + 12 + 24 * b);
+		int64_t bodyLength = footer.Get<int64_t>(blocks + 20 + 24 * b);
+
+		// A continuation marker and the message's length, then a message holding a record batch
+		FlatReader message = { data, static_cast<size_t>(offset) + 8 };
+		CHECK(data.compare(static_cast<size_t>(offset), 4, "\xff\xff\xff\xff") == 0);
+		size_t header = message.Follow(0);
+		CHECK(message.Get<uint8_t>(message.Field(header, 1)) == 3);
+		CHECK(message.Get<int64_t>(message.Field(header, 3)) == bodyLength);
+		size_t batch = message.Follow(message.Field(header, 2));
+		size_t rows = static_cast<size_t>(message.Get<int64_t>(message.Field(batch, 0)));
+		CHECK(rows == std::min(batchRows, table.Rows() - row));
+
+		// Each column's validity bitmap, then its values, or its offsets and characters
+		size_t buffers = message.Follow(message.Field(batch, 2));
+		size_t body = static_cast<size_t>(offset) + metadataLength, buffer = 0;
+		auto bufferAt = [&](size_t index) { return body + message.Get<int64_t>(buffers + 4 + 16 * index); };
+		for (auto& column : table.Columns()) {
+			buffer++;
+			for (size_t r = 0; r < rows; r++) {
+				size_t at = bufferAt(buffer);
+				if (column.Type == ReaParser::ReaColumnType::String) {
+					int32_t begin, end;
+					memcpy(&begin, &data[at + 4 * r], 4);
+					memcpy(&end, &data[at + 4 * r + 4], 4);
+					CHECK(data.substr(bufferAt(buffer + 1) + begin, end - begin) == column.String(row + r));
+				}
+				else if (column.Type == ReaParser::ReaColumnType::Bool)
+					CHECK(((data[at + r / 8] >> (r % 8)) & 1) == column.Data[row + r]);
+				else
+					CHECK(data.compare(at + r * column.Width(), column.Width(), &column.Data[(row + r) * column.Width()], column.Width()) == 0);
+			}
+			buffer += column.Type == ReaParser::ReaColumnType::String ? 2 : 1;
+		}
+		row += rows;
+	}
+	CHECK(row == table.Rows());
+}
+
+static void TestArrow() {
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+	ReaParser::ReaArrowTables tables = ReaParser::ProjectTables(project);
+	size_t items = 0;
+	for (auto& track : project.Tracks)
+		items += track.MediaItems.size();
+	CHECK(tables.Projects.Rows() == 1 && tables.Tracks.Rows() == project.Tracks.size() && tables.Items.Rows() == items);
+
+	const ReaParser::ReaColumn* names = tables.Tracks.Column("name");
+	const ReaParser::ReaColumn* depths = tables.Tracks.Column("folderDepth");
+	CHECK(names && depths && names->Rows() == project.Tracks.size());
+	CHECK(names->String(1) == project.Tracks[1].Name && depths->Value<int32_t>(1) == project.Tracks[1].FolderDepth);
+	CHECK(tables.FX.Column("data") && !tables.Tracks.Column("missing"));
+
+	// Values must come in column order and fill the row
+	ReaParser::ReaTable table("test");
+	table.AddColumn("a", ReaParser::ReaColumnType::Int32);
+	table.AddColumn("b", ReaParser::ReaColumnType::Bool);
+	CHECK(ThrowsException([&]() { table.Bool(true); }));
+	table.Int32(1);
+	CHECK(ThrowsException([&]() { table.EndRow(); }));
+
+	// A magic number at both ends, then the schema message at 8 and the footer's length before the end
+	ReaParser::ReaArrowOptions options;
+	options.BatchRows = 3;
+	std::string filepath = TempPath("arrow");
+	ReaParser::WriteArrowFile(tables.Items, filepath, options);
+	std::string data = ReadFile(filepath);
+	int32_t footer = 0;
+	if (data.size() > 24)
+		memcpy(&footer, &data[data.size() - 10], 4);
+	CHECK(data.compare(0, 8, std::string("ARROW1\0\0", 8)) == 0 && data.compare(data.size() - 6, 6, "ARROW1") == 0);
+	CHECK(data.compare(8, 4, "\xff\xff\xff\xff") == 0 && footer > 0 && static_cast<size_t>(footer) < data.size());
+	if (footer > 0 && static_cast<size_t>(footer) < data.size())
+		CheckArrowFile(data, tables.Items, 3);
+
+	ReaParser::WriteArrowFile(tables.Tracks, filepath, options);
+	CheckArrowFile(ReadFile(filepath), tables.Tracks, 3);
+
+	// One batch takes less metadata and padding than a batch for every 3 items
+	ReaParser::WriteArrowFile(tables.Items, filepath);
+	CHECK(ReadFile(filepath).size() < data.size());
+	remove(filepath.c_str());
+}
+
+static void TestCApi() {
+	CHECK(rea_abi_version() == REAPARSER_C_ABI_VERSION);
+	CHECK(!rea_project_load(TempPath("does_not_exist").c_str(), nullptr) && strlen(rea_last_error()) > 0);
+
+	rea_options options;
+	rea_options_default(&options);
+	options.convert_volume_to_db = 0;
+	rea_project* handle = rea_project_load(TestProjectPath, &options);
+	CHECK(handle && strlen(rea_last_error()) == 0);
+	if (!handle)
+		return;
+
+	ReaParser::ReaOptions expectedOptions;
+	expectedOptions.ConvertVolumeToDB = false;
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(TestProjectPath, expectedOptions);
+	rea_project_info info;
+	CHECK(rea_project_info_get(handle, &info) == 0 && info.track_count == project.Tracks.size());
+	CHECK(std::string(info.name.data, info.name.size) == project.Name && info.sample_rate == project.SampleRate);
+
+	// Filled a few at a time, strings pointing into the handle's project
+	std::vector<rea_track> tracks(project.Tracks.size() + 1);
+	size_t filled = 0;
+	while (size_t count = rea_project_tracks(handle, filled, &tracks[filled], 3))
+		filled += count;
+	CHECK(filled == project.Tracks.size());
+	for (size_t i = 0; i < filled; i++) {
+		CHECK(std::string(tracks[i].guid.data, tracks[i].guid.size) == project.Tracks[i].GUID);
+		CHECK(tracks[i].volume == project.Tracks[i].Volume && tracks[i].item_count == project.Tracks[i].MediaItems.size());
+	}
+
+	// Items of every track, then by field, line up with each track's own
+	std::vector<rea_item> items(info.item_count);
+	std::vector<float> starts(info.item_count);
+	CHECK(rea_project_items(handle, 0, items.data(), items.size()) == info.item_count);
+	CHECK(rea_project_item_column(handle, REA_ITEM_START, 1, starts.data(), starts.size()) == info.item_count - 1);
+	size_t index = 0;
+	for (size_t t = 0; t < project.Tracks.size(); t++) {
+		std::vector<rea_item> own(project.Tracks[t].MediaItems.size() + 1);
+		CHECK(rea_track_items(handle, t, 0, own.data(), own.size()) == own.size() - 1);
+		for (size_t i = 0; i + 1 < own.size(); i++, index++) {
+			CHECK(items[index].track == t && items[index].name.data == own[i].name.data);
+			CHECK(items[index].start == project.Tracks[t].MediaItems[i].Start);
+			CHECK(index == 0 || starts[index - 1] == items[index].start);
+		}
+	}
+
+	std::vector<rea_fx> fx(info.fx_count + 1);
+	CHECK(rea_project_fx(handle, 0, fx.data(), fx.size()) == info.fx_count);
+	CHECK(rea_project_fx(handle, info.fx_count, fx.data(), fx.size()) == 0);
+	CHECK(rea_project_info_get(nullptr, &info) == -1 && strlen(rea_last_error()) > 0);
+
+	// NULL results are reported like a NULL project
+	CHECK(rea_project_info_get(handle, nullptr) == -1 && std::string(rea_last_error()) == "info is NULL");
+	CHECK(rea_project_tracks(handle, 0, nullptr, 3) == 0 && std::string(rea_last_error()) == "out is NULL");
+	CHECK(rea_track_fx(handle, 0, 0, nullptr, 3) == 0 && std::string(rea_last_error()) == "out is NULL");
+	CHECK(rea_project_item_column(handle, REA_ITEM_END, 0, nullptr, 3) == 0 && std::string(rea_last_error()) == "out is NULL");
+	CHECK(rea_project_items(handle, 0, items.data(), 1) == 1 && strlen(rea_last_error()) == 0);
+	rea_project_free(handle);
+}
+
+// Chunks missing their footer end at the next header of their own indentation
+static void TestMissingFooters() {
+	ReaParser::ReaOptions options;
+	ReaParser::ReaProject expected = ReaParser::LoadProjectFile(TestProjectPath, options);
+
+	std::string filepath = TempPath("footers");
+	WriteFile(filepath, Filter(ReadFile(TestProjectPath), [](const std::string& line) {
+		size_t indent = line.find_first_not_of(' ');
+		return indent != std::string::npos && indent > 0 && line[indent] == '>';
+	}));
+	ReaParser::ReaProject project = ReaParser::LoadProjectFile(filepath.c_str(), options);
+	remove(filepath.c_str());
+
+	CHECK(project.Tracks.size() == expected.Tracks.size());
+	for (size_t i = 0; i < std::min(project.Tracks.size(), expected.Tracks.size()); i++) {
+		const ReaParser::ReaTrack& track = project.Tracks[i];
+		const ReaParser::ReaTrack& want = expected.Tracks[i];
+		CHECK(track.Name == want.Name && track.GUID == want.GUID);
+		CHECK(track.Volume == want.Volume && track.Pan == want.Pan && track.Muted == want.Muted);
+		CHECK(track.MediaItems.size() == want.MediaItems.size());
+		for (size_t j = 0; j < std::min(track.MediaItems.size(), want.MediaItems.size()); j++) {
+			CHECK(track.MediaItems[j].Filepath == want.MediaItems[j].Filepath);
+			CHECK(track.MediaItems[j].Start == want.MediaItems[j].Start && track.MediaItems[j].End == want.MediaItems[j].End);
+		}
+		CHECK(track.FXChain.size() == want.FXChain.size());
+		for (size_t j = 0; j < std::min(track.FXChain.size(), want.FXChain.size()); j++)
+			CHECK(track.FXChain[j].Name == want.FXChain[j].Name);
+	}
+
+	// A file cut off within a track keeps the tracks before it and the part read of it
+	std::string text = ReadFile(TestProjectPath);
+	size_t cut = text.find("  <ITEM", text.find("  <TRACK {6BC04FCC"));
+	cut = text.find('\n', text.find("POSITION", cut)) + 1;
+	WriteFile(filepath, text.substr(0, cut));
+	project = ReaParser::LoadProjectFile(filepath.c_str(), options);
+	remove(filepath.c_str());
+
+	CHECK(project.IsValid() && project.Tracks.size() == 4);
+	if (project.Tracks.size() == 4) {
+		CHECK(project.Tracks[2].MediaItems.size() == expected.Tracks[2].MediaItems.size());
+		CHECK(project.Tracks[3].Name == "Guitar R" && project.Tracks[3].MediaItems.size() == 1);
+		CHECK(project.Tracks[3].MediaItems.empty() || project.Tracks[3].MediaItems[0].Start == expected.Tracks[3].MediaItems[0].Start);
+	}
+}
+
+// The message of the BadFile loading throws, empty if it loads
+static std::string LoadError(const std::string& filepath, const ReaParser::ReaOptions& options) {
+	try {
+		ReaParser::LoadProjectFile(filepath.c_str(), options);
+	}
+	catch (ReaParser::BadFile& e) {
+		return e.What();
+	}
+	return std::string();
+}
+
+static void TestLimits() {
+	// The test project's deepest nesting and longest line, counting the line break
+	std::istringstream in(ReadFile(TestProjectPath));
+	std::string line;
+	unsigned int depth = 0, deepest = 0;
+	size_t longest = 0;
+	while (std::getline(in, line)) {
+		size_t indent = line.find_first_not_of(" \t");
+		if (indent != std::string::npos && line[indent] == '<')
+			deepest = std::max(deepest, ++depth);
+		else if (indent != std::string::npos && line[indent] == '>')
+			depth--;
+		longest = std::max(longest, line.size() + 1);
+	}
+
+	// Limits are inclusive
+	ReaParser::ReaOptions options;
+	options.MaxDepth = deepest - 1;
+	CHECK(LoadError(TestProjectPath, options).find("nested too deeply") != std::string::npos);
+	options.MaxDepth = deepest;
+	CHECK(!Throws(TestProjectPath, options));
+
+	options = ReaParser::ReaOptions();
+	options.MaxLineLength = longest - 1;
+	CHECK(LoadError(TestProjectPath, options).find("line too long") != std::string::npos);
+	options.MaxLineLength = longest;
+	CHECK(!Throws(TestProjectPath, options));
+
+	// Chunks nested past the limit and a line longer than a read buffer, within a track
+	std::string text = ReadFile(TestProjectPath);
+	std::vector<std::string> nested;
+	for (int i = 0; i < 100; i++)
+		nested.push_back(std::string(4 + i, ' ') + "<EXT");
+	for (int i = 99; i >= 0; i--)
+		nested.push_back(std::string(4 + i, ' ') + ">");
+	std::string deep = text;
+	InsertLines(deep, "    <ITEM", nested);
+	std::string filepath = TempPath("limits");
+	WriteFile(filepath, deep);
+
+	options = ReaParser::ReaOptions();
+	CHECK(!Throws(filepath, options));
+	options.MaxDepth = 64;
+	std::string error = LoadError(filepath, options);
+	CHECK(error.find("nested too deeply") != std::string::npos);
+
+	// The project and track are open, so the 63rd inserted chunk is one too many
+	size_t first = std::count(text.begin(), text.begin() + text.find("    <ITEM"), '\n') + 1;
+	CHECK(error.find("(line " + std::to_string(first + 62) + ")") != std::string::npos);
+
+	std::string wide = text;
+	InsertLines(wide, "    <ITEM", { "    NOTES " + std::string(3 << 20, 'x') });
+	WriteFile(filepath, wide);
+	options = ReaParser::ReaOptions();
+	CHECK(!Throws(filepath, options));
+	options.MaxLineLength = 1 << 20;
+	CHECK(LoadError(filepath, options).find("line too long") != std::string::npos);
+	remove(filepath.c_str());
+
+	CHECK(Throws(TempPath("does_not_exist"), ReaParser::ReaOptions()));
+}
+
+static void TestLoadProjectFiles() {
+	std::vector<std::string> filepaths = { TestProjectPath, TempPath("does_not_exist"), TestProjectPath };
+	std::vector<std::string> errors;
+	std::vector<ReaParser::ReaProject> projects =
+		ReaParser::LoadProjectFiles(filepaths, ReaParser::ReaOptions(), 2, &errors);
+
+	CHECK(projects.size() == 3 && errors.size() == 3);
+	if (projects.size() != 3 || errors.size() != 3)
+		return;
+	CHECK(projects[0].IsValid() && errors[0].empty());
+	CHECK(!projects[1].IsValid() && !errors[1].empty());
+	CHECK(projects[2].IsValid() && projects[2].Tracks.size() == 8);
+
+	// Loads that fail are handed over, the callback's own exception comes out
+	std::atomic<size_t> calls(0);
+	CHECK(ThrowsException([&]() {
+		ReaParser::ForEachProjectFile(filepaths, ReaParser::ReaOptions(),
+			[&](size_t, unsigned int, ReaParser::ReaProject&, const std::string& error) {
+				calls++;
+				if (!error.empty())
+					throw ReaParser::Exception(error);
+			}, 2);
+	}));
+	CHECK(calls >= 2 && calls <= 3);
+}
+
+// Every index runs once per loop on a worker of the pool, however many loops it is handed
+static void TestThreadPool() {
+	ReaParser::ReaThreadPool pool(4);
+	CHECK(pool.Threads() == 4);
+
+	for (size_t count : { 0, 1, 3, 1000 }) {
+		std::vector<std::atomic<int>> runs(count);
+		std::atomic<bool> inPool(true);
+		pool.Run(count, [&](size_t i, unsigned int worker) {
+			runs[i]++;
+			inPool = inPool && worker < 4;
+		});
+		CHECK(inPool);
+		CHECK(std::all_of(runs.begin(), runs.end(), [](const std::atomic<int>& n) { return n == 1; }));
+	}
+
+	// The caller's exception comes back once the workers are done with the indices they hold,
+	// and no more are handed out. The workers hold on to their first index until the caller
+	// has one, so it surely gets one.
+	std::atomic<bool> started(false);
+	std::atomic<size_t> done(0);
+	CHECK(ThrowsException([&]() {
+		pool.Run(1000, [&](size_t, unsigned int worker) {
+			if (worker == 0) {
+				started = true;
+				throw ReaParser::Exception("stop");
+			}
+			while (!started)
+				std::this_thread::yield();
+			done++;
+		});
+	}));
+	CHECK(done <= 3);
+
+	// So does a worker's, of whatever type. The caller holds on to its index until a worker
+	// has thrown, so a worker surely gets one.
+	std::atomic<bool> thrown(false);
+	std::atomic<size_t> taken(0);
+	done = 0;
+	std::string what;
+	try {
+		pool.Run(1000, [&](size_t, unsigned int worker) {
+			taken++;
+			if (worker != 0) {
+				thrown = true;
+				throw std::runtime_error("worker " + std::to_string(worker));
+			}
+			while (!thrown)
+				std::this_thread::yield();
+			done++;
+		});
+	}
+	catch (std::runtime_error& e) {
+		what = e.what();
+	}
+	CHECK(what.size() == 8 && what.compare(0, 7, "worker ") == 0 && what[7] != '0');
+	CHECK(done <= 1 && taken <= 4);
+
+	// The pool carries on after an exception
+	std::atomic<size_t> after(0);
+	pool.Run(100, [&](size_t, unsigned int) { after++; });
+	CHECK(after == 100);
+
+	std::vector<int> squares(50);
+	ReaParser::ReaThreadPool::For(squares.size(), 0, [&](size_t i, unsigned int) { squares[i] = static_cast<int>(i * i); });
+	CHECK(squares[7] == 49 && squares[49] == 2401);
+}
+
+// Skips one JSON value, returning false if it isn't well-formed
+static bool SkipJson(const char*& at) {
+	auto space = [&]() { while (*at == ' ' || *at == '\n' || *at == '\r' || *at == '\t') at++; };
+	space();
+	if (*at == '{' || *at == '[') {
+		char close = *at == '{' ? '}' : ']';
+		at++;
+		space();
+		if (*at == close)
+			return ++at, true;
+		for (;;) {
+			if (close == '}') {
+				if (*at != '"' || !SkipJson(at))
+					return false;
+				space();
+				if (*at++ != ':')
+					return false;
+			}
+			if (!SkipJson(at))
+				return false;
+			space();
+			if (*at == close)
+				return ++at, true;
+			if (*at++ != ',')
+				return false;
+			space();
+		}
+	}
+	if (*at == '"') {
+		for (at++; *at != '"'; at++) {
+			if (static_cast<unsigned char>(*at) < 0x20)
+				return false;
+			if (*at == '\\' && !strchr("\"\\/bfnrtu", *++at))
+				return false;
+		}
+		return ++at, true;
+	}
+	for (const char* word : { "true", "false", "null" }) {
+		if (strncmp(at, word, strlen(word)) == 0)
+			return at += strlen(word), true;
+	}
+	char* end;
+	strtod(at, &end);
+	if (end == at)
+		return false;
+	at = end;
+	return true;
+}
+
+// Every file loaded on the pool shows up with its tracks and FX on the thread that loaded it
+static void TestTracer() {
+	struct Counts { size_t Files = 0, Tracks = 0, FX = 0; };
+	auto count = [](const std::vector<ReaParser::ReaTraceEvent>& events) {
+		std::map<uint32_t, Counts> threads;
+		for (const ReaParser::ReaTraceEvent& event : events) {
+			Counts& counts = threads[event.Thread];
+			counts.Files += strcmp(event.Name, "file") == 0;
+			counts.Tracks += strcmp(event.Name, "track") == 0;
+			counts.FX += strcmp(event.Name, "fx") == 0;
+		}
+		return threads;
+	};
+
+	// What one file records on its own
+	Counts single;
+	{
+		ReaParser::ReaTracer tracer;
+		ReaParser::ReaTracer::Install(&tracer);
+		ReaParser::LoadProjectFile(TestProjectPath, ReaParser::ReaOptions());
+		ReaParser::ReaTracer::Install(nullptr);
+		std::map<uint32_t, Counts> threads = count(tracer.Events());
+		CHECK(threads.size() == 1);
+		single = threads.begin()->second;
+	}
+	CHECK(single.Files == 1 && single.Tracks == 7 && single.FX > 0);
+	std::vector<std::string> filepaths(6, TestProjectPath);
+
+	ReaParser::ReaTracer tracer;
+	ReaParser::ReaTracer::Install(&tracer);
+	std::vector<ReaParser::ReaProject> projects = ReaParser::LoadProjectFiles(filepaths, ReaParser::ReaOptions(), 2);
+	ReaParser::ReaTracer::Install(nullptr);
+	CHECK(projects.size() == filepaths.size() && projects.back().IsValid());
+
+	std::vector<ReaParser::ReaTraceEvent> events = tracer.Events();
+	std::map<uint32_t, Counts> threads = count(events);
+	for (const ReaParser::ReaTraceEvent& event : events) {
+		CHECK(strcmp(event.Name, "file") != 0 || event.Detail == TestProjectPath);
+		CHECK(event.Duration >= 0.0);
+	}
+
+	size_t files = 0;
+	CHECK(threads.size() >= 1 && threads.size() <= 2);
+	for (auto& thread : threads) {
+		const Counts& counts = thread.second;
+		CHECK(counts.Files > 0);
+		CHECK(counts.Tracks == counts.Files * single.Tracks && counts.FX == counts.Files * single.FX);
+		files += counts.Files;
+	}
+	CHECK(files == filepaths.size());
+
+	// Each track span lies within a file span on its thread
+	for (const ReaParser::ReaTraceEvent& track : events) {
+		if (strcmp(track.Name, "track") != 0)
+			continue;
+		bool within = false;
+		for (const ReaParser::ReaTraceEvent& file : events) {
+			within |= strcmp(file.Name, "file") == 0 && file.Thread == track.Thread &&
+				file.Start <= track.Start && track.Start + track.Duration <= file.Start + file.Duration;
+		}
+		CHECK(within);
+	}
+
+	std::string filepath = TempPath("trace");
+	CHECK(tracer.WriteChromeTrace(filepath.c_str()));
+	std::string trace = ReadFile(filepath);
+	remove(filepath.c_str());
+	const char* at = trace.c_str();
+	CHECK(SkipJson(at));
+	while (*at == '\n')
+		at++;
+	CHECK(*at == '\0');
+	CHECK(trace.compare(0, 17, "{\"displayTimeUnit") == 0);
+	CHECK(trace.find("\"name\":\"thread_name\"") != std::string::npos);
+	CHECK(trace.find("\"name\":\"fx\",\"cat\":\"decode\"") != std::string::npos);
+}
+
+int main() {
+	TestLoadProject();
+	TestOptions();
+	TestPolicies();
+	TestDecibels();
+	TestRawValues();
+	TestTakes();
+	TestFieldTable();
+	TestHandlers();
+	TestSnapshot();
+	TestHistory();
+	TestMediaProbe();
+	TestPathResolver();
+	TestRender();
+	TestPeaks();
+	TestTimeline();
+	TestCorpusStats();
+	TestJson();
+	TestNdjson();
+	TestArrow();
+	TestCApi();
+	TestMissingFooters();
+	TestLimits();
+	TestLoadProjectFiles();
+	TestThreadPool();
+	TestTracer();
+
+	if (s_failures) {
+		std::cerr << s_failures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All tests passed" << std::endl;
+	return 0;
+}